@@ -3,12 +3,21 @@
 #include <algorithm>
 #include <smd.h>
 
+#include "test_buddy.h"
 #include "test_pointer.h"
 #include "test_string.h"
+#include "test_istring.h"
 #include "test_vector.h"
 #include "test_list.h"
 #include "test_hash.h"
+#include "test_flat_hash.h"
+#include "test_unordered_map.h"
 #include "test_map.h"
+#include "test_btree_map.h"
+#include "test_zset.h"
+#include "test_timer_wheel.h"
+#include "test_segment.h"
+#include "test_env.h"
 
 int main(int argc, char* argv[]) {
 	smd::SetLogHandler(
@@ -34,8 +43,20 @@ int main(int argc, char* argv[]) {
 		smd::Log::LogLevel::kInfo);
 
 	//缺省是冷启动，加入参数1表示热启动
-	const bool enable_attach = argc == 2 && atoi(argv[1]) == 1;
-	auto env = (smd::SmdEnv*)smd::SmdEnv::Create(0x001187fb, 25, enable_attach);
+	const bool enable_attach = argc >= 2 && atoi(argv[1]) == 1;
+
+	//第二个参数为1表示使用链表实现的伙伴系统
+	smd::EnvOptions options;
+	if (argc >= 3 && atoi(argv[2]) == 1) {
+		options.buddy_type = smd::BuddyType::kFreeList;
+	}
+
+	//第三个参数为1表示映射文件作为共享内存
+	if (argc >= 4 && atoi(argv[3]) == 1) {
+		options.file_path = "smd_function_test.mmap";
+	}
+
+	auto env = (smd::SmdEnv*)smd::SmdEnv::Create(0x001187fb, 25, enable_attach, options);
 	if (env == nullptr) {
 		SMD_LOG_ERROR("Create env failed");
 		return 0;
@@ -43,12 +64,21 @@ int main(int argc, char* argv[]) {
 
 	std::srand((unsigned int)std::time(nullptr));
 	for (int i = 0; i < 2; i++) {
+		TestBuddy test_buddy;
 		TestPointer test_pointer;
 		TestString test_string;
+		TestIString test_istring;
 		TestList test_list;
 		TestVector test_vector;
 		TestHash test_hash;
+		TestFlatHash test_flat_hash;
+		TestUnorderedMap test_unordered_map;
 		TestMap test_map;
+		TestBTreeMap test_btree_map;
+		TestZSet test_zset(env);
+		TestTimerWheel test_timer_wheel;
+		TestSegment test_segment;
+		TestEnv test_env(env);
 	}
 
 	std::string key("StartCounter");
@@ -0,0 +1,243 @@
+﻿#pragma once
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <smd.h>
+
+class TestBTreeMap {
+public:
+	TestBTreeMap() {
+		TestBTreeMapPod();
+		TestBTreeMapInteger();
+		TestBTreeMapString();
+		TestBTreeMapBound();
+		TestBTreeMapCopy();
+	}
+
+private:
+	// 随机插入删除，和std::map逐个对比，节点会不断地分裂、借用、合并
+	void TestBTreeMapPod() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_btree_map<int64_t, int64_t> map;
+			std::map<int64_t, int64_t> ref;
+			const int COUNT = 20000;
+			for (int i = 0; i < COUNT * 4; i++) {
+				int64_t key = int64_t(std::rand() % COUNT) - COUNT / 2;
+				if (std::rand() % 3 != 0) {
+					auto res = map.insert(std::make_pair(key, key * 10));
+					auto ref_res = ref.insert(std::make_pair(key, key * 10));
+					assert(res.second == ref_res.second && res.first->first == key);
+				} else {
+					assert(map.erase(key) == ref.erase(key));
+				}
+			}
+			assert(map.size() == ref.size() && IsEqual(map, ref));
+			assert(((uintptr_t)&*map.begin() & 63) == 24);
+
+			for (auto& kv : ref) {
+				auto it = map.find(kv.first);
+				assert(it != map.end() && it->second == kv.second);
+			}
+			assert(map.find(COUNT) == map.end() && map.count(-COUNT) == 0);
+
+			// 顺着迭代器删除一半
+			for (auto it = map.begin(); it != map.end();) {
+				if (it->first % 2 == 0) {
+					ref.erase(it->first);
+					it = map.erase(it);
+				} else {
+					++it;
+				}
+			}
+			assert(map.size() == ref.size() && IsEqual(map, ref));
+
+			// 递增插入时叶子是满的，树更矮
+			smd::shm_btree_map<int64_t, int64_t> seq;
+			for (int64_t i = 0; i < COUNT; i++) {
+				seq[i] = i;
+			}
+			assert(seq.size() == size_t(COUNT) && seq.height() <= 4);
+			for (int64_t i = 0; i < COUNT; i++) {
+				assert(seq.erase(i) == 1);
+			}
+			assert(seq.empty() && seq.height() == 0 && seq.begin() == seq.end());
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestBTreeMapPod complete");
+	}
+
+	// 无符号和32位的key走SIMD比较，覆盖最高位为1的值
+	void TestBTreeMapInteger() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_btree_map<uint64_t, int> map;
+			std::map<uint64_t, int> ref;
+			smd::shm_btree_map<int32_t, int> map32;
+			std::map<int32_t, int> ref32;
+			for (int i = 0; i < 5000; i++) {
+				uint64_t key = (uint64_t(std::rand()) << 40) ^ (uint64_t(std::rand() & 1) << 63) ^ uint64_t(std::rand());
+				map.insert(std::make_pair(key, i));
+				ref.insert(std::make_pair(key, i));
+
+				int32_t key32 = int32_t(std::rand()) * ((i & 1) ? -1 : 1);
+				map32.insert(std::make_pair(key32, i));
+				ref32.insert(std::make_pair(key32, i));
+			}
+			assert(IsEqual(map, ref) && IsEqual(map32, ref32));
+			for (auto& kv : ref) {
+				assert(map.find(kv.first)->second == kv.second);
+			}
+			for (auto& kv : ref32) {
+				assert(map32.find(kv.first)->second == kv.second);
+			}
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestBTreeMapInteger complete");
+	}
+
+	void TestBTreeMapString() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_btree_map<smd::shm_string, smd::shm_string> map;
+			std::map<std::string, std::string> ref;
+			std::vector<int> ids;
+			for (int i = 0; i < 3000; i++) {
+				ids.push_back(i);
+			}
+			std::default_random_engine generator{std::random_device{}()};
+			std::shuffle(ids.begin(), ids.end(), generator);
+
+			for (auto id : ids) {
+				// 一半是超出SSO_CAPACITY的长key
+				auto key = smd::util::Text::Format(id % 2 ? "Key%05d" : "LongLongLongLongLongKey%05d", id);
+				assert(map.try_emplace(smd::shm_string(key), key).second);
+				ref[key] = key;
+			}
+			assert(!map.emplace(smd::shm_string("Key00001"), smd::shm_string("dup")).second);
+
+			// emplace先用key查找，已经存在时不构造元素，也就不分配内存
+			auto malloc_count = smd::g_alloc->GetMallocCount();
+			const std::string long_value(64, 'v');
+			assert(!map.emplace(smd::Slice("LongLongLongLongLongKey00000"), long_value).second);
+			assert(!map.emplace("LongLongLongLongLongKey00002", long_value).second);
+			assert(smd::g_alloc->GetMallocCount() == malloc_count);
+			assert(map.emplace(smd::Slice("LongLongLongLongLongKey_emplace"), long_value).second);
+			assert(map.find(smd::Slice("LongLongLongLongLongKey_emplace"))->second.ToString() == long_value);
+			ref["LongLongLongLongLongKey_emplace"] = long_value;
+			assert(map.size() == ref.size());
+
+			auto it_ref = ref.begin();
+			for (auto& kv : map) {
+				assert(kv.first.ToString() == it_ref->first && kv.second.ToString() == it_ref->second);
+				++it_ref;
+			}
+
+			// 用Slice查找和删除，不构造shm_string
+			assert(map.find(smd::Slice("Key00001")) != map.end());
+			assert(map.count(smd::Slice("Key99999")) == 0);
+			for (auto id : ids) {
+				if (id % 3 == 0) {
+					auto key = smd::util::Text::Format(id % 2 ? "Key%05d" : "LongLongLongLongLongKey%05d", id);
+					assert(map.erase(smd::Slice(key)) == 1);
+					ref.erase(key);
+				}
+			}
+			assert(map.size() == ref.size());
+			it_ref = ref.begin();
+			for (auto it = map.begin(); it != map.end(); ++it, ++it_ref) {
+				assert(it->first.ToString() == it_ref->first);
+			}
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestBTreeMapString complete");
+	}
+
+	void TestBTreeMapBound() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_btree_map<int64_t, int64_t> map;
+			std::map<int64_t, int64_t> ref;
+			for (int64_t i = 0; i < 3000; i += 3) {
+				map.insert(std::make_pair(i, i));
+				ref.insert(std::make_pair(i, i));
+			}
+
+			for (int64_t k = -2; k < 3005; k++) {
+				auto lb = map.lower_bound(k);
+				auto ref_lb = ref.lower_bound(k);
+				assert((lb == map.end()) == (ref_lb == ref.end()));
+				assert(lb == map.end() || lb->first == ref_lb->first);
+
+				auto ub = map.upper_bound(k);
+				auto ref_ub = ref.upper_bound(k);
+				assert((ub == map.end()) == (ref_ub == ref.end()));
+				assert(ub == map.end() || ub->first == ref_ub->first);
+
+				auto range = map.equal_range(k);
+				assert(range.first == lb && range.second == ub);
+			}
+
+			// 跨越多个叶子的[from, to)
+			int64_t sum = 0;
+			auto add = [&](const int64_t& key, int64_t& value) { sum += value; };
+			assert(map.scan(1, 301, size_t(-1), add) == 100 && sum == 3 * 100 * 101 / 2);
+			sum = 0;
+			assert(map.scan(0, 3000, 10, add) == 10 && sum == 3 * 9 * 10 / 2);
+			assert(map.scan(2998, 5000, size_t(-1), add) == 0 && map.scan(-10, 0, size_t(-1), add) == 0);
+
+			// 往回走
+			auto it = map.find(2997);
+			int64_t expect = 2997;
+			for (;; --it, expect -= 3) {
+				assert(it->first == expect);
+				if (it == map.begin())
+					break;
+			}
+			assert(expect == 0);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestBTreeMapBound complete");
+	}
+
+	void TestBTreeMapCopy() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			auto map = smd::g_alloc->New<smd::shm_btree_map<int64_t, smd::shm_string>>();
+			for (int64_t i = 0; i < 1000; i++) {
+				(*map)[i] = smd::util::Text::Format("LongLongLongLongLongValue%04d", int(i));
+			}
+
+			smd::shm_btree_map<int64_t, smd::shm_string> copy(*map);
+			assert(copy.size() == 1000 && copy.find(999)->second == "LongLongLongLongLongValue0999");
+			copy.erase(999);
+			assert(map->size() == 1000);
+
+			smd::shm_btree_map<int64_t, smd::shm_string> moved(std::move(copy));
+			assert(copy.empty() && copy.begin() == copy.end() && moved.size() == 999);
+			copy = *map;
+			assert(copy.size() == 1000);
+			copy = std::move(moved);
+			assert(copy.size() == 999 && moved.empty());
+
+			smd::g_alloc->Delete(map);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestBTreeMapCopy complete");
+	}
+
+private:
+	template <class K, class V, class RK, class RV>
+	bool IsEqual(smd::shm_btree_map<K, V>& map, const std::map<RK, RV>& ref) {
+		if (map.size() != ref.size())
+			return false;
+
+		auto it = map.begin();
+		for (auto& kv : ref) {
+			if (it == map.end() || it->first != kv.first || it->second != kv.second)
+				return false;
+			++it;
+		}
+		return it == map.end();
+	}
+};
@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <vector>
+#include <algorithm>
+#include <smd.h>
+
+class TestBuddy {
+public:
+	TestBuddy() {
+		TestBuddyTree();
+		TestBuddyList();
+	}
+
+private:
+	struct StBlock {
+		int64_t offset;
+		uint32_t size;
+	};
+
+	void TestBuddyTree() {
+		const int LEVEL = 20;
+		// 索引区填满脏数据，buddy_new不会清零整个索引区
+		std::vector<uint64_t> mem((smd::SmdBuddyAlloc::get_index_size(LEVEL) + 7) / 8, ~uint64_t(0));
+		auto self = smd::SmdBuddyAlloc::buddy_new((const char*)mem.data(), LEVEL);
+
+		auto blocks = RandomBlocks([&](uint32_t size) { return smd::SmdBuddyAlloc::buddy_alloc(self, size); });
+		assert(!blocks.empty());
+		for (auto& block : blocks) {
+			smd::SmdBuddyAlloc::buddy_free(self, int(block.offset));
+		}
+
+		// 全部回收之后，能再分配出最大的块
+		assert(smd::SmdBuddyAlloc::buddy_alloc(self, 1 << LEVEL) == 0);
+		SMD_LOG_INFO("TestBuddyTree complete");
+	}
+
+	void TestBuddyList() {
+		const int LEVEL = 20;
+		std::vector<uint64_t> mem(
+			(smd::SmdBuddyListAlloc::get_index_size(LEVEL) + smd::SmdBuddyListAlloc::get_storage_size(LEVEL) + 7) / 8,
+			~uint64_t(0));
+		auto self = smd::SmdBuddyListAlloc::buddy_new((const char*)mem.data(), LEVEL);
+		char* storage = (char*)mem.data() + smd::SmdBuddyListAlloc::get_index_size(LEVEL);
+
+		auto blocks = RandomBlocks([&](uint32_t size) { return smd::SmdBuddyListAlloc::buddy_alloc(self, size); });
+		assert(!blocks.empty());
+
+		// 分配出来的块互不重叠
+		for (size_t i = 0; i < blocks.size(); i++) {
+			memset(storage + blocks[i].offset, int(i & 0xff), blocks[i].size);
+		}
+		for (size_t i = 0; i < blocks.size(); i++) {
+			for (uint32_t j = 0; j < blocks[i].size; j++) {
+				assert(storage[blocks[i].offset + j] == char(i & 0xff));
+			}
+		}
+
+		for (auto& block : blocks) {
+			smd::SmdBuddyListAlloc::buddy_free(self, block.offset, block.size);
+		}
+
+		// 全部回收之后，所有的块都合并成了一个
+		assert(smd::SmdBuddyListAlloc::buddy_free_count(self, LEVEL) == 1);
+		assert(smd::SmdBuddyListAlloc::buddy_alloc(self, 1 << LEVEL) == 0);
+		assert(smd::SmdBuddyListAlloc::buddy_alloc(self, 1) == -1);
+		SMD_LOG_INFO("TestBuddyList complete");
+	}
+
+	// 随机大小的分配，直到空间用完，返回的结果是打乱顺序的，方便按随机的顺序回收
+	template <typename F>
+	std::vector<StBlock> RandomBlocks(F&& alloc) {
+		std::vector<StBlock> blocks;
+		for (;;) {
+			uint32_t size = smd::util::Random::RandomInt<uint32_t>(1, 4096);
+			int64_t offset = alloc(size);
+			if (offset < 0)
+				break;
+
+			blocks.push_back({offset, size});
+		}
+
+		std::default_random_engine generator{std::random_device{}()};
+		std::shuffle(blocks.begin(), blocks.end(), generator);
+		return blocks;
+	}
+};
@@ -0,0 +1,262 @@
+﻿#pragma once
+#include <map>
+#include <thread>
+#include <algorithm>
+#include <smd.h>
+
+class TestEnv {
+public:
+	struct StConfig {
+		smd::shm_map<smd::shm_string, smd::shm_string> configs;
+	};
+
+	TestEnv(smd::SmdEnv* env) {
+		TestMultiEnv(env);
+#ifndef _WIN32
+		TestSegmentOwner(env);
+#endif
+		TestStringOps(env);
+		TestExpire(env);
+		TestBatchOps(env);
+	}
+
+private:
+	// 同一个进程中同时使用两个字典
+	void TestMultiEnv(smd::SmdEnv* env) {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		// 创建之后新的字典就是当前字典
+		smd::EnvOptions options;
+		options.env_id = 1;
+		auto config = smd::Env<StConfig>::Create(0x001187fc, 20, false, options);
+		assert(config != nullptr);
+		assert(smd::g_alloc == config->GetAlloc());
+
+		// 编号已经被占用时创建失败，原来的字典不受影响
+		assert(smd::Env<StConfig>::Create(0x001187fd, 20, false, options) == nullptr);
+		assert(smd::g_alloc == config->GetAlloc() && smd::g_env_alloc[1] == config->GetAlloc());
+
+		auto& configs = config->GetEntry().configs;
+		for (int i = 0; i < 100; i++) {
+			configs.insert(
+				std::make_pair(smd::shm_string("config" + std::to_string(i)), smd::shm_string(std::to_string(i))));
+		}
+
+		// 指针里带着字典的编号
+		auto p = smd::g_alloc->Malloc<char>(100);
+		assert((p.Raw() >> smd::SHM_ENV_SHIFT) == 1);
+
+		// 切回原来的字典
+		env->Activate();
+		assert(smd::g_alloc == env->GetAlloc());
+		auto q = smd::g_alloc->Malloc<char>(100);
+		assert((q.Raw() >> smd::SHM_ENV_SHIFT) == 0);
+		memset(p.Ptr(), 1, 100);
+		memset(q.Ptr(), 2, 100);
+		assert(p.Ptr()[99] == 1 && q.Ptr()[99] == 2);
+
+		// 回收时按指针找到对应的字典
+		smd::g_alloc->Free(p, 100);
+		smd::g_alloc->Free(q, 100);
+
+		// 两个字典的数据都可以访问
+		for (int i = 0; i < 100; i++) {
+			auto it = configs.find(smd::shm_string("config" + std::to_string(i)));
+			assert(it != configs.end() && it->second.ToString() == std::to_string(i));
+		}
+
+		// 当前字典是env的时候写config里的容器，节点和长字符串仍然分配在config里
+		auto config_usage = config->GetAlloc()->GetUsed();
+		const std::string long_value(64, 'v');
+		assert(configs.try_emplace(smd::Slice("config_long"), long_value).second);
+		configs.find(smd::Slice("config0"))->second.assign(long_value.data(), long_value.size());
+		assert(config->GetAlloc()->GetUsed() > config_usage && mem_usage == smd::g_alloc->GetUsed());
+		assert((config->GetAlloc()->ToShmPointer<char>(configs.find(smd::Slice("config0"))->second.data()).Raw() >>
+				   smd::SHM_ENV_SHIFT) == 1);
+
+		// 回收时按指针找到所在的字典，不需要切换
+		configs.clear();
+		delete config;
+		env->Activate();
+
+		// 没有内存泄露
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMultiEnv complete");
+	}
+
+#ifndef _WIN32
+	// 冷启动只删除自己上一次留下的扩展段，扩展段的key上是别人的共享内存时不删除
+	void TestSegmentOwner(smd::SmdEnv* env) {
+		const int shm_key = 0x001187fd;
+		const int segment_key = shm_key + smd::ShmHandle::SEGMENT_KEY_STEP;
+		smd::EnvOptions options;
+		options.env_id = 1;
+
+		// 第0段放不下时创建第1段，析构之后第1段还在
+		auto config = smd::Env<StConfig>::Create(shm_key, 20, false, options);
+		assert(config != nullptr);
+		auto big = smd::g_alloc->Malloc<char>(size_t(1) << 21);
+		assert(((big.Raw() >> smd::SHM_SEGMENT_SHIFT) & (smd::SHM_SEGMENT_NUM - 1)) == 1);
+		smd::g_alloc->Free(big, size_t(1) << 21);
+		delete config;
+		uint32_t magic = 0;
+		assert(smd::ShmLinux::peek(segment_key, &magic, sizeof(magic)) && magic == smd::Alloc::SEGMENT_MAGIC);
+
+		// 再次冷启动时删掉
+		config = smd::Env<StConfig>::Create(shm_key, 20, false, options);
+		assert(config != nullptr && !smd::ShmLinux::peek(segment_key, &magic, sizeof(magic)));
+		delete config;
+
+		// 别人的共享内存不删
+		smd::ShmLinux other;
+		auto mem = other.acquire(segment_key, 4096, false).first;
+		assert(mem != nullptr);
+		memcpy(mem, "other", 6);
+		config = smd::Env<StConfig>::Create(shm_key, 20, false, options);
+		assert(config != nullptr);
+		delete config;
+		char text[6] = {};
+		assert(smd::ShmLinux::peek(segment_key, text, sizeof(text)) && strcmp(text, "other") == 0);
+
+		other.release();
+		assert(smd::ShmLinux::remove(segment_key) && smd::ShmLinux::remove(shm_key));
+		env->Activate();
+		SMD_LOG_INFO("TestSegmentOwner complete");
+	}
+#endif
+
+	// 读操作和删除不存在的key不分配共享内存，覆盖写时容量够用也不分配
+	void TestStringOps(smd::SmdEnv* env) {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		env->SSet("test_string_ops", "value1");
+		auto malloc_count = smd::g_alloc->GetMallocCount();
+
+		smd::Slice value;
+		assert(env->SGet("test_string_ops", &value) && value.ToString() == "value1");
+		assert(env->SGet(std::string("test_string_ops"), nullptr));
+		assert(!env->SGet("test_string_ops_none", &value));
+		assert(!env->SDel("test_string_ops_none"));
+		env->SSet("test_string_ops", "value2");
+		assert(env->SGet("test_string_ops", &value) && value.ToString() == "value2");
+		assert(smd::g_alloc->GetMallocCount() == malloc_count);
+
+		assert(env->SDel("test_string_ops"));
+		assert(!env->SGet("test_string_ops", &value));
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestStringOps complete");
+	}
+
+	// 过期时间：读的时候顺便删除，或者由Tick删除；覆盖写清除过期时间
+	void TestExpire(smd::SmdEnv* env) {
+		// 哈希表的桶数组只增不减，先扩好再统计
+		env->GetEntry().all_expires.reserve(1024);
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		assert(!env->Expire("test_expire_none", 1000) && env->TTL("test_expire_none") == -2);
+		env->SSet("test_expire_plain", "value");
+		assert(env->TTL("test_expire_plain") == -1);
+
+		env->SSetEx("test_expire_long", "value", 100000);
+		auto ttl = env->TTL("test_expire_long");
+		assert(ttl > 90000 && ttl <= 100000);
+
+		// 读的时候发现过期
+		env->SSetEx("test_expire_lazy", "value", 5);
+		// 覆盖写之后不再过期，时间轮里的节点一起删掉
+		env->SSetEx("test_expire_reset", "value", 5);
+		env->SSet("test_expire_reset", "value2");
+		// 重新设置过期时间，以后一次为准，时间轮里的节点直接移动
+		env->SSetEx("test_expire_extend", "value", 5);
+		assert(env->Expire("test_expire_extend", 100000));
+		// 由Tick删除
+		for (int i = 0; i < 100; i++) {
+			env->SSetEx(smd::util::Text::Format("test_expire_tick%d", i), "value", 5);
+		}
+		// 每个有过期时间的key在时间轮里正好有一个节点
+		assert(env->GetEntry().expire_wheel.size() == 103 && env->GetEntry().all_expires.size() == 103);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		smd::Slice value;
+		assert(!env->SGet("test_expire_lazy", &value) && env->TTL("test_expire_lazy") == -2);
+		assert(env->Tick() == 100);
+		assert(env->SGet("test_expire_reset", &value) && value.ToString() == "value2");
+		assert(env->TTL("test_expire_reset") == -1 && env->TTL("test_expire_extend") > 90000);
+		assert(!env->SGet("test_expire_tick0", nullptr) && !env->SGet("test_expire_tick99", nullptr));
+
+		// 剩下的在以后到期
+		assert(env->Expire("test_expire_plain", -1) && !env->SGet("test_expire_plain", nullptr));
+		assert(env->SDel("test_expire_reset") && env->SDel("test_expire_extend"));
+		assert(env->Tick(smd::util::Time::NowMs() + 200000) == 1 && env->TTL("test_expire_long") == -2);
+		assert(env->GetEntry().all_expires.empty() && env->GetEntry().expire_wheel.empty());
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestExpire complete");
+	}
+
+	// 批量操作和逐个操作的结果一致，key可以重复、乱序
+	void TestBatchOps(smd::SmdEnv* env) {
+		env->GetEntry().all_expires.reserve(1024);
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		std::vector<std::string> key_strs;
+		std::vector<std::string> value_strs;
+		std::map<std::string, std::string> ref;
+		for (int i = 0; i < 300; i++) {
+			int id = std::rand() % 200;
+			key_strs.push_back(smd::util::Text::Format(id % 2 ? "test_batch%d" : "test_batch_LongLongLongLongKey%d", id));
+			value_strs.push_back(smd::util::Text::Format("value%d", i));
+			ref[key_strs.back()] = value_strs.back();
+		}
+		std::vector<smd::Slice> keys(key_strs.begin(), key_strs.end());
+		std::vector<smd::Slice> values(value_strs.begin(), value_strs.end());
+
+		// 已经存在并且带过期时间的key被覆盖之后不再过期
+		env->SSetEx(key_strs[0], "old", 100000);
+		env->MSet(keys.data(), values.data(), keys.size());
+		assert(env->TTL(key_strs[0]) == -1);
+		for (auto& kv : ref) {
+			smd::Slice value;
+			assert(env->SGet(kv.first, &value) && value.ToString() == kv.second);
+		}
+
+		// 再写一次，这次key都已经存在，重复的key同样以后面的为准
+		std::reverse(values.begin(), values.end());
+		for (size_t i = 0; i < keys.size(); i++) {
+			ref[key_strs[i]] = values[i].ToString();
+		}
+		env->MSet(keys.data(), values.data(), keys.size());
+		for (auto& kv : ref) {
+			smd::Slice value;
+			assert(env->SGet(kv.first, &value) && value.ToString() == kv.second);
+		}
+
+		std::vector<std::string> query_strs(key_strs.begin(), key_strs.begin() + 50);
+		query_strs.push_back("test_batch_none");
+		std::vector<smd::Slice> queries(query_strs.begin(), query_strs.end());
+		std::vector<smd::Slice> results(queries.size());
+		bool found[51];
+		assert(env->MGet(queries.data(), queries.size(), results.data(), found) == 50);
+		for (size_t i = 0; i < 50; i++) {
+			assert(found[i] && results[i].ToString() == ref[query_strs[i]]);
+		}
+		assert(!found[50] && results[50].empty());
+
+		// 过期的key读不到
+		env->SSetEx("test_batch_expired", "value", 1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		smd::Slice expired_key("test_batch_expired");
+		assert(env->MGet(&expired_key, 1, results.data()) == 0);
+
+		assert(env->MDel(keys.data(), keys.size()) == ref.size());
+		assert(env->MDel(keys.data(), keys.size()) == 0);
+		for (auto& kv : ref) {
+			assert(!env->SGet(kv.first, nullptr));
+		}
+
+		// 覆盖和读时删除都已经把时间轮里的节点删掉了
+		assert(env->GetEntry().expire_wheel.empty() && env->GetEntry().all_expires.empty());
+		assert(env->Tick(smd::util::Time::NowMs() + 200000) == 0);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestBatchOps complete");
+	}
+};
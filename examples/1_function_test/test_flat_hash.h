@@ -0,0 +1,169 @@
+﻿#pragma once
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <smd.h>
+
+class TestFlatHash {
+public:
+	TestFlatHash() {
+		TestFlatHashPod();
+		TestFlatHashChurn();
+		TestFlatHashString();
+	}
+
+private:
+	void TestFlatHashPod() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_flat_hash_map<uint64_t, uint64_t>>();
+		std::unordered_map<uint64_t, uint64_t> ref;
+
+		std::vector<uint64_t> vRoleIds;
+		const size_t COUNT = 1000;
+		for (size_t i = 0; i < COUNT; i++) {
+			vRoleIds.push_back(i * 128);
+		}
+
+		std::default_random_engine generator{std::random_device{}()};
+		std::shuffle(vRoleIds.begin(), vRoleIds.end(), generator);
+
+		for (size_t i = 0; i < vRoleIds.size(); i++) {
+			const auto& role_id = vRoleIds[i];
+			auto res = obj->insert(std::make_pair(role_id, role_id + 1));
+			assert(res.second && res.first->second == role_id + 1);
+			ref.insert(std::make_pair(role_id, role_id + 1));
+
+			// 重复插入失败，返回已有的元素
+			res = obj->insert(std::make_pair(role_id, uint64_t(0)));
+			assert(!res.second && res.first->second == role_id + 1);
+		}
+
+		assert(obj->size() == COUNT);
+		assert(obj->load_factor() <= 0.875f);
+		assert(IsEqual(*obj, ref));
+		assert(obj->find(3 * 128) != obj->end());
+		assert(obj->find(3) == obj->end());
+		assert(obj->count(COUNT * 128) == 0);
+
+		(*obj)[7] = 70;
+		assert(obj->find(7)->second == 70);
+		assert(obj->erase(7) == 1);
+		assert(obj->erase(7) == 0);
+
+		// 拷贝出来的是独立的一份
+		do {
+			smd::shm_flat_hash_map<uint64_t, uint64_t> copy(*obj);
+			assert(IsEqual(copy, ref));
+			copy.clear();
+			assert(copy.empty() && copy.begin() == copy.end());
+			assert(obj->size() == COUNT);
+		} while (false);
+
+		for (size_t i = 0; i < vRoleIds.size(); i++) {
+			const auto& key = vRoleIds[i];
+			auto itm = obj->find(key);
+			assert(itm != obj->end());
+			obj->erase(itm);
+			ref.erase(key);
+		}
+		assert(IsEqual(*obj, ref));
+		assert(obj->size() == 0);
+
+		smd::g_alloc->Delete(obj);
+		assert(obj == smd::shm_nullptr);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestFlatHashPod complete");
+	}
+
+	// 反复插入删除，墓碑不能让表无限扩大，也不能让查找出错
+	void TestFlatHashChurn() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_flat_hash_set<uint64_t>>();
+		std::unordered_set<uint64_t> ref;
+
+		const uint64_t RANGE = 512;
+		for (int i = 0; i < 20000; i++) {
+			uint64_t key = smd::util::Random::RandomInt<uint64_t>(0, RANGE - 1);
+			if (smd::util::Random::RandomInt<int>(0, 1) == 0) {
+				assert(obj->insert(key).second == ref.insert(key).second);
+			} else {
+				assert(obj->erase(key) == ref.erase(key));
+			}
+			assert(obj->size() == ref.size());
+		}
+
+		assert(obj->capacity() <= 1024);
+		for (uint64_t key = 0; key < RANGE; key++) {
+			assert(obj->contains(key) == (ref.count(key) > 0));
+		}
+
+		size_t n = 0;
+		for (auto it = obj->begin(); it != obj->end(); ++it) {
+			assert(ref.count(*it) > 0);
+			n++;
+		}
+		assert(n == ref.size());
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestFlatHashChurn complete");
+	}
+
+	void TestFlatHashString() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_flat_hash_map<smd::shm_string, smd::shm_string>>(16);
+		std::unordered_map<std::string, std::string> ref;
+
+		const int COUNT = 1000;
+		for (auto i = 0; i < COUNT; i++) {
+			auto key = smd::util::Text::Format("Key%05d", i);
+			auto value = smd::util::Text::Format("Value%05d", i);
+			obj->insert(std::make_pair(smd::shm_string(key), smd::shm_string(value)));
+			ref.insert(std::make_pair(key, value));
+		}
+		assert(obj->size() == ref.size());
+
+		for (auto& pair : ref) {
+			auto it = obj->find(smd::shm_string(pair.first));
+			assert(it != obj->end());
+			assert(it->second.ToString() == pair.second);
+		}
+
+		// 删掉一半之后再全部删掉
+		for (auto it = obj->begin(); it != obj->end();) {
+			it = obj->erase(it);
+			if (obj->size() == COUNT / 2)
+				break;
+		}
+		assert(obj->size() == COUNT / 2);
+		obj->clear();
+		assert(obj->empty());
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestFlatHashString complete");
+	}
+
+private:
+	static bool IsEqual(smd::shm_flat_hash_map<uint64_t, uint64_t>& l, const std::unordered_map<uint64_t, uint64_t>& r) {
+		if (l.size() != r.size()) {
+			assert(false);
+			return false;
+		}
+
+		size_t n = 0;
+		for (auto it = l.begin(); it != l.end(); ++it) {
+			auto it_ref = r.find(it->first);
+			if (it_ref == r.end() || it_ref->second != it->second) {
+				assert(false);
+				return false;
+			}
+			n++;
+		}
+
+		return n == r.size();
+	}
+};
@@ -8,9 +8,36 @@ public:
 	TestHash() {
 		TestHashPod();
 		TestHashString();
+		TestHashRehash();
+		TestHashMove();
 	}
 
 private:
+	// 右值insert、emplace和移动构造
+	void TestHashMove() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_hash<smd::shm_string> hash;
+			const std::string long_str(64, 'h');
+			smd::shm_string s(long_str);
+			assert(hash.insert(std::move(s)).second && s.empty());
+			assert(hash.emplace("key").second && !hash.emplace("key").second);
+			assert(hash.size() == 2 && hash.count(smd::Slice(long_str)) == 1);
+
+			smd::shm_hash<smd::shm_string> hash2(std::move(hash));
+			assert(hash2.size() == 2 && hash.size() == 0);
+			hash.insert(smd::shm_string("reuse"));
+			hash = std::move(hash2);
+			assert(hash.size() == 2 && hash.count("key") == 1 && hash2.size() == 0);
+
+			// 拷贝依然可用
+			smd::shm_hash<smd::shm_string> hash3(hash);
+			assert(hash3.size() == 2 && hash3.count(smd::Slice(long_str)) == 1);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestHashMove complete");
+	}
+
 	void TestHashString() {
 		auto mem_usage = smd::g_alloc->GetUsed();
 		auto obj = smd::g_alloc->New<smd::shm_hash<smd::shm_string>>().Ptr();
@@ -134,6 +161,79 @@ private:
 		SMD_LOG_INFO("TestMapPod complete");
 	}
 
+	// 扩容分多次完成，迁移过程中查找、遍历、删除都要正确
+	void TestHashRehash() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_hash<uint64_t>>();
+		std::unordered_set<uint64_t> ref;
+
+		const uint64_t COUNT = 5000;
+		size_t rehashing_checks = 0;
+		for (uint64_t i = 0; i < COUNT; i++) {
+			obj->insert(i);
+			ref.insert(i);
+
+			// 迁移到一半的时候做完整的检查，并且删掉一些key
+			if (obj->is_rehashing() && i % 7 == 0) {
+				assert(obj->bucket_count() > 0);
+				assert(IsEqual(*obj, ref));
+				assert(obj->erase(i / 2) == (ref.erase(i / 2) > 0));
+				rehashing_checks++;
+			}
+		}
+		assert(rehashing_checks > 0);
+		assert(obj->size() == ref.size());
+
+		// 只读的场景手动把迁移做完
+		while (obj->step()) {
+		}
+		assert(!obj->is_rehashing());
+		assert(obj->load_factor() < 1.0f);
+		assert(IsEqual(*obj, ref));
+
+		// 准备阶段再次扩容直接把新表改大
+		const size_t old_count = obj->bucket_count();
+		obj->rehash(old_count * 2);
+		assert(obj->is_rehashing());
+		obj->rehash(old_count * 4);
+		while (obj->bucket_count() < old_count * 5) {
+			assert(obj->step());
+		}
+		assert(obj->bucket_count() == old_count * 5);
+
+		// 开始迁移之后再次扩容，不会把这次迁移一次做完，迁移完成后接着开始下一次
+		assert(obj->step());
+		obj->rehash(old_count * 16);
+		assert(obj->bucket_count() > old_count * 4);
+		assert(IsEqual(*obj, ref));
+		while (obj->step()) {
+		}
+		assert(obj->bucket_count() == old_count * 16);
+		assert(IsEqual(*obj, ref));
+
+		obj->clear();
+		assert(obj->size() == 0 && obj->begin() == obj->end());
+		smd::g_alloc->Delete(obj);
+
+		// 低位都相同的整数key也能分散到不同的桶里
+		{
+			smd::shm_hash<uint64_t> hash;
+			for (uint64_t i = 0; i < 1000; i++) {
+				hash.insert(i << 20);
+			}
+			while (hash.step()) {
+			}
+			size_t max_bucket_size = 0;
+			for (size_t i = 0; i < hash.bucket_count(); i++) {
+				max_bucket_size = std::max(max_bucket_size, size_t(hash.bucket_size(i)));
+			}
+			assert(hash.size() == 1000 && max_bucket_size < 16);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+
+		SMD_LOG_INFO("TestHashRehash complete");
+	}
+
 private:
 
 	static std::string GetKey(int key) {
@@ -0,0 +1,112 @@
+﻿#pragma once
+#include <unordered_map>
+#include <smd.h>
+
+class TestIString {
+public:
+	TestIString() {
+		TestIStringPool();
+		TestIStringContainer();
+	}
+
+private:
+	void TestIStringPool() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto pool = smd::g_alloc->New<smd::shm_intern_pool>();
+
+		do {
+			// 相同的内容只有一份
+			auto a = pool->intern("Sword of the Ancient Dragon King");
+			auto b = pool->intern(std::string("Sword of the Ancient Dragon King"));
+			assert(a == b && a.data() == b.data() && a.use_count() == 2);
+			assert(pool->size() == 1);
+			assert(a.ToString() == "Sword of the Ancient Dragon King");
+			assert(a.hash() == std::hash<smd::shm_string>()(smd::shm_string(a.ToString())));
+
+			auto c = pool->intern("Shield");
+			assert(c != a && pool->size() == 2 && c.use_count() == 1);
+			assert(c < a && a > c && smd::compare(a, b) == 0);
+
+			// 拷贝和赋值只改变引用计数
+			smd::shm_istring d(c);
+			assert(d == c && c.use_count() == 2);
+			d = a;
+			assert(d == a && a.use_count() == 3 && c.use_count() == 1);
+
+			// 空字符串不放进池中
+			auto e = pool->intern("");
+			assert(e.empty() && e.size() == 0 && e.data()[0] == '\0' && e == smd::shm_istring());
+			assert(pool->size() == 2);
+
+			// 查找不会插入
+			assert(pool->find("Shield") == c);
+			assert(pool->find("Helmet").empty() && pool->size() == 2);
+
+			// 最后一个句柄释放时从池中删除
+			c.clear();
+			assert(pool->size() == 1 && pool->find("Shield").empty());
+			b.clear();
+			d.clear();
+			assert(a.use_count() == 1 && pool->size() == 1);
+		} while (false);
+		assert(pool->empty());
+
+		// 大量字符串，桶会扩容多次
+		std::vector<smd::shm_istring> handles;
+		for (int round = 0; round < 3; round++) {
+			for (int i = 0; i < 1000; i++) {
+				handles.push_back(pool->intern("item_name_" + std::to_string(i)));
+			}
+		}
+		assert(pool->size() == 1000);
+		for (int i = 0; i < 1000; i++) {
+			assert(handles[i] == handles[i + 1000] && handles[i] == handles[i + 2000]);
+			assert(handles[i].use_count() == 3 && handles[i].ToString() == "item_name_" + std::to_string(i));
+		}
+		handles.clear();
+		assert(pool->empty());
+
+		smd::g_alloc->Delete(pool);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestIStringPool complete");
+	}
+
+	// 作为容器的key和value
+	void TestIStringContainer() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto pool = smd::g_alloc->New<smd::shm_intern_pool>();
+
+		do {
+			smd::shm_map<smd::shm_istring, int> map;
+			smd::shm_unordered_map<smd::shm_istring, int> hash_map;
+			smd::shm_vector<smd::shm_istring> tags;
+			for (int i = 0; i < 100; i++) {
+				auto name = pool->intern("guild_" + std::to_string(i % 10));
+				auto it = map.find(name);
+				if (it == map.end()) {
+					map.insert(std::make_pair(name, 1));
+				} else {
+					it->second += 1;
+				}
+				hash_map[name] += 1;
+				tags.push_back(name);
+			}
+			assert(pool->size() == 10 && map.size() == 10 && hash_map.size() == 10);
+
+			auto key = pool->intern("guild_3");
+			assert(map.find(key)->second == 10 && hash_map.find(key)->second == 10);
+			assert(key.use_count() == 10 + 1 + 1 + 1);
+
+			// 按内容排序
+			auto it = map.begin();
+			for (int i = 0; i < 10; i++, ++it) {
+				assert(it->first.ToString() == "guild_" + std::to_string(i));
+			}
+		} while (false);
+		assert(pool->empty());
+
+		smd::g_alloc->Delete(pool);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestIStringContainer complete");
+	}
+};
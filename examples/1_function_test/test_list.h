@@ -8,9 +8,114 @@ public:
 		TestShmList();
 		TestListEqual();
 		TestShmListPod();
+		TestListEmplace();
+		TestListSplice();
 	}
 
 private:
+	std::vector<int> ToVector(smd::shm_list<int>& l) {
+		std::vector<int> v;
+		for (auto it = l.begin(); it != l.end(); ++it) {
+			v.push_back(*it);
+		}
+		assert(v.size() == l.size());
+		return v;
+	}
+
+	// 空链表不分配内存；splice/merge只改链接，不分配
+	void TestListSplice() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			auto malloc_count = smd::g_alloc->GetMallocCount();
+			smd::shm_list<int> a, b;
+			assert(smd::g_alloc->GetMallocCount() == malloc_count);
+
+			for (int i = 0; i < 10; i += 2) {
+				a.push_back(i);
+				b.push_back(i + 1);
+			}
+			malloc_count = smd::g_alloc->GetMallocCount();
+
+			// 整个链表
+			a.splice(a.end(), b);
+			assert(b.empty() && a.size() == 10);
+			assert(ToVector(a) == std::vector<int>({0, 2, 4, 6, 8, 1, 3, 5, 7, 9}));
+
+			// 单个节点：同一个链表内移动，以及移到另一个链表
+			auto it = a.begin();
+			++it;
+			a.splice(a.begin(), a, it);
+			assert(ToVector(a) == std::vector<int>({2, 0, 4, 6, 8, 1, 3, 5, 7, 9}));
+			a.splice(a.end(), a, a.begin());
+			assert(ToVector(a) == std::vector<int>({0, 4, 6, 8, 1, 3, 5, 7, 9, 2}));
+			b.splice(b.end(), a, a.begin());
+			assert(ToVector(b) == std::vector<int>({0}) && a.size() == 9);
+
+			// 区间：同一个链表内调整顺序，以及移到另一个链表
+			auto first = a.begin();
+			auto last = first;
+			for (int i = 0; i < 3; i++) {
+				++last;
+			}
+			a.splice(a.end(), a, first, last);
+			assert(ToVector(a) == std::vector<int>({1, 3, 5, 7, 9, 2, 4, 6, 8}));
+			first = a.begin();
+			for (int i = 0; i < 5; i++) {
+				++first;
+			}
+			b.splice(b.end(), a, first, a.end());
+			assert(ToVector(a) == std::vector<int>({1, 3, 5, 7, 9}));
+			assert(ToVector(b) == std::vector<int>({0, 2, 4, 6, 8}));
+
+			// 归并两个有序的链表
+			a.merge(b);
+			assert(b.empty());
+			assert(ToVector(a) == std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+			b.push_back(-1);
+			b.push_back(5);
+			b.push_back(20);
+			malloc_count = smd::g_alloc->GetMallocCount();
+			a.merge(b, [](int x, int y) { return x < y; });
+			assert(ToVector(a) == std::vector<int>({-1, 0, 1, 2, 3, 4, 5, 5, 6, 7, 8, 9, 20}));
+			assert(smd::g_alloc->GetMallocCount() == malloc_count);
+			assert(a.front() == -1 && a.back() == 20);
+
+			a.splice_front(a);
+			assert(a.size() == 13 && a.front() == -1);
+			a.pop_back();
+			a.erase(a.begin());
+			assert(a.size() == 11 && a.front() == 0 && a.back() == 9);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestListSplice complete");
+	}
+
+	// emplace直接在节点中构造，移动构造接管节点
+	void TestListEmplace() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_list<smd::shm_string> l;
+			const std::string long_str(64, 'l');
+			auto malloc_count = smd::g_alloc->GetMallocCount();
+			l.emplace_back(long_str);
+			l.emplace_front("front");
+			smd::shm_string s(long_str);
+			l.push_back(std::move(s));
+			assert(s.empty());
+			// 3个节点和2个长字符串
+			assert(smd::g_alloc->GetMallocCount() == malloc_count + 5);
+			assert(l.front() == "front" && l.back() == long_str && l.size() == 3);
+
+			smd::shm_list<smd::shm_string> l2(std::move(l));
+			assert(l.empty() && l2.size() == 3 && l2.front() == "front");
+			l.push_back(smd::shm_string("reuse"));
+			l = std::move(l2);
+			assert(l.size() == 3 && l2.empty());
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestListEmplace complete");
+	}
+
 	void TestShmList() {
 		auto mem_usage = smd::g_alloc->GetUsed();
 
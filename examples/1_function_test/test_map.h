@@ -9,9 +9,259 @@ public:
 	TestMap() {
 		TestMapPod();
 		TestMapString();
+		TestMapEmplace();
+		TestMapRange();
+		TestMapRank();
+		TestMapHint();
 	}
 
 private:
+	// lower_bound、upper_bound、equal_range和scan，和std::map对比
+	void TestMapRange() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_map<int64_t, int64_t> map;
+			std::map<int64_t, int64_t> ref;
+			for (int64_t i = 0; i < 2000; i += 4) {
+				map.insert(std::make_pair(i, i * 10));
+				ref.insert(std::make_pair(i, i * 10));
+			}
+
+			for (int64_t k = -3; k < 2004; k++) {
+				auto lb = map.lower_bound(k);
+				auto ref_lb = ref.lower_bound(k);
+				assert(lb == map.end() ? ref_lb == ref.end() : lb->first == ref_lb->first);
+
+				auto ub = map.upper_bound(k);
+				auto ref_ub = ref.upper_bound(k);
+				assert(ub == map.end() ? ref_ub == ref.end() : ub->first == ref_ub->first);
+
+				auto range = map.equal_range(k);
+				assert(range.first == lb && range.second == ub);
+				assert((range.first != range.second) == (ref.count(k) == 1));
+			}
+
+			// 区间是[from, to)，最多limit个
+			std::vector<int64_t> keys;
+			auto collect = [&](const int64_t& key, int64_t& value) {
+				assert(value == key * 10);
+				keys.push_back(key);
+			};
+			assert(map.scan(101, 121, size_t(-1), collect) == 5);
+			assert(keys == std::vector<int64_t>({104, 108, 112, 116, 120}));
+			keys.clear();
+			assert(map.scan(100, 120, 3, collect) == 3);
+			assert(keys == std::vector<int64_t>({100, 104, 108}));
+			keys.clear();
+			assert(map.scan(-100, 2000, size_t(-1), collect) == map.size());
+			assert(keys.size() == ref.size());
+			auto it_key = keys.begin();
+			for (auto& kv : ref) {
+				assert(*it_key++ == kv.first);
+			}
+			keys.clear();
+			assert(map.scan(1997, 5000, size_t(-1), collect) == 0 && map.scan(300, 200, size_t(-1), collect) == 0);
+			assert(map.scan(0, 2000, 0, collect) == 0);
+
+			// shm_string的key用Slice做边界
+			smd::shm_map<smd::shm_string, int> strings;
+			for (int i = 0; i < 100; i++) {
+				strings.insert(std::make_pair(smd::shm_string(smd::util::Text::Format("shard%03d", i)), i));
+			}
+			assert(strings.lower_bound(smd::Slice("shard0505"))->second == 51);
+			assert(strings.upper_bound(smd::Slice("shard050"))->second == 51);
+			assert(strings.equal_range(smd::Slice("shard050")).first->second == 50);
+			int sum = 0;
+			assert(strings.scan(smd::Slice("shard010"), smd::Slice("shard020"), size_t(-1),
+					   [&](const smd::shm_string&, int& v) { sum += v; }) == 10);
+			assert(sum == 145);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMapRange complete");
+	}
+
+	// 随机插入删除之后，rank、select、count_range和std::map上数出来的结果一致
+	void TestMapRank() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_rank_map<int64_t, int64_t> map;
+			std::map<int64_t, int64_t> ref;
+			const int COUNT = 2000;
+			for (int i = 0; i < COUNT * 4; i++) {
+				int64_t key = std::rand() % COUNT;
+				if (std::rand() % 3 != 0) {
+					assert((map.insert(std::make_pair(key, key)) != smd::shm_nullptr) == ref.insert(std::make_pair(key, key)).second);
+				} else {
+					assert(map.erase(key) == ref.erase(key));
+				}
+			}
+			assert(map.size() == ref.size());
+
+			size_t index = 0;
+			for (auto& kv : ref) {
+				assert(map.rank(kv.first) == index && map.select(index)->first == kv.first);
+				index++;
+			}
+			assert(map.select(ref.size()) == map.end());
+			for (int64_t k = -1; k <= COUNT; k++) {
+				assert(map.rank(k) == size_t(std::distance(ref.begin(), ref.lower_bound(k))));
+			}
+
+			for (int i = 0; i < 1000; i++) {
+				int64_t lo = std::rand() % COUNT;
+				int64_t hi = std::rand() % COUNT;
+				size_t expect = lo < hi ? std::distance(ref.lower_bound(lo), ref.lower_bound(hi)) : 0;
+				assert(map.count_range(lo, hi) == expect);
+				assert(map.count_range(lo, hi) == map.scan(lo, hi, size_t(-1), [](const int64_t&, int64_t&) {}));
+			}
+
+			// 按迭代器删除，拷贝出来的树计数也是对的
+			for (auto it = map.begin(); it != map.end();) {
+				if (it->first % 3 == 0) {
+					ref.erase(it->first);
+					it = map.erase(it);
+				} else {
+					++it;
+				}
+			}
+			smd::shm_rank_map<int64_t, int64_t> copy(map);
+			index = 0;
+			for (auto& kv : ref) {
+				assert(copy.select(index)->first == kv.first && map.rank(kv.first) == index);
+				index++;
+			}
+
+			smd::shm_rank_map<smd::shm_string, int> strings;
+			for (int i = 0; i < 100; i++) {
+				strings[smd::shm_string(smd::util::Text::Format("player%03d", i))] = i;
+			}
+			assert(strings.rank(smd::Slice("player050")) == 50 && strings.select(99)->second == 99);
+			assert(strings.count_range(smd::Slice("player010"), smd::Slice("player0205")) == 11);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMapRank complete");
+	}
+
+	// 带hint的find和try_emplace：hint可以在key之前、之后或者是end()，结果都和不带hint的一样
+	void TestMapHint() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_rank_map<int64_t, int64_t> map;
+			std::map<int64_t, int64_t> ref;
+			for (int round = 0; round < 50; round++) {
+				std::vector<int64_t> batch;
+				for (int i = 0; i < 100; i++) {
+					batch.push_back(std::rand() % 5000);
+				}
+				std::sort(batch.begin(), batch.end());
+				// 偶尔打乱，hint比key大时要从根开始找
+				if (round % 5 == 0) {
+					std::swap(batch.front(), batch.back());
+				}
+
+				auto hint = map.end();
+				for (auto key : batch) {
+					auto it = map.find(hint, key);
+					assert(it == map.end() ? ref.count(key) == 0 : it->first == key);
+					hint = map.try_emplace(hint, key, key * 2);
+					assert(hint->first == key && hint->second == ref.emplace(key, key * 2).first->second);
+				}
+			}
+			assert(map.size() == ref.size());
+			size_t index = 0;
+			for (auto& kv : ref) {
+				assert(map.select(index)->first == kv.first && map.rank(kv.first) == index);
+				index++;
+			}
+
+			// 批量查找，个数不是FIND_GROUP的整数倍，有重复也有不存在的key
+			std::vector<int64_t> keys;
+			for (int i = 0; i < 1000; i++) {
+				keys.push_back(std::rand() % 5100 - 50);
+			}
+			std::vector<int> visits(keys.size());
+			map.find_many(keys.data(), keys.size(), [&](size_t i, smd::shm_rank_map<int64_t, int64_t>::iterator it) {
+				visits[i]++;
+				assert(it == map.end() ? ref.count(keys[i]) == 0 : it->first == keys[i] && it->second == keys[i] * 2);
+			});
+			assert(std::count(visits.begin(), visits.end(), 1) == int(keys.size()));
+
+			// 按顺序批量查找：前一半是打乱的一段连续的key，从上一个的位置往后找；后一半是上面分散的key，改用find_many
+			for (int i = 0; i < 500; i++) {
+				keys[i] = 2000 + i;
+			}
+			std::reverse(keys.begin(), keys.begin() + 500);
+			for (size_t begin : {size_t(0), size_t(500)}) {
+				std::vector<size_t> order(500);
+				for (size_t i = 0; i < order.size(); i++) {
+					order[i] = begin + i;
+				}
+				std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+				std::fill(visits.begin(), visits.end(), 0);
+				map.find_sorted(keys.data(), order.data(), order.size(), [&](size_t i, smd::shm_rank_map<int64_t, int64_t>::iterator it) {
+					visits[i]++;
+					assert(it == map.end() ? ref.count(keys[i]) == 0 : it->first == keys[i] && it->second == keys[i] * 2);
+				});
+				assert(std::count(visits.begin() + begin, visits.begin() + begin + 500, 1) == 500);
+			}
+
+			smd::shm_map<smd::shm_string, int> strings;
+			auto hint = strings.end();
+			for (int i = 0; i < 100; i++) {
+				auto key = smd::util::Text::Format("key%03d", i);
+				hint = strings.try_emplace(hint, smd::Slice(key), i);
+			}
+			assert(strings.size() == 100 && strings.find(strings.begin(), smd::Slice("key050"))->second == 50);
+			assert(strings.find(strings.find(smd::Slice("key099")), smd::Slice("key000"))->second == 0);
+			assert(strings.find(hint, smd::Slice("key100")) == strings.end());
+			assert(!strings.try_emplace(smd::Slice("key001"), 1000).second && strings[smd::shm_string("key001")] == 1);
+			smd::Slice slices[] = {"key007", "key100", "key042"};
+			int sum = 0;
+			strings.find_many(slices, 3, [&](size_t, smd::shm_map<smd::shm_string, int>::iterator it) {
+				sum += it != strings.end() ? it->second : 1000;
+			});
+			assert(sum == 1049);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMapHint complete");
+	}
+
+	// try_emplace、emplace、右值insert和移动构造
+	void TestMapEmplace() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_map<int64_t, smd::shm_string> map;
+			auto res = map.try_emplace(1, "hello world", 5);
+			assert(res.second && res.first->second == "hello");
+			res = map.try_emplace(1, "other", 5);
+			assert(!res.second && res.first->second == "hello");
+
+			smd::shm_string v(std::string(64, 'v'));
+			assert(map.insert(std::make_pair(int64_t(2), std::move(v))) != smd::shm_nullptr && v.empty());
+			assert(map.find(2)->second.size() == 64);
+
+			assert(map.emplace(3, "three").second);
+			assert(!map.emplace(3, "again").second && map.find(3)->second == "three");
+			map[4].append("four");
+			assert(map[4] == "four" && map.size() == 4);
+
+			smd::shm_map<smd::shm_string, smd::shm_string> strings;
+			const std::string long_str(64, 'm');
+			auto malloc_count = smd::g_alloc->GetMallocCount();
+			strings.try_emplace(smd::shm_string(long_str), long_str);
+			// 一个节点和两个长字符串
+			assert(smd::g_alloc->GetMallocCount() == malloc_count + 3);
+			assert(strings.find(long_str)->second == long_str);
+
+			auto map2(std::move(map));
+			assert(map.size() == 0 && map2.size() == 4);
+			map = std::move(map2);
+			assert(map.size() == 4 && map2.size() == 0 && map.find(1)->second == "hello");
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestMapEmplace complete");
+	}
+
 	void TestMapString() {
 		auto mem_usage = smd::g_alloc->GetUsed();
 		auto obj = smd::g_alloc->New<smd::shm_map<smd::shm_string, smd::shm_string>>().Ptr();
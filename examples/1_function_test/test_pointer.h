@@ -9,6 +9,8 @@ public:
 		TestNewDelete();
 		TestArrayPointer();
 		TestPointerToObject();
+		TestSmallObject();
+		TestBlockSize();
 	}
 
 private:
@@ -144,4 +146,94 @@ private:
 		assert(mem_usage == smd::g_alloc->GetUsed());
 		SMD_LOG_INFO("TestPointer complete");
 	}
+
+	// 小块内存的分配与回收
+	void TestSmallObject() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		const int COUNT = 1000;
+
+		// 不同大小的小块内存互不干扰
+		std::vector<smd::shm_pointer<char>> ptrs;
+		for (int i = 0; i < COUNT; i++) {
+			size_t size = 1 + i % smd::Alloc::SLAB_MAX_SIZE;
+			auto p = smd::g_alloc->Malloc<char>(size);
+			assert(p != smd::shm_nullptr);
+			memset(p.Ptr(), i & 0xff, size);
+			ptrs.push_back(p);
+		}
+
+		for (int i = 0; i < COUNT; i++) {
+			size_t size = 1 + i % smd::Alloc::SLAB_MAX_SIZE;
+			auto p = ptrs[i].Ptr();
+			for (size_t j = 0; j < size; j++) {
+				assert(p[j] == char(i & 0xff));
+			}
+		}
+
+		// 回收之后，同样大小的内存会优先复用刚回收的块
+		auto last = ptrs.back();
+		size_t last_size = 1 + (COUNT - 1) % smd::Alloc::SLAB_MAX_SIZE;
+		for (int i = 0; i < COUNT; i++) {
+			size_t size = 1 + i % smd::Alloc::SLAB_MAX_SIZE;
+			smd::g_alloc->Free(ptrs[i], size);
+			assert(ptrs[i] == smd::shm_nullptr);
+		}
+
+		auto p = smd::g_alloc->Malloc<char>(last_size);
+		assert(p == last);
+		smd::g_alloc->Free(p, last_size);
+
+		// 页里的块全部回收之后还给伙伴系统，每个规格最多留下一页空页
+		if (smd::g_alloc->IsSlabEnabled()) {
+			const size_t SIZE = 200;
+			const size_t PER_PAGE = (smd::Alloc::SLAB_PAGE_SIZE - smd::Alloc::SLAB_PAGE_HEAD) / 224;
+			auto pages = smd::g_alloc->GetSlabPages();
+			auto committed = smd::g_alloc->GetCommitted();
+			for (int i = 0; i < COUNT; i++) {
+				ptrs[i] = smd::g_alloc->Malloc<char>(SIZE);
+				assert(smd::g_alloc->GetBlockSize(ptrs[i]) == 224);
+			}
+			assert(smd::g_alloc->GetSlabPages() >= pages + COUNT / PER_PAGE);
+
+			// 隔一个回收一个，页都还没有空；再回收剩下的
+			for (int i = 0; i < COUNT; i += 2) {
+				smd::g_alloc->Free(ptrs[i], SIZE);
+			}
+			assert(smd::g_alloc->GetSlabPages() >= pages + COUNT / PER_PAGE);
+			for (int i = 1; i < COUNT; i += 2) {
+				smd::g_alloc->Free(ptrs[i], SIZE);
+			}
+			assert(smd::g_alloc->GetSlabPages() <= pages + 1);
+			assert(smd::g_alloc->GetCommitted() == committed);
+		}
+
+		// 没有内存泄露
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestSmallObject complete");
+	}
+
+	// 块的实际大小以及占用的统计
+	void TestBlockSize() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto committed = smd::g_alloc->GetCommitted();
+
+		// 小块内存按规格向上取整
+		auto small = smd::g_alloc->Malloc<char>(100);
+		assert(smd::g_alloc->GetBlockSize(small) == (smd::g_alloc->IsSlabEnabled() ? 112 : 128));
+
+		// 伙伴系统的块按2的幂向上取整
+		auto large = smd::g_alloc->Malloc<char>(5000);
+		assert(smd::g_alloc->GetBlockSize(large) == 8192);
+		assert(smd::g_alloc->GetCommitted() == committed + smd::g_alloc->GetBlockSize(small) + 8192);
+		assert(smd::g_alloc->GetUsed() == mem_usage + 5100);
+
+		// 整块都会被回收
+		smd::g_alloc->Free(small, 100);
+		smd::g_alloc->Free(large, 5000);
+		assert(smd::g_alloc->GetCommitted() == committed);
+
+		// 没有内存泄露
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestBlockSize complete");
+	}
 };
@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <vector>
+#include <smd.h>
+
+class TestSegment {
+public:
+	TestSegment() {
+		TestGrowSegment();
+		TestContainerAcrossSegments();
+	}
+
+private:
+	// 第0段放不下的时候自动创建新的段
+	void TestGrowSegment() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		const size_t BLOCK_SIZE = 1 << 20;
+
+		// 比第0段的存储区还大的块只能放在新的段里
+		auto big = smd::g_alloc->Malloc<char>(size_t(1) << 26);
+		assert(big != smd::shm_nullptr);
+		assert((big.Raw() >> smd::SHM_SEGMENT_SHIFT) > 0);
+		assert(smd::g_alloc->GetSegmentNum() > 1);
+		big.Ptr()[(size_t(1) << 26) - 1] = 1;
+
+		// 把第0段填满，后面的块会落在其他段
+		std::vector<smd::shm_pointer<char>> blocks;
+		for (int i = 0; i < 64; i++) {
+			auto p = smd::g_alloc->Malloc<char>(BLOCK_SIZE);
+			assert(p != smd::shm_nullptr);
+			memset(p.Ptr(), i, BLOCK_SIZE);
+			blocks.push_back(p);
+		}
+
+		for (int i = 0; i < 64; i++) {
+			auto p = blocks[i].Ptr();
+			assert(p[0] == char(i) && p[BLOCK_SIZE - 1] == char(i));
+
+			// 原始指针和共享内存指针可以互相转换
+			assert(smd::g_alloc->ToShmPointer<char>(p) == blocks[i]);
+		}
+
+		for (auto& p : blocks) {
+			smd::g_alloc->Free(p, BLOCK_SIZE);
+		}
+		smd::g_alloc->Free(big, size_t(1) << 26);
+
+		// 没有内存泄露
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestGrowSegment complete, segments:%u", smd::g_alloc->GetSegmentNum());
+	}
+
+	// 容器的节点分布在不同的段中
+	void TestContainerAcrossSegments() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		// 先占住第0段，容器的节点只能分配在其他段
+		std::vector<smd::shm_pointer<char>> blocks;
+		for (;;) {
+			auto p = smd::g_alloc->Malloc<char>(1 << 20);
+			blocks.push_back(p);
+			if ((p.Raw() >> smd::SHM_SEGMENT_SHIFT) > 0)
+				break;
+		}
+
+		auto obj = smd::g_alloc->New<smd::shm_map<smd::shm_string, smd::shm_string>>();
+		for (int i = 0; i < 1000; i++) {
+			obj->insert(std::make_pair(smd::shm_string(std::to_string(i)), smd::shm_string(std::to_string(i * 10))));
+		}
+		for (int i = 0; i < 1000; i++) {
+			assert(obj->find(smd::shm_string(std::to_string(i)))->second.ToString() == std::to_string(i * 10));
+		}
+		smd::g_alloc->Delete(obj);
+
+		for (auto& p : blocks) {
+			smd::g_alloc->Free(p, 1 << 20);
+		}
+
+		// 没有内存泄露
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestContainerAcrossSegments complete");
+	}
+};
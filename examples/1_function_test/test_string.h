@@ -5,9 +5,44 @@ class TestString {
 public:
 	TestString() {
 		TestShmString();
+		TestTransparentLookup();
+		TestStringHash();
+		TestStringSso();
+		TestStringMove();
 	}
 
 private:
+	// 移动只转移所有权，不分配
+	void TestStringMove() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			const std::string long_str(100, 'x');
+			smd::shm_string l(long_str);
+			smd::shm_string s("short");
+			auto malloc_count = smd::g_alloc->GetMallocCount();
+			const char* long_data = l.data();
+
+			smd::shm_string l2(std::move(l));
+			assert(l2.data() == long_data && l2.ToString() == long_str);
+			assert(l.empty() && l.is_inline());
+
+			smd::shm_string s2(std::move(s));
+			assert(s2.ToString() == "short" && s.empty());
+
+			s2 = std::move(l2);
+			assert(s2.data() == long_data && l2.empty());
+			l2 = std::move(s2);
+			assert(l2.ToString() == long_str && s2.empty());
+			assert(smd::g_alloc->GetMallocCount() == malloc_count);
+
+			// 移动之后的对象可以继续使用
+			l.assign("reuse");
+			assert(l.ToString() == "reuse");
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestStringMove complete");
+	}
+
 	void TestShmString() {
 		auto mem_usage = smd::g_alloc->GetUsed();
 		auto s = smd::g_alloc->New<smd::shm_string>();
@@ -74,4 +109,213 @@ private:
 
 		SMD_LOG_INFO("TestShmString complete");
 	}
+
+	// 用Slice、std::string、std::string_view、const char*直接查找，不构造shm_string
+	template <class Container>
+	void CheckLookup(Container& c) {
+		std::string key = "key7";
+		std::string_view view(key);
+		smd::Slice slice(key);
+
+		auto malloc_count = smd::g_alloc->GetMallocCount();
+		assert(c.find(slice) != c.end());
+		assert(c.find(key) != c.end());
+		assert(c.find(view) != c.end());
+		assert(c.find("key7") != c.end());
+		assert(c.find(smd::Slice("key")) == c.end());
+		assert(c.find("key100") == c.end());
+		assert(c.count(view) == 1 && c.count("nothing") == 0);
+		assert(smd::g_alloc->GetMallocCount() == malloc_count);
+
+		// 查找和转换成shm_string之后的结果一致
+		assert(c.find(smd::shm_string(key)) == c.find(slice));
+
+		assert(c.erase(slice) == 1);
+		assert(c.erase("key7") == 0);
+		assert(c.find(view) == c.end());
+		assert(c.erase(std::string("key8")) == 1);
+		assert(c.size() == 8);
+	}
+
+	void TestTransparentLookup() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		// 各种类型的结果一致
+		std::hash<smd::shm_string> hasher;
+		assert(hasher(smd::shm_string("hello")) == smd::BytesHash::Hash("hello", 5));
+		assert(hasher(smd::Slice("hello")) == hasher("hello"));
+		assert(hasher(std::string_view("hello")) == hasher(std::string("hello")));
+
+		{
+			smd::shm_string s("hello");
+			assert(s == smd::Slice("hello") && smd::Slice("hello") == s);
+			assert(s == "hello" && "hell" != s);
+			assert(s == std::string("hello") && std::string("hello!") != s);
+			assert(smd::compare(smd::Slice("hell"), s) < 0 && smd::compare(smd::Slice("help"), s) > 0);
+			assert(smd::compare(smd::Slice("hello"), s) == 0);
+		}
+
+		{
+			smd::shm_map<smd::shm_string, smd::shm_string> map;
+			smd::shm_unordered_map<smd::shm_string, smd::shm_string> unordered_map;
+			smd::shm_flat_hash_map<smd::shm_string, smd::shm_string> flat_map;
+			smd::shm_hash<smd::shm_string> hash_set;
+			smd::shm_flat_hash_set<smd::shm_string> flat_set;
+			for (int i = 0; i < 10; i++) {
+				smd::shm_string key("key" + std::to_string(i));
+				smd::shm_string value(std::to_string(i));
+				map.insert(std::make_pair(key, value));
+				unordered_map.insert(std::make_pair(key, value));
+				flat_map.insert(std::make_pair(key, value));
+				hash_set.insert(key);
+				flat_set.insert(key);
+			}
+			assert(map.find("key3")->second == "3");
+			assert(unordered_map.find(smd::Slice("key3"))->second == "3");
+			assert(flat_map.find(std::string_view("key3"))->second == "3");
+
+			CheckLookup(map);
+			CheckLookup(unordered_map);
+			CheckLookup(flat_map);
+			CheckLookup(hash_set);
+			CheckLookup(flat_set);
+		}
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestTransparentLookup complete");
+	}
+
+	// 缓存的哈希值在内容修改之后失效
+	void TestStringHash() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+
+		// 只有shm_hashed_string多占缓存哈希值的8字节
+		static_assert(sizeof(smd::shm_string) == 32, "shm_string size");
+		static_assert(sizeof(smd::shm_hashed_string) == 40, "shm_hashed_string size");
+
+		// 不同长度走的是不同的分支
+		for (size_t len = 0; len <= 200; len++) {
+			std::string str(len, 'a');
+			for (size_t i = 0; i < len; i++) {
+				str[i] = char('a' + (i * 7 + len) % 26);
+			}
+
+			smd::shm_string s(str);
+			assert(s.hash() == smd::BytesHash::Hash(str.data(), str.size()));
+			if (len > 0) {
+				// 改动任何一个字节结果都不同
+				std::string other = str;
+				other[len / 2] ^= 1;
+				assert(s.hash() != smd::BytesHash::Hash(other.data(), other.size()));
+			}
+		}
+
+		{
+			smd::shm_hashed_string s("hello");
+			auto h = s.hash();
+			assert(h == std::hash<smd::shm_hashed_string>()(s) && h == std::hash<smd::shm_string>()(smd::Slice("hello")));
+
+			smd::shm_hashed_string t(s);
+			assert(t.hash() == h);
+
+			s.assign("world");
+			assert(s.hash() == smd::BytesHash::Hash("world", 5));
+
+			s.append("!");
+			assert(s == "world!" && s.hash() == std::hash<smd::shm_hashed_string>()(std::string("world!")));
+
+			s = t;
+			assert(s.hash() == h);
+
+			s.data()[0] = 'j';
+			assert(s == "jello" && s.hash() == smd::BytesHash::Hash("jello", 5));
+
+			s.clear();
+			assert(s.hash() == smd::BytesHash::Hash("", 0));
+		}
+
+		// 哈希值正好是0时换成非0的值，不会每次都重新计算，和其他类型算出来的一致
+		{
+			typedef smd::ShmStringHash<true> cached;
+			assert(cached::fix_hash(0) != 0 && cached::fix_hash(12345) == 12345);
+			assert(smd::ShmStringHash<false>::fix_hash(0) == 0);
+			smd::shm_hashed_string s("zero");
+			assert(s.hash() == std::hash<smd::shm_hashed_string>()(smd::Slice("zero")));
+		}
+
+		// 缓存的哈希值和shm_hash扩容、迁移配合
+		{
+			smd::shm_hash<smd::shm_hashed_string> set;
+			for (int i = 0; i < 1000; i++) {
+				set.insert(smd::shm_hashed_string("hash_key_" + std::to_string(i)));
+			}
+			for (int i = 0; i < 1000; i++) {
+				assert(set.find(smd::Slice("hash_key_" + std::to_string(i))) != set.end());
+			}
+			assert(set.find("hash_key_1000") == set.end());
+		}
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestStringHash complete");
+	}
+
+	// 短字符串放在对象内部，不分配共享内存
+	void TestStringSso() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto malloc_count = smd::g_alloc->GetMallocCount();
+
+		const std::string short_str(smd::shm_string::SSO_CAPACITY, 's');
+		const std::string long_str(smd::shm_string::SSO_CAPACITY + 1, 'l');
+		{
+			smd::shm_string empty;
+			assert(empty.is_inline() && empty.empty() && empty.data()[0] == '\0');
+
+			smd::shm_string s(short_str);
+			assert(s.is_inline() && s.ToString() == short_str && s.data()[s.size()] == '\0');
+			assert((const void*)s.data() >= (const void*)&s && (const void*)s.data() < (const void*)(&s + 1));
+
+			smd::shm_string t(s);
+			assert(t.is_inline() && t == s);
+			t = "2026-10-18-10-00-00";
+			s = t;
+			assert(s.ToString() == "2026-10-18-10-00-00");
+			assert(smd::g_alloc->GetMallocCount() == malloc_count);
+
+			// 超过内部缓冲区之后才分配
+			smd::shm_string l(long_str);
+			assert(!l.is_inline() && l.ToString() == long_str && l.capacity() > long_str.size());
+			assert(smd::g_alloc->GetMallocCount() == malloc_count + 1);
+
+			// 内部和外部的字符串互相赋值
+			s = l;
+			assert(!s.is_inline() && s == l);
+			l = t;
+			assert(l.is_inline() && l == t);
+
+			// 追加时保留原来的内容，跨过内部缓冲区的大小
+			smd::shm_string a("0123456789");
+			std::string r("0123456789");
+			for (int i = 0; i < 20; i++) {
+				a.append("abcdef");
+				r.append("abcdef");
+				assert(a.ToString() == r && a.size() == r.size());
+			}
+			assert(!a.is_inline());
+
+			// 变短之后释放分配的内存
+			a.assign("short");
+			assert(a.is_inline() && a.ToString() == "short");
+			s.clear();
+			assert(s.is_inline() && s.empty());
+
+			// 预留容量
+			smd::shm_string reserved(100);
+			assert(!reserved.is_inline() && reserved.empty() && reserved.capacity() > 100);
+			reserved.append(long_str);
+			assert(reserved.ToString() == long_str);
+		}
+
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestStringSso complete");
+	}
 };
@@ -0,0 +1,92 @@
+﻿#pragma once
+#include <map>
+#include <cstdlib>
+#include <smd.h>
+
+class TestTimerWheel {
+public:
+	TestTimerWheel() {
+		TestTimerWheelRandom();
+		TestTimerWheelCatchUp();
+	}
+
+private:
+	// 随机的到期时间和随机的步长，每个元素都在第一次advance越过它的到期时间时触发
+	// 中间随机删除一些元素、修改一些元素的到期时间，删掉的不再触发，改过的按新的时间触发
+	void TestTimerWheelRandom() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_timer_wheel<int64_t> wheel;
+			std::map<int64_t, int64_t> deadlines;
+			std::map<int64_t, smd::shm_timer_wheel<int64_t>::node_ptr> nodes;
+			int64_t now = 1000000;
+			int64_t id = 0;
+			for (int round = 0; round < 2000; round++) {
+				for (int i = std::rand() % 20; i > 0; i--) {
+					// 跨越各层，也有已经过期的
+					int64_t delta = int64_t(std::rand()) % (int64_t(1) << (std::rand() % 24)) - 10;
+					nodes[id] = wheel.add(now, now + delta, id);
+					deadlines[id++] = now + delta;
+				}
+
+				for (int i = std::rand() % 4; i > 0 && !deadlines.empty(); i--) {
+					auto it = deadlines.lower_bound(std::rand() % id);
+					if (it == deadlines.end()) {
+						continue;
+					}
+					if (std::rand() % 2) {
+						wheel.remove(nodes[it->first]);
+						nodes.erase(it->first);
+						deadlines.erase(it);
+					} else {
+						it->second = now + int64_t(std::rand()) % (int64_t(1) << (std::rand() % 24)) - 10;
+						wheel.update(nodes[it->first], it->second);
+					}
+				}
+
+				// 加入时已经过期的在下一个时刻处理，时间至少要走一步
+				now += 1 + (std::rand() % 3 == 0 ? std::rand() % 100000 : std::rand() % 100);
+				size_t expect = 0;
+				for (auto& kv : deadlines) {
+					expect += kv.second <= now ? 1 : 0;
+				}
+
+				// 触发的都已经到期，个数和到期的一样多，就说明到期的一个不落
+				size_t fired = wheel.advance(now, [&](int64_t deadline, int64_t& value) {
+					auto it = deadlines.find(value);
+					assert(it != deadlines.end() && it->second == deadline && deadline <= now);
+					deadlines.erase(it);
+					nodes.erase(value);
+				});
+				assert(fired == expect && wheel.size() == deadlines.size());
+			}
+			wheel.clear();
+			assert(wheel.empty());
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestTimerWheelRandom complete");
+	}
+
+	// 超出最高层的时间，以及很久没有advance之后一次补上
+	void TestTimerWheelCatchUp() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_timer_wheel<smd::shm_string> wheel;
+			const int64_t now = 1700000000000;
+			const int64_t far = smd::shm_timer_wheel<smd::shm_string>::MAX_DELTA * 3;
+			wheel.add(now, now + far, "far");
+			wheel.add(now, now + 86400000, "day");
+			wheel.add(now, now + 5, "soon");
+
+			std::vector<std::string> fired;
+			auto collect = [&](int64_t, smd::shm_string& value) { fired.push_back(value.ToString()); };
+			assert(wheel.advance(now + 4, collect) == 0);
+			assert(wheel.advance(now + 86400000 - 1, collect) == 1 && fired.back() == "soon");
+			assert(wheel.advance(now + 86400000, collect) == 1 && fired.back() == "day");
+			assert(wheel.advance(now + far - 1, collect) == 0 && wheel.size() == 1);
+			assert(wheel.advance(now + far, collect) == 1 && fired.back() == "far" && wheel.empty());
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestTimerWheelCatchUp complete");
+	}
+};
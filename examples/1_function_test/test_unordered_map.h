@@ -0,0 +1,157 @@
+﻿#pragma once
+#include <unordered_map>
+#include <algorithm>
+#include <smd.h>
+
+class TestUnorderedMap {
+public:
+	TestUnorderedMap() {
+		TestUnorderedMapPod();
+		TestUnorderedMapString();
+		TestUnorderedMapNested();
+	}
+
+private:
+	void TestUnorderedMapPod() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_unordered_map<int64_t, int64_t>>();
+		std::unordered_map<int64_t, int64_t> ref;
+
+		std::vector<int64_t> vRoleIds;
+		const int64_t COUNT = 1000;
+		for (int64_t i = 0; i < COUNT; i++) {
+			vRoleIds.push_back(i);
+		}
+
+		std::default_random_engine generator{std::random_device{}()};
+		std::shuffle(vRoleIds.begin(), vRoleIds.end(), generator);
+
+		// 扩容之后，之前拿到的引用依然有效
+		auto& first = obj->try_emplace(-1, -10).first->second;
+		for (size_t i = 0; i < vRoleIds.size(); i++) {
+			const auto& role_id = vRoleIds[i];
+			auto res = obj->insert(std::make_pair(role_id, role_id * 10));
+			assert(res.second && res.first->second == role_id * 10);
+			ref.insert(std::make_pair(role_id, role_id * 10));
+
+			res = obj->insert(std::make_pair(role_id, int64_t(0)));
+			assert(!res.second && res.first->second == role_id * 10);
+		}
+		assert(first == -10);
+		assert(obj->erase(-1) == 1);
+
+		assert(obj->size() == size_t(COUNT));
+		assert(obj->load_factor() <= obj->max_load_factor());
+		assert(IsEqual(*obj, ref));
+
+		// operator[]、emplace、try_emplace
+		(*obj)[COUNT] = 7;
+		assert(obj->at(COUNT) == 7);
+		assert(!obj->emplace(COUNT, 8).second);
+		assert(!obj->try_emplace(COUNT, 9).second);
+		assert(obj->find(COUNT)->second == 7);
+		assert(obj->erase(COUNT) == 1);
+		assert(obj->count(COUNT) == 0);
+
+		do {
+			smd::shm_unordered_map<int64_t, int64_t> copy(*obj);
+			assert(IsEqual(copy, ref));
+			copy = smd::shm_unordered_map<int64_t, int64_t>();
+			assert(copy.empty());
+		} while (false);
+
+		// 边遍历边删除
+		for (auto it = obj->begin(); it != obj->end();) {
+			if (it->first % 2 == 0) {
+				ref.erase(it->first);
+				it = obj->erase(it);
+			} else {
+				++it;
+			}
+		}
+		assert(IsEqual(*obj, ref));
+
+		for (auto& pair : ref) {
+			assert(obj->erase(pair.first) == 1);
+		}
+		assert(obj->empty() && obj->begin() == obj->end());
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestUnorderedMapPod complete");
+	}
+
+	void TestUnorderedMapString() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_unordered_map<smd::shm_string, smd::shm_string>>(64);
+		std::unordered_map<std::string, std::string> ref;
+
+		const int COUNT = 1000;
+		for (int i = 0; i < COUNT; i++) {
+			auto key = smd::util::Text::Format("Key%05d", i);
+			auto value = smd::util::Text::Format("Value%05d", i);
+			obj->insert(std::make_pair(smd::shm_string(key), smd::shm_string(value)));
+			ref.insert(std::make_pair(key, value));
+		}
+		assert(obj->size() == ref.size());
+
+		const auto& const_obj = *obj;
+		size_t n = 0;
+		for (auto it = const_obj.begin(); it != const_obj.end(); ++it) {
+			assert(ref[it->first.ToString()] == it->second.ToString());
+			n++;
+		}
+		assert(n == ref.size());
+
+		obj->clear();
+		assert(obj->empty());
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestUnorderedMapString complete");
+	}
+
+	// 值本身也是容器，和shm_map<int64_t, Player>的用法一样
+	void TestUnorderedMapNested() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto obj = smd::g_alloc->New<smd::shm_unordered_map<int64_t, smd::shm_map<int64_t, smd::shm_string>>>();
+
+		for (int64_t i = 0; i < 100; i++) {
+			auto& items = (*obj)[i];
+			for (int64_t j = 0; j < i % 10; j++) {
+				items.insert(std::make_pair(j, smd::shm_string(smd::util::Text::Format("Item%03d", j))));
+			}
+		}
+
+		for (int64_t i = 0; i < 100; i++) {
+			auto it = obj->find(i);
+			assert(it != obj->end());
+			assert(it->second.size() == size_t(i % 10));
+		}
+
+		smd::g_alloc->Delete(obj);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestUnorderedMapNested complete");
+	}
+
+private:
+	static bool IsEqual(smd::shm_unordered_map<int64_t, int64_t>& l, const std::unordered_map<int64_t, int64_t>& r) {
+		if (l.size() != r.size()) {
+			assert(false);
+			return false;
+		}
+
+		for (auto& pair : r) {
+			auto it = l.find(pair.first);
+			if (it == l.end() || it->second != pair.second) {
+				assert(false);
+				return false;
+			}
+		}
+
+		size_t n = 0;
+		for (auto it = l.begin(); it != l.end(); ++it) {
+			n++;
+		}
+		return n == r.size();
+	}
+};
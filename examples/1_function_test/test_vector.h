@@ -7,9 +7,46 @@ public:
 		TestShmVector();
 		TestShmVectorResize();
 		TestShmVectorPod();
+		TestShmVectorInsertErase();
+		TestShmVectorPodRelocate();
+		TestShmVectorMove();
 	}
 
 private:
+	// 移动构造和赋值接管存储，push_back右值移动元素
+	void TestShmVectorMove() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_vector<smd::shm_string> v;
+			v.reserve(10);
+			const std::string long_str(64, 'v');
+			auto malloc_count = smd::g_alloc->GetMallocCount();
+			for (int i = 0; i < 10; i++) {
+				smd::shm_string s(long_str);
+				v.push_back(std::move(s));
+				assert(s.empty());
+			}
+			// 每个元素只分配了一次
+			assert(smd::g_alloc->GetMallocCount() == malloc_count + 10);
+
+			const auto* data = v.data();
+			smd::shm_vector<smd::shm_string> v2(std::move(v));
+			assert(v2.data() == data && v2.size() == 10 && v.empty());
+
+			v = std::move(v2);
+			assert(v.data() == data && v2.empty());
+			assert(smd::g_alloc->GetMallocCount() == malloc_count + 10);
+
+			v2.emplace_back("after move");
+			assert(v2.size() == 1 && v2[0] == "after move");
+			for (auto& s : v) {
+				assert(s.ToString() == long_str);
+			}
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestShmVectorMove complete");
+	}
+
 	void TestShmVector() {
 		auto mem_usage = smd::g_alloc->GetUsed();
 		auto v = smd::g_alloc->New<smd::shm_vector<smd::shm_string>>();
@@ -122,6 +159,111 @@ private:
 		SMD_LOG_INFO("TestShmVectorPod complete");
 	}
 
+	void TestShmVectorInsertErase() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto v = smd::g_alloc->New<smd::shm_vector<smd::shm_string>>();
+		std::vector<std::string> r;
+
+		for (int i = 0; i < 10; ++i) {
+			auto& element = v->emplace_back(smd::util::Text::Format("TestText%02d", i));
+			assert(element.ToString() == smd::util::Text::Format("TestText%02d", i));
+			r.emplace_back(smd::util::Text::Format("TestText%02d", i));
+		}
+		IsEqual(*v, r);
+
+		// 头部、中间、尾部插入
+		v->insert(v->begin(), smd::shm_string("head"));
+		r.insert(r.begin(), "head");
+		v->insert(v->begin() + 5, 3, smd::shm_string("mid"));
+		r.insert(r.begin() + 5, 3, "mid");
+		v->insert(v->end(), smd::shm_string("tail"));
+		r.insert(r.end(), "tail");
+		IsEqual(*v, r);
+
+		// 插入自己的元素
+		v->insert(v->begin() + 2, (*v)[0]);
+		r.insert(r.begin() + 2, r[0]);
+		IsEqual(*v, r);
+
+		// 插入一个区间，插入位置之后的元素比区间短
+		std::vector<smd::shm_string> range;
+		for (int i = 0; i < 5; ++i) {
+			range.emplace_back(smd::util::Text::Format("Range%02d", i));
+			r.insert(r.end() - 1, smd::util::Text::Format("Range%02d", i));
+		}
+		auto it = v->insert(v->end() - 1, range.begin(), range.end());
+		assert(it->ToString() == "Range00");
+		IsEqual(*v, r);
+
+		// 删除单个元素和区间
+		it = v->erase(v->begin());
+		r.erase(r.begin());
+		assert(*it == r[0]);
+		it = v->erase(v->begin() + 3, v->begin() + 8);
+		r.erase(r.begin() + 3, r.begin() + 8);
+		assert(*it == r[3]);
+		v->erase(v->end() - 1);
+		r.erase(r.end() - 1);
+		IsEqual(*v, r);
+
+		size_t n = 0;
+		for (auto& element : *v) {
+			assert(element == r[n]);
+			n++;
+		}
+		assert(n == r.size());
+
+		v->erase(v->begin(), v->end());
+		assert(v->empty());
+		v->shrink_to_fit();
+		assert(v->capacity() == 0);
+
+		range.clear();
+		smd::g_alloc->Delete(v);
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestShmVectorInsertErase complete");
+	}
+
+	void TestShmVectorPodRelocate() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		auto v = smd::g_alloc->New<smd::shm_vector<uint64_t>>();
+
+		// 扩容时按2倍增长，内容原样搬过去
+		for (uint64_t i = 0; i < 1000; i++) {
+			v->push_back(i);
+			assert(v->capacity() >= v->size());
+			assert((v->capacity() & (v->capacity() - 1)) == 0);
+		}
+		assert(v->capacity() == 1024);
+
+		uint64_t* data = v->data();
+		for (uint64_t i = 0; i < 1000; i++) {
+			assert(data[i] == i);
+		}
+
+		v->insert(v->begin() + 10, 100, 7);
+		assert(v->size() == 1100);
+		assert((*v)[9] == 9 && (*v)[10] == 7 && (*v)[109] == 7 && (*v)[110] == 10);
+		v->erase(v->begin() + 10, v->begin() + 110);
+		for (uint64_t i = 0; i < 1000; i++) {
+			assert((*v)[i] == i);
+		}
+
+		v->resize(10);
+		assert(v->size() == 10 && v->back() == 9);
+		v->shrink_to_fit();
+		assert(v->capacity() == 10);
+		v->resize(20);
+		assert(v->size() == 20 && (*v)[19] == 0);
+
+		smd::shm_vector<uint64_t> v1(*v);
+		assert(v1.size() == 20 && v1[9] == 9);
+
+		smd::g_alloc->Delete(v);
+		assert(mem_usage + v1.capacity() * sizeof(uint64_t) == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestShmVectorPodRelocate complete");
+	}
+
 private:
 	//测试专用
 	bool IsEqual(smd::shm_vector<smd::shm_string>& l, const std::vector<std::string>& r) {
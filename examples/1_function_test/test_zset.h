@@ -0,0 +1,143 @@
+﻿#pragma once
+#include <map>
+#include <set>
+#include <string>
+#include <cstdlib>
+#include <smd.h>
+
+class TestZSet {
+public:
+	TestZSet(smd::SmdEnv* env) {
+		TestZSetCommands();
+		TestZSetRandom();
+		TestZSetEnv(env);
+	}
+
+private:
+	void TestZSetCommands() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_zset zset;
+			assert(zset.add("alice", 100) && zset.add("bob", 80) && zset.add("carol", 100));
+			assert(!zset.add("bob", 120) && zset.size() == 3);
+
+			// 分数相同时按成员排序
+			size_t rank = 0;
+			assert(zset.rank("alice", &rank) && rank == 0);
+			assert(zset.rank("carol", &rank) && rank == 1);
+			assert(zset.revrank("bob", &rank) && rank == 0);
+			assert(!zset.rank("dave", &rank));
+
+			double score = 0;
+			assert(zset.incrby("alice", 50) == 150 && zset.score("alice", &score) && score == 150);
+			assert(zset.incrby("dave", -5) == -5 && zset.size() == 4);
+			assert(zset.rank("dave", &rank) && rank == 0);
+
+			std::vector<std::string> members;
+			auto collect = [&](const smd::shm_string& member, double) { members.push_back(member.ToString()); };
+			assert(zset.range(0, -1, collect) == 4);
+			assert(members == std::vector<std::string>({"dave", "carol", "bob", "alice"}));
+			members.clear();
+			assert(zset.range(-2, 100, collect) == 2 && members == std::vector<std::string>({"bob", "alice"}));
+			assert(zset.range(3, 1, collect) == 0 && zset.range(-100, -5, collect) == 0);
+
+			members.clear();
+			assert(zset.range_by_score(100, 120, 0, size_t(-1), collect) == 2);
+			assert(members == std::vector<std::string>({"carol", "bob"}));
+			members.clear();
+			assert(zset.range_by_score(-10, 1000, 1, 2, collect) == 2);
+			assert(members == std::vector<std::string>({"carol", "bob"}));
+			assert(zset.range_by_score(151, 1000, 0, size_t(-1), collect) == 0);
+			assert(zset.count(100, 150) == 3 && zset.count(-5, -5) == 1 && zset.count(0, -1) == 0);
+			assert(zset.count(-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()) == 4);
+
+			assert(zset.remove("carol") && !zset.remove("carol") && zset.size() == 3);
+			assert(!zset.score("carol", nullptr));
+			assert(zset.rank("bob", &rank) && rank == 1);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestZSetCommands complete");
+	}
+
+	// 随机加分、删除，名次和按分数的区间和std::set对比
+	void TestZSetRandom() {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			smd::shm_zset zset;
+			std::map<std::string, double> scores;
+			std::set<std::pair<double, std::string>> ref;
+			for (int i = 0; i < 20000; i++) {
+				auto member = smd::util::Text::Format(i % 2 ? "player%d" : "LongLongLongLongLongPlayer%d", std::rand() % 1000);
+				auto it = scores.find(member);
+				if (std::rand() % 4 == 0) {
+					assert(zset.remove(member) == (it != scores.end()));
+					if (it != scores.end()) {
+						ref.erase(std::make_pair(it->second, member));
+						scores.erase(it);
+					}
+				} else {
+					double delta = double(std::rand() % 100);
+					double score = zset.incrby(member, delta);
+					if (it != scores.end()) {
+						ref.erase(std::make_pair(it->second, member));
+					}
+					scores[member] += delta;
+					assert(score == scores[member]);
+					ref.insert(std::make_pair(score, member));
+				}
+			}
+			assert(zset.size() == ref.size());
+
+			size_t index = 0;
+			for (auto& item : ref) {
+				size_t rank = 0;
+				assert(zset.rank(item.second, &rank) && rank == index);
+				index++;
+			}
+
+			auto it_ref = ref.begin();
+			zset.range(0, -1, [&](const smd::shm_string& member, double score) {
+				assert(member == it_ref->second && score == it_ref->first);
+				++it_ref;
+			});
+			assert(it_ref == ref.end());
+
+			for (int i = 0; i < 100; i++) {
+				double min = double(std::rand() % 2000);
+				double max = min + double(std::rand() % 500);
+				auto lo = ref.lower_bound(std::make_pair(min, std::string()));
+				size_t expect = 0;
+				for (auto it = lo; it != ref.end() && it->first <= max; ++it) {
+					expect++;
+				}
+				assert(zset.count(min, max) == expect);
+				assert(zset.range_by_score(min, max, 0, size_t(-1), [&](const smd::shm_string& member, double) {
+					assert(member == lo->second);
+					++lo;
+				}) == expect);
+			}
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestZSetRandom complete");
+	}
+
+	// SmdEnv中的第五种内置类型
+	void TestZSetEnv(smd::SmdEnv* env) {
+		auto mem_usage = smd::g_alloc->GetUsed();
+		{
+			auto& all_zsets = env->GetAllZSets();
+			auto& board = all_zsets[smd::shm_string("test_zset_board")];
+			for (int i = 0; i < 100; i++) {
+				board.add(smd::util::Text::Format("player%03d", i), double(i % 10));
+			}
+
+			size_t rank = 0;
+			auto it = all_zsets.find(smd::Slice("test_zset_board"));
+			assert(it != all_zsets.end() && it->second.size() == 100);
+			assert(it->second.revrank("player099", &rank) && rank == 0);
+			assert(all_zsets.erase(smd::Slice("test_zset_board")) == 1);
+		}
+		assert(mem_usage == smd::g_alloc->GetUsed());
+		SMD_LOG_INFO("TestZSetEnv complete");
+	}
+};
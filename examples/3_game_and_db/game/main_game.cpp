@@ -46,12 +46,17 @@ int main_game(UniqsModel::DataCenter& data_center) {
 		do {
 			parseInput("login.");
 			if (playerId > 0) {
-				UniqsModel::Player player;
+				// 直接在节点中构造玩家，不需要先构造临时对象再复制
+				auto res = obj->try_emplace(playerId);
+				if (!res.second) {
+					cout << "player already exists." << endl;
+					break;
+				}
+				auto& player = res.first->second;
 				player.playerid = playerId;
 				player.level = 1;
 				player.playername = "I am player [" + std::to_string(playerId) + "]";
 				player.lastlogintime = getTime();
-				obj->insert(std::make_pair(playerId, player));
 				break;
 			}
 
@@ -91,7 +96,7 @@ int main_game(UniqsModel::DataCenter& data_center) {
 				item.itemid = 200 - player.items.size();
 				item.param1 = 1234;
 				cout << "added item " << item.itemid << endl;
-				player.items.insert(std::make_pair(item.itemid, item));
+				player.items.insert(std::make_pair(item.itemid, std::move(item)));
 
 				break;
 			}
@@ -0,0 +1,140 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// count个字符串key，每批BATCH_SIZE个key：逐个SSet/SGet/SDel和MSet/MGet/MDel对比
+// 分两种批：从所有key里随机取的，和一段连续的key打乱顺序（例如同一个玩家的一组数据）
+// 另外保留改动之前SSet的写法（先find，不存在时再insert）作为参照
+//
+class BenchBatch {
+public:
+	enum {
+		BATCH_SIZE = 1000,
+		BATCH_COUNT = 1000,
+	};
+
+	BenchBatch(size_t count) {
+		Run(count);
+	}
+
+private:
+	typedef std::vector<std::vector<smd::Slice>> Batches;
+
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = (smd::SmdEnv*)smd::SmdEnv::Create(SHMID_BENCH_BASE + 22, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchBatch count:%llu batch:%d ====", count, BATCH_SIZE);
+		// 补齐位数，编号相邻的key在树里也相邻
+		std::vector<std::string> key_strs;
+		key_strs.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			key_strs.push_back(smd::util::Text::Format("user:%010llu", (unsigned long long)i));
+		}
+		for (auto id : BenchUtil::ShuffledIds(count)) {
+			env->SSet(key_strs[id], "value");
+		}
+
+		auto ids = BenchUtil::ShuffledIds(count);
+		Batches random_batches(BATCH_COUNT);
+		Batches dense_batches(BATCH_COUNT);
+		for (size_t b = 0; b < BATCH_COUNT; b++) {
+			auto order = BenchUtil::ShuffledIds(BATCH_SIZE);
+			const size_t start = ids[b % count] % (count > BATCH_SIZE ? count - BATCH_SIZE : 1);
+			for (size_t i = 0; i < BATCH_SIZE; i++) {
+				random_batches[b].push_back(key_strs[ids[(b * BATCH_SIZE + i) % count]]);
+				dense_batches[b].push_back(key_strs[(start + order[i]) % count]);
+			}
+		}
+
+		SMD_LOG_INFO("-- random keys --");
+		RunBatches(env, random_batches);
+		SMD_LOG_INFO("-- dense keys --");
+		RunBatches(env, dense_batches);
+
+		delete env;
+	}
+
+	void RunBatches(smd::SmdEnv* env, Batches& batches) {
+		std::vector<smd::Slice> values(BATCH_SIZE, smd::Slice("new value"));
+		std::vector<smd::Slice> results(BATCH_SIZE);
+		const size_t ops = size_t(BATCH_COUNT) * BATCH_SIZE;
+		auto& all_strings = env->GetAllStrings();
+
+		BenchTimer timer;
+		for (auto& batch : batches) {
+			for (auto& key : batch) {
+				auto it = all_strings.find(key);
+				if (it == all_strings.end()) {
+					all_strings.insert(std::make_pair(smd::shm_string(key), smd::shm_string("new value")));
+				} else {
+					it->second.assign("new value", 9);
+				}
+			}
+		}
+		BenchUtil::Report("find + insert (old SSet)", timer, ops);
+
+		timer.Reset();
+		for (auto& batch : batches) {
+			for (auto& key : batch) {
+				env->SSet(key, "new value");
+			}
+		}
+		BenchUtil::Report("SSet loop", timer, ops);
+
+		timer.Reset();
+		for (auto& batch : batches) {
+			env->MSet(batch.data(), values.data(), batch.size());
+		}
+		BenchUtil::Report("MSet", timer, ops);
+
+		size_t hits = 0;
+		timer.Reset();
+		for (auto& batch : batches) {
+			for (size_t i = 0; i < batch.size(); i++) {
+				hits += env->SGet(batch[i], &results[i]) ? 1 : 0;
+			}
+		}
+		BenchUtil::Report("SGet loop", timer, ops);
+
+		timer.Reset();
+		for (auto& batch : batches) {
+			hits += env->MGet(batch.data(), batch.size(), results.data());
+		}
+		BenchUtil::Report("MGet", timer, ops);
+
+		// 两种方式删除同样的key，删完写回去
+		size_t deleted = 0;
+		timer.Reset();
+		for (size_t b = 0; b < BATCH_COUNT / 2; b++) {
+			for (auto& key : batches[b]) {
+				deleted += env->SDel(key) ? 1 : 0;
+			}
+		}
+		BenchUtil::Report("SDel loop", timer, ops / 2);
+
+		for (size_t b = 0; b < BATCH_COUNT / 2; b++) {
+			env->MSet(batches[b].data(), values.data(), batches[b].size());
+		}
+		timer.Reset();
+		for (size_t b = 0; b < BATCH_COUNT / 2; b++) {
+			deleted += env->MDel(batches[b].data(), batches[b].size());
+		}
+		BenchUtil::Report("MDel", timer, ops / 2);
+
+		for (size_t b = 0; b < BATCH_COUNT / 2; b++) {
+			env->MSet(batches[b].data(), values.data(), batches[b].size());
+		}
+
+		// 批之间可能有重复的key，只检查总数的上限
+		if (hits != ops * 2 || deleted == 0 || deleted > ops) {
+			SMD_LOG_ERROR("batch mismatch, hits:%llu, deleted:%llu", hits, deleted);
+		}
+	}
+};
@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 红黑树的shm_map和B+树的shm_btree_map对比：随机插入、命中查找、从头到尾遍历、每个key占用的内存
+// 两个容器依次测试，测完一个清空再测下一个，数据量大时存储区不够会自动扩展新的段
+//
+class BenchBTree {
+public:
+	struct StBenchBTree {
+		smd::shm_map<int64_t, int64_t> map;
+		smd::shm_btree_map<int64_t, int64_t> btree;
+	};
+
+	BenchBTree(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchBTree>::Create(SHMID_BENCH_BASE + 17, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchBTree count:%llu ====", count);
+		auto& entry = env->GetEntry();
+		auto ids = BenchUtil::ShuffledIds(count);
+
+		Test("shm_map", entry.map, ids);
+		Test("shm_btree_map", entry.btree, ids);
+		SMD_LOG_INFO("shm_btree_map height:%llu", entry.btree.height());
+		entry.btree.clear();
+
+		delete env;
+	}
+
+	template <class Container>
+	void Test(const std::string& name, Container& container, const std::vector<uint64_t>& ids) {
+		auto used = smd::g_alloc->GetCommitted();
+		BenchTimer timer;
+		for (auto id : ids) {
+			container.insert(std::make_pair(int64_t(id), int64_t(id)));
+		}
+		BenchUtil::Report((name + " insert").c_str(), timer, ids.size());
+		SMD_LOG_INFO("%s memory: %.1f bytes/key", name.c_str(), double(smd::g_alloc->GetCommitted() - used) / ids.size());
+
+		timer.Reset();
+		int64_t sum = 0;
+		for (auto id : ids) {
+			sum += container.find(int64_t(id))->second;
+		}
+		BenchUtil::Report((name + " find").c_str(), timer, ids.size());
+
+		timer.Reset();
+		int64_t scan_sum = 0;
+		for (auto it = container.begin(); it != container.end(); ++it) {
+			scan_sum += it->second;
+		}
+		BenchUtil::Report((name + " scan").c_str(), timer, ids.size());
+
+		// 结果要用到，否则会被优化掉
+		const int64_t expect = int64_t(ids.size()) * int64_t(ids.size() - 1) / 2;
+		if (sum != expect || scan_sum != expect) {
+			SMD_LOG_ERROR("%s mismatch, sum:%lld, scan:%lld", name.c_str(), sum, scan_sum);
+		}
+
+		if (!std::is_same<Container, smd::shm_btree_map<int64_t, int64_t>>::value) {
+			container.clear();
+		}
+	}
+};
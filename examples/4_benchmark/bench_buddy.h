@@ -0,0 +1,77 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 两种伙伴系统的对比：关闭小块内存分配，让所有的分配都直接走伙伴系统
+//
+class BenchBuddy {
+public:
+	struct StBenchBuddy {
+		smd::shm_map<uint64_t, uint64_t> pod_map;
+	};
+
+	BenchBuddy(size_t count) {
+		Run(smd::BuddyType::kTree, "tree", count);
+		Run(smd::BuddyType::kFreeList, "free list", count);
+	}
+
+private:
+	void Run(smd::BuddyType buddy_type, const char* name, size_t count) {
+		smd::EnvOptions options;
+		options.enable_slab = false;
+		options.buddy_type = buddy_type;
+		auto env = smd::Env<StBenchBuddy>::Create(SHMID_BENCH_BASE + 2, 27, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchBuddy %s count:%llu ====", name, count);
+
+		// 随机大小的分配与回收
+		std::vector<std::pair<smd::shm_pointer<char>, size_t>> ptrs;
+		ptrs.reserve(count);
+		std::default_random_engine generator{std::random_device{}()};
+		std::uniform_int_distribution<size_t> dis(16, 1024);
+		std::vector<size_t> sizes;
+		for (size_t i = 0; i < count; i++) {
+			sizes.push_back(dis(generator));
+		}
+
+		// 第一轮会触发存储区的缺页，第二轮才是分配器本身的开销
+		BenchTimer timer;
+		for (int round = 0; round < 2; round++) {
+			timer.Reset();
+			for (size_t i = 0; i < count; i++) {
+				ptrs.emplace_back(smd::g_alloc->Malloc<char>(sizes[i]), sizes[i]);
+			}
+			BenchUtil::Report(round == 0 ? "Malloc 16~1024 bytes (cold)" : "Malloc 16~1024 bytes (warm)", timer, count);
+
+			std::shuffle(ptrs.begin(), ptrs.end(), generator);
+			timer.Reset();
+			for (auto& p : ptrs) {
+				smd::g_alloc->Free(p.first, p.second);
+			}
+			BenchUtil::Report(round == 0 ? "Free in random order (cold)" : "Free in random order (warm)", timer, count);
+			ptrs.clear();
+		}
+
+		// 容器的负载
+		auto& entry = env->GetEntry();
+		auto ids = BenchUtil::ShuffledIds(count);
+		timer.Reset();
+		for (auto id : ids) {
+			entry.pod_map.insert(std::make_pair(id, id));
+		}
+		BenchUtil::Report("shm_map<uint64_t, uint64_t> insert", timer, count);
+
+		timer.Reset();
+		for (auto id : ids) {
+			entry.pod_map.erase(entry.pod_map.find(id));
+		}
+		BenchUtil::Report("shm_map<uint64_t, uint64_t> erase", timer, count);
+
+		delete env;
+	}
+};
@@ -0,0 +1,90 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// count个带过期时间的字符串，过期时间均匀分布在100秒里，也就是每秒有1%到期
+// 用模拟的时间每10毫秒调用一次Tick，统计Tick的耗时；和每次把all_strings整个扫一遍对比
+//
+class BenchExpire {
+public:
+	enum {
+		WINDOW_SECONDS = 100,
+		TICK_MS = 10,
+		// 过期时间放在足够远的将来，设置过期时间的过程中不会有key到期
+		START_DELAY_MS = 1000000,
+	};
+
+	BenchExpire(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = (smd::SmdEnv*)smd::SmdEnv::Create(SHMID_BENCH_BASE + 21, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchExpire count:%llu ====", count);
+		std::vector<std::string> keys;
+		keys.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			keys.push_back(smd::util::Text::Format("session%llu", (unsigned long long)i));
+		}
+
+		BenchTimer timer;
+		for (auto& key : keys) {
+			env->SSet(key, "token");
+		}
+		BenchUtil::Report("sset", timer, count);
+
+		const int64_t start = smd::util::Time::NowMs() + START_DELAY_MS;
+		auto committed = smd::g_alloc->GetCommitted();
+		timer.Reset();
+		for (size_t i = 0; i < count; i++) {
+			int64_t deadline = start + int64_t(i % (WINDOW_SECONDS * 1000));
+			env->Expire(keys[i], deadline - smd::util::Time::NowMs());
+		}
+		BenchUtil::Report("expire", timer, count);
+		SMD_LOG_INFO("memory: %.1f bytes/key", double(smd::g_alloc->GetCommitted() - committed) / count);
+
+		// 以前的做法：扫一遍all_strings找出到期的key
+		size_t scanned = 0;
+		auto& all_expires = env->GetEntry().all_expires;
+		timer.Reset();
+		for (auto& kv : env->GetAllStrings()) {
+			auto it = all_expires.find(kv.first);
+			scanned += (it != all_expires.end() && it->second.deadline <= start) ? 1 : 0;
+		}
+		BenchUtil::Report("scan all_strings once", timer, 1);
+
+		size_t expired = 0;
+		size_t ticks = 0;
+		timer.Reset();
+		for (int64_t now = start; now < start + WINDOW_SECONDS * 1000 + 1000; now += TICK_MS) {
+			expired += env->Tick(now);
+			ticks++;
+		}
+		auto tick_ns = timer.ElapsedNs();
+		BenchUtil::Report("tick", timer, ticks);
+		SMD_LOG_INFO("tick cost per second: %.2f ms, per expired key: %.1f ns",
+			tick_ns / 1000000.0 / ticks * (1000 / TICK_MS), expired > 0 ? double(tick_ns) / expired : 0.0);
+
+		// 没有key到期时的空转
+		timer.Reset();
+		for (int64_t now = start + WINDOW_SECONDS * 1000 + 1000; ticks > 0; now += TICK_MS, ticks--) {
+			env->Tick(now);
+		}
+		BenchUtil::Report("idle tick", timer, (WINDOW_SECONDS + 1) * 1000 / TICK_MS);
+
+		if (expired != count || scanned > count || !env->GetAllStrings().empty()) {
+			SMD_LOG_ERROR("expire mismatch, expired:%llu, left:%llu", expired, env->GetAllStrings().size());
+		}
+
+		delete env;
+	}
+};
@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 开放寻址的shm_flat_hash_set和链表桶的shm_hash对比：插入、命中查找、未命中查找
+// 数据量大时存储区不够会自动扩展新的段
+//
+class BenchFlatHash {
+public:
+	struct StBenchFlatHash {
+		smd::shm_hash<uint64_t> pod_hash;
+		smd::shm_flat_hash_set<uint64_t> pod_flat_hash;
+	};
+
+	BenchFlatHash(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchFlatHash>::Create(SHMID_BENCH_BASE + 8, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchFlatHash count:%llu ====", count);
+		auto& entry = env->GetEntry();
+
+		// 偶数是存在的key，奇数用来做未命中的查找
+		auto ids = BenchUtil::ShuffledIds(count);
+		for (auto& id : ids) {
+			id *= 2;
+		}
+
+		auto used = smd::g_alloc->GetCommitted();
+		Insert("shm_hash", entry.pod_hash, ids);
+		SMD_LOG_INFO("shm_hash memory: %.1f bytes/key", double(smd::g_alloc->GetCommitted() - used) / count);
+		Find("shm_hash", entry.pod_hash, ids);
+
+		used = smd::g_alloc->GetCommitted();
+		Insert("shm_flat_hash_set", entry.pod_flat_hash, ids);
+		SMD_LOG_INFO("shm_flat_hash_set memory: %.1f bytes/key", double(smd::g_alloc->GetCommitted() - used) / count);
+		Find("shm_flat_hash_set", entry.pod_flat_hash, ids);
+
+		delete env;
+	}
+
+	template <class Container>
+	void Insert(const std::string& name, Container& container, const std::vector<uint64_t>& ids) {
+		BenchTimer timer;
+		for (auto id : ids) {
+			container.insert(id);
+		}
+		BenchUtil::Report((name + " insert").c_str(), timer, ids.size());
+	}
+
+	template <class Container>
+	void Find(const std::string& name, Container& container, const std::vector<uint64_t>& ids) {
+		BenchTimer timer;
+		size_t hit = 0;
+		for (auto id : ids) {
+			hit += container.find(id) != container.end() ? 1 : 0;
+		}
+		BenchUtil::Report((name + " find hit").c_str(), timer, ids.size());
+
+		timer.Reset();
+		size_t miss = 0;
+		for (auto id : ids) {
+			miss += container.find(id + 1) == container.end() ? 1 : 0;
+		}
+		BenchUtil::Report((name + " find miss").c_str(), timer, ids.size());
+
+		// 结果要用到，否则查找会被优化掉
+		if (hit != ids.size() || miss != ids.size()) {
+			SMD_LOG_ERROR("%s find mismatch, hit:%llu, miss:%llu", name.c_str(), hit, miss);
+		}
+	}
+};
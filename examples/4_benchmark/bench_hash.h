@@ -0,0 +1,125 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// shm_string的哈希：原来先复制成std::string再用std::hash，现在直接对数据计算BytesHash，shm_hashed_string再把结果缓存在对象里
+// 先比较不同长度的单次哈希，再比较shm_string作为key的哈希表插入（包含扩容）和查找
+//
+class BenchHash {
+public:
+	// 改动之前std::hash<shm_string>的做法
+	struct ToStringHash {
+		size_t operator()(const smd::shm_string& s) const {
+			return std::hash<std::string>()(s.ToString());
+		}
+	};
+
+	struct StBenchHash {
+		smd::shm_flat_hash_set<smd::shm_string, ToStringHash> old_hash_set;
+		smd::shm_flat_hash_set<smd::shm_string> hash_set;
+		smd::shm_flat_hash_set<smd::shm_hashed_string> cached_hash_set;
+	};
+
+	BenchHash(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchHash>::Create(SHMID_BENCH_BASE + 12, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchHash count:%llu ====", count);
+		for (size_t len : {8, 32, 128, 1024}) {
+			HashBytes(len, count);
+		}
+
+		auto& entry = env->GetEntry();
+		std::vector<smd::shm_string> keys;
+		std::vector<smd::shm_hashed_string> hashed_keys;
+		keys.reserve(count);
+		hashed_keys.reserve(count);
+		for (auto id : BenchUtil::ShuffledIds(count)) {
+			keys.emplace_back("player:session:token:" + std::to_string(id * 2654435761ULL));
+			hashed_keys.emplace_back(keys.back().ToString());
+		}
+
+		Table("ToString+std::hash", entry.old_hash_set, keys);
+		Table("BytesHash", entry.hash_set, keys);
+		Table("BytesHash cached", entry.cached_hash_set, hashed_keys);
+
+		// 长key分配在字典里，先释放再析构字典
+		keys.clear();
+		hashed_keys.clear();
+		delete env;
+	}
+
+	void HashBytes(size_t len, size_t count) {
+		std::string str(len, 'x');
+		for (size_t i = 0; i < len; i++) {
+			str[i] = char('a' + i % 26);
+		}
+		smd::shm_string s(str);
+		const std::string suffix = " len " + std::to_string(len);
+
+		// 每轮改一个字节，避免结果被提到循环外面
+		uint64_t sum = 0;
+		BenchTimer timer;
+		for (size_t i = 0; i < count; i++) {
+			s.data()[0] = char(i);
+			sum += ToStringHash()(s);
+		}
+		BenchUtil::Report(("ToString+std::hash" + suffix).c_str(), timer, count);
+
+		timer.Reset();
+		for (size_t i = 0; i < count; i++) {
+			s.data()[0] = char(i);
+			sum += std::hash<std::string_view>()(std::string_view(s.data(), s.size()));
+		}
+		BenchUtil::Report(("std::hash<string_view>" + suffix).c_str(), timer, count);
+
+		timer.Reset();
+		for (size_t i = 0; i < count; i++) {
+			s.data()[0] = char(i);
+			sum += smd::BytesHash::Hash(s.data(), s.size());
+		}
+		BenchUtil::Report(("BytesHash" + suffix).c_str(), timer, count);
+
+		smd::shm_hashed_string hs(str);
+		timer.Reset();
+		for (size_t i = 0; i < count; i++) {
+			sum += std::hash<smd::shm_hashed_string>()(hs);
+		}
+		BenchUtil::Report(("shm_hashed_string cached" + suffix).c_str(), timer, count);
+
+		if (sum == 0) {
+			SMD_LOG_ERROR("hash sum is zero");
+		}
+	}
+
+	template <class Container, class Key>
+	void Table(const std::string& name, Container& container, const std::vector<Key>& keys) {
+		BenchTimer timer;
+		for (auto& key : keys) {
+			container.insert(key);
+		}
+		BenchUtil::Report((name + " insert").c_str(), timer, keys.size());
+
+		timer.Reset();
+		size_t hit = 0;
+		for (auto& key : keys) {
+			hit += container.find(key) != container.end() ? 1 : 0;
+		}
+		BenchUtil::Report((name + " find").c_str(), timer, keys.size());
+
+		if (hit != keys.size()) {
+			SMD_LOG_ERROR("%s find mismatch, hit:%llu", name.c_str(), hit);
+		}
+	}
+};
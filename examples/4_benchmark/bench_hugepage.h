@@ -0,0 +1,64 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 大页的收益：分别使用4K和2M的页，对同样的数据做随机查找
+// 需要预留足够的大页（/proc/sys/vm/nr_hugepages），否则两轮都是普通页
+//
+class BenchHugePage {
+public:
+	struct StBenchHugePage {
+		smd::shm_map<uint64_t, uint64_t> pod_map;
+		smd::shm_hash<uint64_t> pod_hash;
+	};
+
+	BenchHugePage(size_t count) {
+		Run(false, count);
+		Run(true, count);
+	}
+
+private:
+	void Run(bool huge_page, size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		options.huge_page = huge_page;
+		auto env = smd::Env<StBenchHugePage>::Create(SHMID_BENCH_BASE + 5, 28, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchHugePage huge_page:%d page_size:%llu count:%llu ====", huge_page, env->GetPageSize(),
+			count);
+		auto& entry = env->GetEntry();
+		auto ids = BenchUtil::ShuffledIds(count);
+		for (auto id : ids) {
+			entry.pod_map.insert(std::make_pair(id, id));
+			entry.pod_hash.insert(id);
+		}
+
+		// 查找的顺序和插入的顺序无关
+		auto lookups = BenchUtil::ShuffledIds(count);
+		uint64_t sum = 0;
+		BenchTimer timer;
+		for (auto id : lookups) {
+			sum += entry.pod_map.find(id)->second;
+		}
+		BenchUtil::Report("shm_map<uint64_t, uint64_t> find", timer, count);
+
+		timer.Reset();
+		for (auto id : lookups) {
+			sum += *entry.pod_hash.find(id);
+		}
+		BenchUtil::Report("shm_hash<uint64_t> find", timer, count);
+		if (sum != uint64_t(count) * (count - 1)) {
+			SMD_LOG_ERROR("lookup mismatch, sum:%llu", sum);
+		}
+
+		entry.pod_map.clear();
+		entry.pod_hash.clear();
+
+		delete env;
+	}
+};
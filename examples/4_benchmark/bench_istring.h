@@ -0,0 +1,126 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 生成的玩家数据：公会名、最近登录时间、道具名都从有限的集合中取值，大量重复
+// 字段用shm_string时每份都单独存放，用shm_istring时同样的内容在池中只有一份
+//
+class BenchIString {
+public:
+	template <class String>
+	struct BenchPlayer {
+		uint64_t playerid = 0;
+		String guild;
+		String lastlogintime;
+		smd::shm_vector<String> items;
+	};
+
+	struct StBenchIString {
+		smd::shm_unordered_map<int64_t, BenchPlayer<smd::shm_string>> players;
+		smd::shm_intern_pool pool;
+		smd::shm_unordered_map<int64_t, BenchPlayer<smd::shm_istring>> interned_players;
+	};
+
+	enum {
+		ITEM_PER_PLAYER = 20,
+		GUILD_NUM = 200,
+		ITEM_NAME_NUM = 500,
+		LOGIN_TIME_NUM = 1440, // 一天中的每一分钟
+	};
+
+	BenchIString(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchIString>::Create(SHMID_BENCH_BASE + 14, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchIString count:%llu items:%d ====", count, ITEM_PER_PLAYER);
+		auto& entry = env->GetEntry();
+
+		std::vector<std::string> guilds, times, items;
+		for (int i = 0; i < GUILD_NUM; i++) {
+			guilds.push_back("[Guild] Knights of Shared Memory " + std::to_string(i));
+		}
+		for (int i = 0; i < LOGIN_TIME_NUM; i++) {
+			times.push_back(smd::util::Text::Format("2026-10-18-%02d-%02d-00", i / 60, i % 60));
+		}
+		for (int i = 0; i < ITEM_NAME_NUM; i++) {
+			items.push_back("Legendary Item Blueprint No." + std::to_string(i));
+		}
+
+		auto ids = BenchUtil::ShuffledIds(count);
+		std::default_random_engine generator(12345);
+		auto pick = [&](const std::vector<std::string>& names) -> const std::string& {
+			return names[generator() % names.size()];
+		};
+
+		auto committed = smd::g_alloc->GetCommitted();
+		BenchTimer timer;
+		for (auto id : ids) {
+			auto& player = entry.players[int64_t(id)];
+			player.playerid = id;
+			player.guild = pick(guilds);
+			player.lastlogintime = pick(times);
+			for (int i = 0; i < ITEM_PER_PLAYER; i++) {
+				player.items.push_back(smd::shm_string(pick(items)));
+			}
+		}
+		BenchUtil::Report("shm_string players insert", timer, count);
+		SMD_LOG_INFO("shm_string memory: %.1f bytes/player", double(smd::g_alloc->GetCommitted() - committed) / count);
+
+		// 两组数据完全一样
+		generator.seed(12345);
+		committed = smd::g_alloc->GetCommitted();
+		timer.Reset();
+		for (auto id : ids) {
+			auto& player = entry.interned_players[int64_t(id)];
+			player.playerid = id;
+			player.guild = entry.pool.intern(pick(guilds));
+			player.lastlogintime = entry.pool.intern(pick(times));
+			for (int i = 0; i < ITEM_PER_PLAYER; i++) {
+				player.items.push_back(entry.pool.intern(pick(items)));
+			}
+		}
+		BenchUtil::Report("shm_istring players insert", timer, count);
+		SMD_LOG_INFO("shm_istring memory: %.1f bytes/player, pool strings: %llu",
+			double(smd::g_alloc->GetCommitted() - committed) / count, entry.pool.size());
+
+		// 按内容比较和按句柄比较
+		const auto& target = items[0];
+		size_t hit = 0;
+		timer.Reset();
+		for (auto& pair : entry.players) {
+			for (auto& item : pair.second.items) {
+				hit += item == target ? 1 : 0;
+			}
+		}
+		BenchUtil::Report("shm_string compare", timer, count * ITEM_PER_PLAYER);
+
+		// 句柄持有池中的引用，要在析构字典之前释放
+		{
+			auto interned_target = entry.pool.intern(target);
+			timer.Reset();
+			for (auto& pair : entry.interned_players) {
+				for (auto& item : pair.second.items) {
+					hit -= item == interned_target ? 1 : 0;
+				}
+			}
+			BenchUtil::Report("shm_istring compare", timer, count * ITEM_PER_PLAYER);
+		}
+
+		if (hit != 0) {
+			SMD_LOG_ERROR("compare mismatch, hit:%lld", (int64_t)hit);
+		}
+
+		delete env;
+	}
+};
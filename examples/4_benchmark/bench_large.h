@@ -0,0 +1,101 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 超过4G的共享内存：用大块内存把整个存储区切开，确保有块的偏移超过4G，并且能正常读写、回收
+// 只访问每个块的首尾，不会真的占用这么多物理内存
+//
+class BenchLarge {
+public:
+	struct StBenchLarge {
+		smd::shm_map<uint64_t, uint64_t> pod_map;
+	};
+
+	BenchLarge(unsigned level) {
+		Run(level);
+	}
+
+private:
+	void Run(unsigned level) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+
+		BenchTimer timer;
+		auto env = smd::Env<StBenchLarge>::Create(SHMID_BENCH_BASE + 3, level, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+		BenchUtil::Report("Create", timer, 1);
+
+		SMD_LOG_INFO("==== BenchLarge level:%u storage:%llu ====", level,
+			smd::Alloc::GetStorageSize(options.buddy_type, level));
+
+		const size_t BLOCK_SIZE = size_t(256) << 20;
+		const int64_t MARK_4G = int64_t(1) << 32;
+		std::vector<smd::shm_pointer<char>> blocks;
+		int64_t max_offset = 0;
+
+		timer.Reset();
+		for (;;) {
+			auto p = smd::g_alloc->Malloc<char>(BLOCK_SIZE);
+			if (p == smd::shm_nullptr)
+				break;
+
+			// 第0段已经满了，后面的块会落在新的段里
+			if ((p.Raw() >> smd::SHM_SEGMENT_SHIFT) != 0) {
+				smd::g_alloc->Free(p, BLOCK_SIZE);
+				break;
+			}
+
+			// 首尾各写入一个标记
+			char* ptr = p.Ptr();
+			uint64_t mark = uint64_t(p.Raw());
+			memcpy(ptr, &mark, sizeof(mark));
+			memcpy(ptr + BLOCK_SIZE - sizeof(mark), &mark, sizeof(mark));
+			blocks.push_back(p);
+			max_offset = std::max(max_offset, p.Raw());
+		}
+		BenchUtil::Report("Malloc 256M blocks", timer, blocks.size());
+		SMD_LOG_INFO("blocks:%llu max_offset:0x%llx", blocks.size(), max_offset);
+		assert(max_offset >= MARK_4G);
+
+		for (auto& p : blocks) {
+			char* ptr = p.Ptr();
+			uint64_t head = 0;
+			uint64_t tail = 0;
+			memcpy(&head, ptr, sizeof(head));
+			memcpy(&tail, ptr + BLOCK_SIZE - sizeof(tail), sizeof(tail));
+			if (head != uint64_t(p.Raw()) || tail != uint64_t(p.Raw())) {
+				SMD_LOG_ERROR("data mismatch at 0x%llx", p.Raw());
+				assert(false);
+			}
+		}
+
+		// 大块之间穿插的小块，同样落在4G之后
+		auto& pod_map = env->GetEntry().pod_map;
+		for (uint64_t i = 0; i < 1000; i++) {
+			pod_map.insert(std::make_pair(i, i * 10));
+		}
+		for (uint64_t i = 0; i < 1000; i++) {
+			assert(pod_map.find(i)->second == i * 10);
+		}
+		pod_map.clear();
+
+		timer.Reset();
+		for (auto& p : blocks) {
+			smd::g_alloc->Free(p, BLOCK_SIZE);
+		}
+		BenchUtil::Report("Free 256M blocks", timer, blocks.size());
+
+		// 全部回收之后，超过4G的大块能再分配出来
+		auto big = smd::g_alloc->Malloc<char>(size_t(MARK_4G));
+		assert(big != smd::shm_nullptr);
+		big.Ptr()[MARK_4G - 1] = 1;
+		smd::g_alloc->Free(big, size_t(MARK_4G));
+		SMD_LOG_INFO("BenchLarge complete");
+
+		delete env;
+	}
+};
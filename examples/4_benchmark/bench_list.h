@@ -0,0 +1,88 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 和2_log一样的日志链表：统计每个节点实际占用的共享内存、size()的耗时，以及splice在链表之间搬节点的耗时
+//
+class BenchList {
+public:
+	struct StBenchList {
+		smd::shm_list<smd::shm_string> logs;
+		smd::shm_list<smd::shm_string> archived;
+		smd::shm_list<uint64_t> ids;
+	};
+
+	enum {
+		SIZE_CALLS = 100,
+	};
+
+	BenchList(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchList>::Create(SHMID_BENCH_BASE + 16, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchList count:%llu sizeof(shm_list):%llu ====", count, sizeof(smd::shm_list<uint64_t>));
+		auto& entry = env->GetEntry();
+
+		auto committed = smd::g_alloc->GetCommitted();
+		BenchTimer timer;
+		for (size_t i = 0; i < count; i++) {
+			entry.ids.push_back(i);
+		}
+		BenchUtil::Report("shm_list<uint64_t> push_back", timer, count);
+		SMD_LOG_INFO("memory: %.1f bytes/node", double(smd::g_alloc->GetCommitted() - committed) / count);
+
+		// 短日志放在shm_string内部，节点之外没有其他分配
+		committed = smd::g_alloc->GetCommitted();
+		char line[32];
+		timer.Reset();
+		for (size_t i = 0; i < count; i++) {
+			int len = snprintf(line, sizeof(line), "[10:00:00] login %llu", (unsigned long long)i);
+			entry.logs.emplace_back(line, len);
+		}
+		BenchUtil::Report("shm_list<shm_string> emplace_back", timer, count);
+		SMD_LOG_INFO("memory: %.1f bytes/node", double(smd::g_alloc->GetCommitted() - committed) / count);
+
+		size_t total = 0;
+		timer.Reset();
+		for (int i = 0; i < SIZE_CALLS; i++) {
+			total += entry.logs.size();
+		}
+		BenchUtil::Report("shm_list<shm_string> size", timer, SIZE_CALLS);
+
+		// 把前一半日志归档到另一个链表，再逐条挪回来
+		auto malloc_count = smd::g_alloc->GetMallocCount();
+		timer.Reset();
+		for (size_t i = 0; i < count / 2; i++) {
+			entry.archived.splice_front(entry.logs);
+		}
+		BenchUtil::Report("shm_list<shm_string> splice_front", timer, count / 2);
+
+		timer.Reset();
+		entry.logs.splice(entry.logs.begin(), entry.archived);
+		BenchUtil::Report("shm_list<shm_string> splice all", timer, 1);
+		SMD_LOG_INFO("malloc: %llu", smd::g_alloc->GetMallocCount() - malloc_count);
+
+		timer.Reset();
+		for (size_t i = 0; i < count; i++) {
+			entry.logs.pop_front();
+		}
+		BenchUtil::Report("shm_list<shm_string> pop_front", timer, count);
+
+		if (total != count * SIZE_CALLS || !entry.logs.empty() || !entry.archived.empty()) {
+			SMD_LOG_ERROR("list mismatch, total:%llu", total);
+		}
+
+		delete env;
+	}
+};
@@ -0,0 +1,69 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 文件映射与SysV共享内存的对比：冷启动写入数据，热启动挂接之后把数据全部读一遍
+//
+class BenchMmap {
+public:
+	struct StBenchMmap {
+		smd::shm_map<uint64_t, uint64_t> pod_map;
+	};
+
+	BenchMmap(size_t count, const std::string& file_path) {
+		Run("sysv", "", count);
+		Run("mmap", file_path, count);
+	}
+
+private:
+	void Run(const char* name, const std::string& file_path, size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		options.file_path = file_path;
+
+		BenchTimer timer;
+		auto env = smd::Env<StBenchMmap>::Create(SHMID_BENCH_BASE + 6, 27, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchMmap %s count:%llu ====", name, count);
+		BenchUtil::Report("Cold create", timer, 1);
+
+		auto ids = BenchUtil::ShuffledIds(count);
+		timer.Reset();
+		for (auto id : ids) {
+			env->GetEntry().pod_map.insert(std::make_pair(id, id));
+		}
+		BenchUtil::Report("shm_map<uint64_t, uint64_t> insert", timer, count);
+
+		timer.Reset();
+		env->Flush();
+		BenchUtil::Report("Flush", timer, 1);
+
+		// 热启动，重新映射一次，数据要从页缓存中重新缺页读入
+		delete env;
+		timer.Reset();
+		env = smd::Env<StBenchMmap>::Create(SHMID_BENCH_BASE + 6, 27, true, options);
+		if (env == nullptr || !env->IsAttached()) {
+			SMD_LOG_ERROR("Attach env failed");
+			return;
+		}
+		BenchUtil::Report("Warm attach", timer, 1);
+
+		timer.Reset();
+		uint64_t sum = 0;
+		for (auto id : ids) {
+			sum += env->GetEntry().pod_map.find(id)->second;
+		}
+		BenchUtil::Report("shm_map find after attach", timer, count);
+		if (sum != uint64_t(count) * (count - 1) / 2) {
+			SMD_LOG_ERROR("data mismatch after attach, sum:%llu", sum);
+		}
+
+		env->GetEntry().pod_map.clear();
+		delete env;
+	}
+};
@@ -0,0 +1,110 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 玩家登录时插入玩家数据：复制临时对象、移动临时对象、try_emplace直接在节点中构造三种方式对比
+// 玩家结构和3_game_and_db里生成的UniqsModel::Player一样，带有字符串和嵌套的容器，统计每次登录的分配次数
+//
+class BenchMove {
+public:
+	struct BenchItem {
+		int64_t itemid = 0;
+		int64_t param1 = 0;
+		smd::shm_string name;
+	};
+
+	struct BenchPlayer {
+		uint64_t playerid = 0;
+		int level = 0;
+		smd::shm_string playername;
+		smd::shm_string lastlogintime;
+		smd::shm_string lastlogouttime;
+		smd::shm_map<int64_t, BenchItem> items;
+		smd::shm_map<int, int> equips1;
+		smd::shm_map<uint64_t, int> equips2;
+	};
+
+	struct StBenchMove {
+		smd::shm_map<int64_t, BenchPlayer> copy_players;
+		smd::shm_map<int64_t, BenchPlayer> move_players;
+		smd::shm_map<int64_t, BenchPlayer> emplace_players;
+	};
+
+	enum {
+		ITEM_PER_PLAYER = 8,
+	};
+
+	BenchMove(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchMove>::Create(SHMID_BENCH_BASE + 15, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchMove count:%llu items:%d ====", count, ITEM_PER_PLAYER);
+		auto& entry = env->GetEntry();
+		auto ids = BenchUtil::ShuffledIds(count);
+
+		// 改动之前的做法：填好临时对象，make_pair复制一次，insert再复制一次
+		Login("copy insert", ids, [&](uint64_t id) {
+			BenchPlayer player;
+			Fill(player, id);
+			const auto value = std::make_pair(int64_t(id), player);
+			entry.copy_players.insert(value);
+		});
+
+		Login("move insert", ids, [&](uint64_t id) {
+			BenchPlayer player;
+			Fill(player, id);
+			entry.move_players.insert(std::make_pair(int64_t(id), std::move(player)));
+		});
+
+		Login("try_emplace", ids, [&](uint64_t id) {
+			auto res = entry.emplace_players.try_emplace(int64_t(id));
+			Fill(res.first->second, id);
+		});
+
+		// 结果要用到，否则插入会被优化掉
+		if (entry.copy_players.size() != count || entry.move_players.size() != count ||
+			entry.emplace_players.size() != count) {
+			SMD_LOG_ERROR("login mismatch");
+		}
+
+		delete env;
+	}
+
+	static void Fill(BenchPlayer& player, uint64_t id) {
+		player.playerid = id;
+		player.level = 1;
+		player.playername = "I am player [" + std::to_string(id) + "] from the shared memory kingdom";
+		player.lastlogintime = "2026-10-18-10-00-00";
+		for (int i = 0; i < ITEM_PER_PLAYER; i++) {
+			auto& item = player.items.try_emplace(i).first->second;
+			item.itemid = i;
+			item.param1 = 1234;
+			item.name = "Legendary Item Blueprint No." + std::to_string(i);
+		}
+		player.equips1.try_emplace(1, 1001);
+		player.equips2.try_emplace(2, 2002);
+	}
+
+	template <class F>
+	void Login(const std::string& name, const std::vector<uint64_t>& ids, F&& login) {
+		auto malloc_count = smd::g_alloc->GetMallocCount();
+		BenchTimer timer;
+		for (auto id : ids) {
+			login(id);
+		}
+		BenchUtil::Report(("login " + name).c_str(), timer, ids.size());
+		SMD_LOG_INFO("%-40s %10.2f malloc/op", ("login " + name).c_str(),
+			double(smd::g_alloc->GetMallocCount() - malloc_count) / ids.size());
+	}
+};
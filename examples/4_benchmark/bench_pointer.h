@@ -0,0 +1,100 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// shm_pointer解引用：每次按指针的高16位查一次段基址表再加上原始值，和直接保存裸指针对比
+// 节点按随机顺序串成一条链，顺着链走一遍，访存的延迟都在同一条依赖链上
+// 另外统计AllocOf在一个字典和两个字典时按地址查找所在字典的耗时
+//
+class BenchPointer {
+public:
+	struct Node {
+		smd::shm_pointer<Node> next;
+		Node* raw_next = nullptr;
+		uint64_t value = 0;
+	};
+
+	struct StBenchPointer {
+		smd::shm_vector<Node> nodes;
+	};
+
+	struct StBenchPointerOther {
+		uint64_t value = 0;
+	};
+
+	BenchPointer(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchPointer>::Create(SHMID_BENCH_BASE + 23, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchPointer count:%llu ====", count);
+		auto& nodes = env->GetEntry().nodes;
+		nodes.resize(count);
+		auto ids = BenchUtil::ShuffledIds(count);
+		auto base = smd::g_alloc->ToShmPointer<Node>(nodes.data());
+		for (size_t i = 0; i < count; i++) {
+			auto& node = nodes[ids[i]];
+			const size_t next = ids[(i + 1) % count];
+			node.next = base + int64_t(next);
+			node.raw_next = &nodes[next];
+			node.value = i;
+		}
+
+		uint64_t sum = 0;
+		BenchTimer timer;
+		auto p = base + int64_t(ids[0]);
+		for (size_t i = 0; i < count; i++) {
+			sum += p->value;
+			p = p->next;
+		}
+		BenchUtil::Report("shm_pointer chase", timer, count);
+
+		timer.Reset();
+		Node* raw = &nodes[ids[0]];
+		for (size_t i = 0; i < count; i++) {
+			sum -= raw->value;
+			raw = raw->raw_next;
+		}
+		BenchUtil::Report("raw pointer chase", timer, count);
+
+		if (sum != 0) {
+			SMD_LOG_ERROR("chase mismatch, sum:%llu", sum);
+		}
+
+		LookupAlloc("AllocOf 1 env", nodes, count);
+		options.env_id = 1;
+		auto other = smd::Env<StBenchPointerOther>::Create(SHMID_BENCH_BASE + 24, 20, false, options);
+		if (other == nullptr) {
+			SMD_LOG_ERROR("Create other env failed");
+		} else {
+			env->Activate();
+			LookupAlloc("AllocOf 2 envs", nodes, count);
+			delete other;
+			env->Activate();
+		}
+
+		delete env;
+	}
+
+	void LookupAlloc(const char* name, smd::shm_vector<Node>& nodes, size_t count) {
+		size_t hit = 0;
+		BenchTimer timer;
+		for (size_t i = 0; i < count; i++) {
+			hit += smd::AllocOf(&nodes[i]) == smd::g_alloc ? 1 : 0;
+		}
+		BenchUtil::Report(name, timer, count);
+		if (hit != count) {
+			SMD_LOG_ERROR("%s mismatch, hit:%llu", name, hit);
+		}
+	}
+};
@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 按玩家id分片读取一段连续的key：从begin()开始走（改动之前只能这样做）、lower_bound之后用迭代器走、scan三种方式对比
+//
+class BenchRange {
+public:
+	struct StBenchRange {
+		smd::shm_map<int64_t, int64_t> players;
+	};
+
+	enum {
+		RANGE_SIZE = 100,
+		QUERY_COUNT = 10000,
+		BEGIN_QUERY_COUNT = 20,
+	};
+
+	BenchRange(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchRange>::Create(SHMID_BENCH_BASE + 18, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchRange count:%llu range:%d ====", count, RANGE_SIZE);
+		auto& players = env->GetEntry().players;
+		for (auto id : BenchUtil::ShuffledIds(count)) {
+			players.insert(std::make_pair(int64_t(id), int64_t(id)));
+		}
+
+		std::vector<int64_t> starts;
+		for (auto id : BenchUtil::ShuffledIds(QUERY_COUNT)) {
+			starts.push_back(int64_t(id * 7919 % (count > RANGE_SIZE ? count - RANGE_SIZE : 1)));
+		}
+
+		int64_t sum = 0;
+		BenchTimer timer;
+		for (int i = 0; i < BEGIN_QUERY_COUNT; i++) {
+			auto from = starts[i];
+			for (auto it = players.begin(); it != players.end() && it->first < from + RANGE_SIZE; ++it) {
+				if (it->first >= from) {
+					sum += it->second;
+				}
+			}
+		}
+		BenchUtil::Report("iterate from begin", timer, BEGIN_QUERY_COUNT);
+		Check("iterate from begin", sum, starts, BEGIN_QUERY_COUNT);
+
+		sum = 0;
+		timer.Reset();
+		for (auto from : starts) {
+			for (auto it = players.lower_bound(from); it != players.end() && it->first < from + RANGE_SIZE; ++it) {
+				sum += it->second;
+			}
+		}
+		BenchUtil::Report("lower_bound + iterator", timer, starts.size());
+		Check("lower_bound + iterator", sum, starts, starts.size());
+
+		sum = 0;
+		timer.Reset();
+		for (auto from : starts) {
+			players.scan(from, from + RANGE_SIZE, size_t(-1), [&](const int64_t&, int64_t& value) { sum += value; });
+		}
+		BenchUtil::Report("scan", timer, starts.size());
+		Check("scan", sum, starts, starts.size());
+
+		delete env;
+	}
+
+	// 每次读到的是from开始的RANGE_SIZE个连续id
+	void Check(const char* name, int64_t sum, const std::vector<int64_t>& starts, size_t n) {
+		int64_t expect = 0;
+		for (size_t i = 0; i < n; i++) {
+			expect += starts[i] * RANGE_SIZE + RANGE_SIZE * (RANGE_SIZE - 1) / 2;
+		}
+		if (sum != expect) {
+			SMD_LOG_ERROR("%s mismatch, sum:%lld, expect:%lld", name, sum, expect);
+		}
+	}
+};
@@ -0,0 +1,107 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 排行榜按分数排序：普通shm_map只能从begin()往后数名次，shm_rank_map用子树大小直接算
+// 同时对比维护计数给插入删除带来的额外开销
+//
+class BenchRank {
+public:
+	struct StBenchRank {
+		smd::shm_map<int64_t, int64_t> map;
+		smd::shm_rank_map<int64_t, int64_t> board;
+	};
+
+	enum {
+		WALK_QUERY_COUNT = 20,
+		QUERY_COUNT = 100000,
+	};
+
+	BenchRank(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchRank>::Create(SHMID_BENCH_BASE + 19, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchRank count:%llu ====", count);
+		auto& entry = env->GetEntry();
+		auto ids = BenchUtil::ShuffledIds(count);
+
+		BenchTimer timer;
+		for (auto id : ids) {
+			entry.map.insert(std::make_pair(int64_t(id), int64_t(id)));
+		}
+		BenchUtil::Report("shm_map insert", timer, ids.size());
+
+		timer.Reset();
+		for (auto id : ids) {
+			entry.board.insert(std::make_pair(int64_t(id), int64_t(id)));
+		}
+		BenchUtil::Report("shm_rank_map insert", timer, ids.size());
+
+		std::vector<int64_t> queries;
+		for (size_t i = 0; i < QUERY_COUNT; i++) {
+			queries.push_back(int64_t(ids[i % ids.size()]));
+		}
+
+		// id是0到count-1，名次就是id本身
+		size_t sum = 0;
+		timer.Reset();
+		for (int i = 0; i < WALK_QUERY_COUNT; i++) {
+			for (auto it = entry.map.begin(); it != entry.map.end() && it->first < queries[i]; ++it) {
+				sum++;
+			}
+		}
+		BenchUtil::Report("shm_map rank by walk", timer, WALK_QUERY_COUNT);
+		Check("shm_map rank by walk", sum, queries, WALK_QUERY_COUNT);
+
+		sum = 0;
+		timer.Reset();
+		for (auto key : queries) {
+			sum += entry.board.rank(key);
+		}
+		BenchUtil::Report("shm_rank_map rank", timer, queries.size());
+		Check("shm_rank_map rank", sum, queries, queries.size());
+
+		sum = 0;
+		timer.Reset();
+		for (auto key : queries) {
+			sum += size_t(entry.board.select(size_t(key))->first);
+		}
+		BenchUtil::Report("shm_rank_map select", timer, queries.size());
+		Check("shm_rank_map select", sum, queries, queries.size());
+
+		timer.Reset();
+		for (auto id : ids) {
+			entry.map.erase(int64_t(id));
+		}
+		BenchUtil::Report("shm_map erase", timer, ids.size());
+
+		timer.Reset();
+		for (auto id : ids) {
+			entry.board.erase(int64_t(id));
+		}
+		BenchUtil::Report("shm_rank_map erase", timer, ids.size());
+
+		delete env;
+	}
+
+	void Check(const char* name, size_t sum, const std::vector<int64_t>& queries, size_t n) {
+		size_t expect = 0;
+		for (size_t i = 0; i < n; i++) {
+			expect += size_t(queries[i]);
+		}
+		if (sum != expect) {
+			SMD_LOG_ERROR("%s mismatch, sum:%llu, expect:%llu", name, sum, expect);
+		}
+	}
+};
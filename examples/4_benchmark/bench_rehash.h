@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 哈希表扩容时单次插入的延迟：逐个计时，看长尾
+//
+class BenchRehash {
+public:
+	struct StBenchRehash {
+		smd::shm_hash<uint64_t> pod_hash;
+	};
+
+	BenchRehash(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchRehash>::Create(SHMID_BENCH_BASE + 9, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchRehash count:%llu ====", count);
+		auto& pod_hash = env->GetEntry().pod_hash;
+		auto ids = BenchUtil::ShuffledIds(count);
+
+		std::vector<uint64_t> latency;
+		latency.reserve(count);
+		BenchTimer total;
+		for (auto id : ids) {
+			BenchTimer timer;
+			pod_hash.insert(id);
+			latency.push_back(timer.ElapsedNs());
+		}
+		BenchUtil::Report("shm_hash insert", total, count);
+
+		std::sort(latency.begin(), latency.end());
+		auto percentile = [&](double p) { return latency[std::min(count - 1, size_t(count * p))] / 1000.0; };
+		SMD_LOG_INFO("insert latency p50:%.2f us p99:%.2f us p99.9:%.2f us p99.99:%.2f us max:%.2f us",
+			percentile(0.5), percentile(0.99), percentile(0.999), percentile(0.9999), latency.back() / 1000.0);
+
+		delete env;
+	}
+};
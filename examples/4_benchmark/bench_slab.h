@@ -0,0 +1,107 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 小块内存分配的收益：分别在打开和关闭小块内存分配的情况下，跑一遍与test_map/test_list相同的负载
+// 每种容器插满之后记录实际占用的字节数（GetCommitted）和小块内存的页数，删空之后再记录一次，看页有没有还给伙伴系统
+//
+class BenchSlab {
+public:
+	struct StBenchSlab {
+		smd::shm_map<uint64_t, uint64_t> pod_map;
+		smd::shm_map<smd::shm_string, smd::shm_string> str_map;
+		smd::shm_list<smd::shm_string> str_list;
+		smd::shm_list<uint64_t> pod_list;
+	};
+
+	BenchSlab(size_t count) {
+		Run(true, count);
+		Run(false, count);
+	}
+
+private:
+	void Run(bool enable_slab, size_t count) {
+		smd::EnvOptions options;
+		options.enable_slab = enable_slab;
+		auto env = smd::Env<StBenchSlab>::Create(SHMID_BENCH_BASE + 1, 27, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchSlab enable_slab:%d count:%llu ====", enable_slab, count);
+		auto& entry = env->GetEntry();
+		auto ids = BenchUtil::ShuffledIds(count);
+
+		BenchTimer timer;
+		for (auto id : ids) {
+			entry.pod_map.insert(std::make_pair(id, id * 10));
+		}
+		BenchUtil::Report("shm_map<uint64_t, uint64_t> insert", timer, count);
+		ReportMemory("shm_map<uint64_t, uint64_t> full");
+
+		timer.Reset();
+		for (auto id : ids) {
+			entry.pod_map.erase(entry.pod_map.find(id));
+		}
+		BenchUtil::Report("shm_map<uint64_t, uint64_t> erase", timer, count);
+		ReportMemory("shm_map<uint64_t, uint64_t> empty");
+
+		std::vector<std::string> keys;
+		keys.reserve(count);
+		for (auto id : ids) {
+			keys.push_back(smd::util::Text::Format("Key%08llu", id));
+		}
+
+		timer.Reset();
+		for (const auto& key : keys) {
+			entry.str_map.insert(std::make_pair(smd::shm_string(key), smd::shm_string(key)));
+		}
+		BenchUtil::Report("shm_map<shm_string, shm_string> insert", timer, count);
+		ReportMemory("shm_map<shm_string, shm_string> full");
+
+		timer.Reset();
+		for (const auto& key : keys) {
+			entry.str_map.erase(entry.str_map.find(key));
+		}
+		BenchUtil::Report("shm_map<shm_string, shm_string> erase", timer, count);
+		ReportMemory("shm_map<shm_string, shm_string> empty");
+
+		timer.Reset();
+		for (const auto& key : keys) {
+			entry.str_list.push_back(key);
+		}
+		BenchUtil::Report("shm_list<shm_string> push_back", timer, count);
+		ReportMemory("shm_list<shm_string> full");
+
+		timer.Reset();
+		for (size_t i = 0; i < count; i++) {
+			entry.str_list.pop_front();
+		}
+		BenchUtil::Report("shm_list<shm_string> pop_front", timer, count);
+		ReportMemory("shm_list<shm_string> empty");
+
+		// 24字节的节点，关闭小块内存分配时按伙伴系统的最小块分配
+		timer.Reset();
+		for (auto id : ids) {
+			entry.pod_list.push_back(id);
+		}
+		BenchUtil::Report("shm_list<uint64_t> push_back", timer, count);
+		ReportMemory("shm_list<uint64_t> full");
+
+		timer.Reset();
+		for (size_t i = 0; i < count; i++) {
+			entry.pod_list.pop_front();
+		}
+		BenchUtil::Report("shm_list<uint64_t> pop_front", timer, count);
+		ReportMemory("shm_list<uint64_t> empty");
+
+		delete env;
+	}
+
+	static void ReportMemory(const char* name) {
+		SMD_LOG_INFO("%-40s used:%llu committed:%llu slab pages:%llu", name, smd::g_alloc->GetUsed(),
+			smd::g_alloc->GetCommitted(), smd::g_alloc->GetSlabPages());
+	}
+};
@@ -0,0 +1,81 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// SmdEnv的字符串读写：用Slice直接查找和先构造shm_string临时对象再查找的对比
+// 同时统计每次操作的共享内存分配次数
+//
+class BenchSlice {
+public:
+	BenchSlice(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = (smd::SmdEnv*)smd::SmdEnv::Create(SHMID_BENCH_BASE + 11, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchSlice count:%llu ====", count);
+		std::vector<std::string> keys;
+		keys.reserve(count);
+		for (auto id : BenchUtil::ShuffledIds(count)) {
+			keys.push_back("player_name_key_" + std::to_string(id));
+		}
+		for (auto& key : keys) {
+			env->SSet(key, "value_of_player_0000");
+		}
+
+		auto& all_strings = env->GetAllStrings();
+		size_t hit = 0;
+		auto malloc_count = smd::g_alloc->GetMallocCount();
+		BenchTimer timer;
+		for (auto& key : keys) {
+			// 改动之前SGet的做法
+			smd::shm_string str_key(key.data(), key.size());
+			hit += all_strings.find(str_key) != all_strings.end() ? 1 : 0;
+		}
+		Report("shm_string temp get", timer, keys.size(), malloc_count);
+
+		malloc_count = smd::g_alloc->GetMallocCount();
+		timer.Reset();
+		for (auto& key : keys) {
+			hit += env->SGet(key, nullptr) ? 1 : 0;
+		}
+		Report("SGet by Slice", timer, keys.size(), malloc_count);
+
+		malloc_count = smd::g_alloc->GetMallocCount();
+		timer.Reset();
+		for (auto& key : keys) {
+			smd::shm_string str_key(key.data(), key.size());
+			auto it = all_strings.find(str_key);
+			it->second = smd::Slice("value_of_player_0001").ToString();
+		}
+		Report("shm_string temp overwrite", timer, keys.size(), malloc_count);
+
+		malloc_count = smd::g_alloc->GetMallocCount();
+		timer.Reset();
+		for (auto& key : keys) {
+			env->SSet(key, "value_of_player_0002");
+		}
+		Report("SSet overwrite by Slice", timer, keys.size(), malloc_count);
+
+		// 结果要用到，否则查找会被优化掉
+		if (hit != keys.size() * 2) {
+			SMD_LOG_ERROR("get mismatch, hit:%llu", hit);
+		}
+
+		delete env;
+	}
+
+	static void Report(const char* name, const BenchTimer& timer, size_t ops, size_t malloc_count) {
+		BenchUtil::Report(name, timer, ops);
+		SMD_LOG_INFO("%-40s %10.2f malloc/op", name, double(smd::g_alloc->GetMallocCount() - malloc_count) / ops);
+	}
+};
@@ -0,0 +1,47 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 冷启动耗时：不同level下创建共享内存字典，以及第一次分配所需的时间
+//
+class BenchStartup {
+public:
+	struct StBenchStartup {
+		smd::shm_map<uint64_t, uint64_t> pod_map;
+	};
+
+	BenchStartup(unsigned min_level, unsigned max_level) {
+		for (unsigned level = min_level; level <= max_level; level++) {
+			Run(smd::BuddyType::kTree, "tree", level);
+			Run(smd::BuddyType::kFreeList, "free list", level);
+		}
+	}
+
+private:
+	void Run(smd::BuddyType buddy_type, const char* name, unsigned level) {
+		auto log_level = smd::g_log->GetLogLevel();
+		smd::g_log->SetLogLevel(smd::Log::LogLevel::kWarning);
+
+		smd::EnvOptions options;
+		options.buddy_type = buddy_type;
+
+		BenchTimer timer;
+		auto env = smd::Env<StBenchStartup>::Create(SHMID_BENCH_BASE + 4, level, false, options);
+		auto create_ns = timer.ElapsedNs();
+		smd::g_log->SetLogLevel(log_level);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed, level:%u", level);
+			return;
+		}
+
+		timer.Reset();
+		env->GetEntry().pod_map.insert(std::make_pair(1, 1));
+		auto first_ns = timer.ElapsedNs();
+
+		SMD_LOG_INFO("level:%2u %-10s create:%10.3f ms  first insert:%8.3f ms", level, name, create_ns / 1000000.0,
+			first_ns / 1000000.0);
+
+		delete env;
+	}
+};
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 短字符串的key和value：玩家名、道具key、时间戳都在SSO_CAPACITY以内，放在shm_string内部，不需要分配
+// 统计插入耗时、每个元素实际占用的共享内存和分配次数
+//
+class BenchString {
+public:
+	struct StBenchString {
+		smd::shm_map<smd::shm_string, smd::shm_string> strings;
+	};
+
+	BenchString(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchString>::Create(SHMID_BENCH_BASE + 13, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchString count:%llu sizeof(shm_string):%llu ====", count, sizeof(smd::shm_string));
+		auto& strings = env->GetEntry().strings;
+		auto ids = BenchUtil::ShuffledIds(count);
+
+		auto committed = smd::g_alloc->GetCommitted();
+		auto malloc_count = smd::g_alloc->GetMallocCount();
+		char key[32];
+		BenchTimer timer;
+		for (auto id : ids) {
+			int len = snprintf(key, sizeof(key), "player_%llu", (unsigned long long)id);
+			strings.insert(std::make_pair(smd::shm_string(key, len), smd::shm_string("2026-10-18-10-00-00")));
+		}
+		BenchUtil::Report("shm_map<shm_string> insert", timer, count);
+		SMD_LOG_INFO("memory: %.1f bytes/entry, malloc: %.2f/entry",
+			double(smd::g_alloc->GetCommitted() - committed) / count,
+			double(smd::g_alloc->GetMallocCount() - malloc_count) / count);
+
+		timer.Reset();
+		size_t hit = 0;
+		for (auto id : ids) {
+			int len = snprintf(key, sizeof(key), "player_%llu", (unsigned long long)id);
+			hit += strings.find(smd::Slice(key, len)) != strings.end() ? 1 : 0;
+		}
+		BenchUtil::Report("shm_map<shm_string> find", timer, count);
+
+		if (hit != count) {
+			SMD_LOG_ERROR("find mismatch, hit:%llu", hit);
+		}
+
+		delete env;
+	}
+};
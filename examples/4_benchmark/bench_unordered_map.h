@@ -0,0 +1,84 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 按玩家ID存放玩家数据：shm_unordered_map和红黑树的shm_map对比
+// 玩家结构和3_game_and_db里生成的UniqsModel::Player一样，带有字符串和嵌套的容器
+//
+class BenchUnorderedMap {
+public:
+	struct BenchPlayer {
+		uint64_t playerid = 0;
+		int level = 0;
+		smd::shm_string playername;
+		smd::shm_string lastlogintime;
+		smd::shm_string lastlogouttime;
+		smd::shm_map<int64_t, int64_t> items;
+		smd::shm_map<int, int> equips1;
+		smd::shm_map<uint64_t, int> equips2;
+	};
+
+	struct StBenchUnorderedMap {
+		smd::shm_map<int64_t, BenchPlayer> player_map;
+		smd::shm_unordered_map<int64_t, BenchPlayer> player_hash;
+	};
+
+	BenchUnorderedMap(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchUnorderedMap>::Create(SHMID_BENCH_BASE + 10, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchUnorderedMap count:%llu ====", count);
+		auto& entry = env->GetEntry();
+		auto ids = BenchUtil::ShuffledIds(count);
+
+		Bench("shm_map", entry.player_map, ids);
+		Bench("shm_unordered_map", entry.player_hash, ids);
+
+		delete env;
+	}
+
+	template <class Container>
+	void Bench(const std::string& name, Container& players, const std::vector<uint64_t>& ids) {
+		BenchPlayer player;
+		player.level = 1;
+		player.playername = "I am player";
+		player.lastlogintime = "2026-10-18-10-00-00";
+
+		BenchTimer timer;
+		for (auto id : ids) {
+			player.playerid = id;
+			players.insert(std::make_pair(int64_t(id), player));
+		}
+		BenchUtil::Report((name + " insert").c_str(), timer, ids.size());
+
+		timer.Reset();
+		int64_t level = 0;
+		for (auto id : ids) {
+			auto it = players.find(int64_t(id));
+			level += it->second.level;
+		}
+		BenchUtil::Report((name + " find").c_str(), timer, ids.size());
+
+		// 结果要用到，否则查找会被优化掉
+		if (level != int64_t(ids.size())) {
+			SMD_LOG_ERROR("%s find mismatch, level:%lld", name.c_str(), level);
+		}
+
+		timer.Reset();
+		for (auto id : ids) {
+			players.erase(players.find(int64_t(id)));
+		}
+		BenchUtil::Report((name + " erase").c_str(), timer, ids.size());
+	}
+};
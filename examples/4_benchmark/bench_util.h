@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <chrono>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <smd.h>
+
+// 基准测试使用的共享内存key，每个用例在此基础上加上自己的编号
+#define SHMID_BENCH_BASE 0x00118800
+
+class BenchTimer {
+public:
+	BenchTimer()
+		: m_start(std::chrono::steady_clock::now()) {}
+
+	void Reset() {
+		m_start = std::chrono::steady_clock::now();
+	}
+
+	// 从开始到现在经过的纳秒数
+	uint64_t ElapsedNs() const {
+		auto now = std::chrono::steady_clock::now();
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start).count();
+	}
+
+	double ElapsedMs() const {
+		return ElapsedNs() / 1000000.0;
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_start;
+};
+
+class BenchUtil {
+public:
+	// 打乱顺序的0~count-1
+	static std::vector<uint64_t> ShuffledIds(size_t count) {
+		std::vector<uint64_t> ids;
+		ids.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			ids.push_back(i);
+		}
+
+		std::default_random_engine generator{std::random_device{}()};
+		std::shuffle(ids.begin(), ids.end(), generator);
+		return ids;
+	}
+
+	static void Report(const char* name, const BenchTimer& timer, size_t ops) {
+		auto ns = timer.ElapsedNs();
+		SMD_LOG_INFO("%-40s %10.2f ms %10.1f ns/op", name, ns / 1000000.0, ops > 0 ? double(ns) / ops : 0.0);
+	}
+};
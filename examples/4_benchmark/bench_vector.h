@@ -0,0 +1,139 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// shm_vector的尾部插入和遍历：和每个元素单独分配、数组里只存指针的旧布局，以及std::vector对比
+//
+class BenchVector {
+public:
+	struct StBenchVector {
+		smd::shm_vector<uint64_t> pod_vector;
+	};
+
+	BenchVector(size_t count) {
+		Run(count);
+	}
+
+private:
+	// 旧的shm_vector：数组里存放元素的指针，元素各自分配
+	class PointerArray {
+	public:
+		~PointerArray() {
+			for (size_t i = 0; i < m_size; i++) {
+				smd::g_alloc->Delete(m_start[i]);
+			}
+			if (m_start != smd::shm_nullptr)
+				smd::g_alloc->Free(m_start, m_capacity);
+		}
+
+		void push_back(uint64_t value) {
+			if (m_size == m_capacity) {
+				size_t new_capacity = m_capacity == 0 ? 1 : m_capacity * 2;
+				auto new_start = smd::g_alloc->Malloc<smd::shm_pointer<uint64_t>>(new_capacity);
+				if (m_size > 0) {
+					memcpy(new_start.Ptr(), m_start.Ptr(), sizeof(smd::shm_pointer<uint64_t>) * m_size);
+					smd::g_alloc->Free(m_start, m_capacity);
+				}
+				m_start = new_start;
+				m_capacity = new_capacity;
+			}
+			m_start[m_size++] = smd::g_alloc->New<uint64_t>(value);
+		}
+
+		uint64_t& operator[](size_t i) {
+			return *m_start[i];
+		}
+
+		size_t size() const {
+			return m_size;
+		}
+
+	private:
+		smd::shm_pointer<smd::shm_pointer<uint64_t>> m_start = smd::shm_nullptr;
+		size_t m_size = 0;
+		size_t m_capacity = 0;
+	};
+
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = smd::Env<StBenchVector>::Create(SHMID_BENCH_BASE + 7, 28, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchVector count:%llu ====", count);
+		const uint64_t expect = uint64_t(count) * (count - 1) / 2;
+		BenchTimer timer;
+
+		do {
+			PointerArray v;
+			timer.Reset();
+			for (size_t i = 0; i < count; i++) {
+				v.push_back(i);
+			}
+			BenchUtil::Report("pointer array push_back", timer, count);
+
+			timer.Reset();
+			uint64_t sum = 0;
+			for (size_t i = 0; i < v.size(); i++) {
+				sum += v[i];
+			}
+			BenchUtil::Report("pointer array iterate", timer, count);
+			Check(sum, expect);
+		} while (false);
+
+		do {
+			auto& v = env->GetEntry().pod_vector;
+			timer.Reset();
+			for (size_t i = 0; i < count; i++) {
+				v.push_back(i);
+			}
+			BenchUtil::Report("shm_vector push_back", timer, count);
+
+			timer.Reset();
+			uint64_t sum = 0;
+			for (size_t i = 0; i < v.size(); i++) {
+				sum += v[i];
+			}
+			BenchUtil::Report("shm_vector iterate by index", timer, count);
+			Check(sum, expect);
+
+			timer.Reset();
+			sum = 0;
+			for (auto value : v) {
+				sum += value;
+			}
+			BenchUtil::Report("shm_vector iterate by iterator", timer, count);
+			Check(sum, expect);
+		} while (false);
+
+		do {
+			std::vector<uint64_t> v;
+			timer.Reset();
+			for (size_t i = 0; i < count; i++) {
+				v.push_back(i);
+			}
+			BenchUtil::Report("std::vector push_back", timer, count);
+
+			timer.Reset();
+			uint64_t sum = 0;
+			for (auto value : v) {
+				sum += value;
+			}
+			BenchUtil::Report("std::vector iterate", timer, count);
+			Check(sum, expect);
+		} while (false);
+
+		delete env;
+	}
+
+	// 结果要用到，否则遍历会被优化掉
+	void Check(uint64_t sum, uint64_t expect) {
+		if (sum != expect) {
+			SMD_LOG_ERROR("sum mismatch, sum:%llu, expect:%llu", sum, expect);
+		}
+	}
+};
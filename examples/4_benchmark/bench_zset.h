@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <smd.h>
+#include "bench_util.h"
+
+//
+// 排行榜：count个玩家的shm_zset，依次测试ZADD、ZINCRBY、ZSCORE、ZRANK、取前10名、按分数取一页、ZREM
+// 玩家名是短字符串，放在shm_string内部
+//
+class BenchZSet {
+public:
+	enum {
+		QUERY_COUNT = 1000000,
+		PAGE_SIZE = 100,
+	};
+
+	BenchZSet(size_t count) {
+		Run(count);
+	}
+
+private:
+	void Run(size_t count) {
+		smd::EnvOptions options;
+		options.buddy_type = smd::BuddyType::kFreeList;
+		auto env = (smd::SmdEnv*)smd::SmdEnv::Create(SHMID_BENCH_BASE + 20, 30, false, options);
+		if (env == nullptr) {
+			SMD_LOG_ERROR("Create env failed");
+			return;
+		}
+
+		SMD_LOG_INFO("==== BenchZSet count:%llu ====", count);
+		auto& board = env->GetAllZSets()[smd::shm_string("board")];
+		auto ids = BenchUtil::ShuffledIds(count);
+		std::vector<std::string> names;
+		names.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			names.push_back(smd::util::Text::Format("player%llu", (unsigned long long)i));
+		}
+
+		// 分数有大量重复，同分时按名字排序
+		auto committed = smd::g_alloc->GetCommitted();
+		BenchTimer timer;
+		for (auto id : ids) {
+			board.add(names[id], double(id % 100000));
+		}
+		BenchUtil::Report("zadd", timer, count);
+		SMD_LOG_INFO("memory: %.1f bytes/member", double(smd::g_alloc->GetCommitted() - committed) / count);
+
+		std::vector<uint64_t> queries;
+		for (size_t i = 0; i < QUERY_COUNT; i++) {
+			queries.push_back(ids[i * 7919 % count]);
+		}
+
+		timer.Reset();
+		for (auto id : queries) {
+			board.incrby(names[id], 1);
+		}
+		BenchUtil::Report("zincrby", timer, queries.size());
+
+		double sum = 0;
+		timer.Reset();
+		for (auto id : queries) {
+			double score = 0;
+			board.score(names[id], &score);
+			sum += score;
+		}
+		BenchUtil::Report("zscore", timer, queries.size());
+
+		size_t rank_sum = 0;
+		timer.Reset();
+		for (auto id : queries) {
+			size_t rank = 0;
+			board.revrank(names[id], &rank);
+			rank_sum += rank;
+		}
+		BenchUtil::Report("zrevrank", timer, queries.size());
+
+		size_t visited = 0;
+		timer.Reset();
+		for (size_t i = 0; i < queries.size(); i++) {
+			visited += board.range(-10, -1, [&](const smd::shm_string&, double score) { sum += score; });
+		}
+		BenchUtil::Report("zrange top 10", timer, queries.size());
+
+		timer.Reset();
+		for (auto id : queries) {
+			visited += board.range_by_score(double(id % 100000), 1e18, 0, PAGE_SIZE,
+				[&](const smd::shm_string&, double score) { sum += score; });
+		}
+		BenchUtil::Report("zrangebyscore page", timer, queries.size());
+
+		timer.Reset();
+		for (auto id : ids) {
+			board.remove(names[id]);
+		}
+		BenchUtil::Report("zrem", timer, count);
+
+		if (!board.empty() || rank_sum >= count * queries.size() || visited == 0 || sum <= 0) {
+			SMD_LOG_ERROR("zset mismatch, size:%llu, visited:%llu", board.size(), visited);
+		}
+
+		delete env;
+	}
+};
@@ -0,0 +1,154 @@
+﻿#include <stdio.h>
+#include <iostream>
+#include <algorithm>
+#include <smd.h>
+
+#include "bench_util.h"
+#include "bench_slab.h"
+#include "bench_buddy.h"
+#include "bench_large.h"
+#include "bench_startup.h"
+#include "bench_hugepage.h"
+#include "bench_mmap.h"
+#include "bench_vector.h"
+#include "bench_flat_hash.h"
+#include "bench_rehash.h"
+#include "bench_unordered_map.h"
+#include "bench_slice.h"
+#include "bench_hash.h"
+#include "bench_string.h"
+#include "bench_istring.h"
+#include "bench_move.h"
+#include "bench_list.h"
+#include "bench_btree.h"
+#include "bench_range.h"
+#include "bench_rank.h"
+#include "bench_zset.h"
+#include "bench_expire.h"
+#include "bench_batch.h"
+#include "bench_pointer.h"
+
+int main(int argc, char* argv[]) {
+	smd::SetLogHandler(
+		[](smd::Log::LogLevel lv, const char* msg) {
+			std::string time_now = smd::util::Time::FormatDateTime(std::chrono::system_clock::now());
+			switch (lv) {
+			case smd::Log::LogLevel::kError:
+				printf("%s Error: %s\n", time_now.c_str(), msg);
+				break;
+			case smd::Log::LogLevel::kWarning:
+				printf("%s Warning: %s\n", time_now.c_str(), msg);
+				break;
+			case smd::Log::LogLevel::kInfo:
+				printf("%s Info: %s\n", time_now.c_str(), msg);
+				break;
+			case smd::Log::LogLevel::kDebug:
+				printf("%s Debug: %s\n", time_now.c_str(), msg);
+				break;
+			default:
+				break;
+			}
+		},
+		smd::Log::LogLevel::kInfo);
+
+	// 用法：Benchmark [用例名称|all] [数据量]
+	const std::string name = argc >= 2 ? argv[1] : "all";
+	const size_t count = argc >= 3 ? (size_t)std::atoll(argv[2]) : 100000;
+	auto match = [&](const char* bench_name) { return name == "all" || name == bench_name; };
+
+	if (match("slab")) {
+		BenchSlab bench_slab(count);
+	}
+
+	if (match("buddy")) {
+		BenchBuddy bench_buddy(count);
+	}
+
+	if (match("startup")) {
+		BenchStartup bench_startup(20, 32);
+	}
+
+	if (match("hugepage")) {
+		BenchHugePage bench_hugepage(count);
+	}
+
+	if (match("mmap")) {
+		BenchMmap bench_mmap(count, "smd_bench.mmap");
+	}
+
+	if (match("vector")) {
+		BenchVector bench_vector(count);
+	}
+
+	if (match("flat_hash")) {
+		BenchFlatHash bench_flat_hash(count);
+	}
+
+	if (match("rehash")) {
+		BenchRehash bench_rehash(count);
+	}
+
+	if (match("unordered_map")) {
+		BenchUnorderedMap bench_unordered_map(count);
+	}
+
+	if (match("slice")) {
+		BenchSlice bench_slice(count);
+	}
+
+	if (match("hash")) {
+		BenchHash bench_hash(count);
+	}
+
+	if (match("string")) {
+		BenchString bench_string(count);
+	}
+
+	if (match("istring")) {
+		BenchIString bench_istring(count);
+	}
+
+	if (match("move")) {
+		BenchMove bench_move(count);
+	}
+
+	if (match("list")) {
+		BenchList bench_list(count);
+	}
+
+	if (match("btree")) {
+		BenchBTree bench_btree(count);
+	}
+
+	if (match("range")) {
+		BenchRange bench_range(count);
+	}
+
+	if (match("rank")) {
+		BenchRank bench_rank(count);
+	}
+
+	if (match("zset")) {
+		BenchZSet bench_zset(count);
+	}
+
+	if (match("expire")) {
+		BenchExpire bench_expire(count);
+	}
+
+	if (match("batch")) {
+		BenchBatch bench_batch(count);
+	}
+
+	if (match("pointer")) {
+		BenchPointer bench_pointer(count);
+	}
+
+	// 需要8G以上的虚拟地址空间，只有明确指定的时候才运行
+	if (name == "large") {
+		BenchLarge bench_large(count > 32 && count <= smd::SmdBuddyListAlloc::MAX_LEVEL ? unsigned(count) : 33);
+	}
+
+	SMD_LOG_INFO("completed");
+	return 0;
+}
@@ -1,4 +1,6 @@
 ﻿#pragma once
+#include <stdint.h>
+#include <type_traits>
 
 namespace smd {
 
@@ -8,8 +10,28 @@ int64_t compare(const T& x, const T& y) {
 }
 
 template <>
-int64_t compare(const uint64_t& x, const uint64_t& y) {
+inline int64_t compare(const uint64_t& x, const uint64_t& y) {
 	return x - y;
 }
 
+//
+// 不需要构造出Key就能直接查找的类型，比如用Slice查找shm_string，省掉一次共享内存的分配和释放
+// 特化为true_type的类型需要提供和Key之间的compare、==，以及std::hash<Key>对它的重载，结果和转换成Key之后一致
+//
+template <class Key, class K>
+struct is_transparent_key : std::false_type {};
+
+template <class Key, class K>
+constexpr bool is_transparent_key_v = is_transparent_key<Key, std::decay_t<K>>::value;
+
+// 对哈希值再做一次混合（murmur3的fmix64），std::hash对整数是恒等映射，按2的幂取模之前需要把高位扩散到低位
+inline uint64_t HashMix(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
 } // namespace smd
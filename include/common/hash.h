@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <stdint.h>
+#include <string.h>
+#ifdef _WIN32
+	#include <intrin.h>
+#endif
+
+namespace smd {
+
+//
+// 字节串的哈希函数，算法来自wyhash（final4版本，公有领域）
+// 直接读原始数据，不需要复制出std::string；种子和常量固定，同样的数据在不同进程、不同编译器下结果一样，
+// 哈希值可以保存在共享内存里，热重启之后依然有效
+//
+class BytesHash {
+public:
+	static uint64_t Hash(const void* key, size_t len, uint64_t seed = 0) {
+		const uint8_t* p = (const uint8_t*)key;
+		seed ^= Mix(seed ^ kSecret[0], kSecret[1]);
+
+		uint64_t a, b;
+		if (len <= 16) {
+			if (len >= 4) {
+				a = (Read4(p) << 32) | Read4(p + ((len >> 3) << 2));
+				b = (Read4(p + len - 4) << 32) | Read4(p + len - 4 - ((len >> 3) << 2));
+			} else if (len > 0) {
+				a = Read3(p, len);
+				b = 0;
+			} else {
+				a = b = 0;
+			}
+		} else {
+			size_t i = len;
+			if (i > 48) {
+				uint64_t see1 = seed, see2 = seed;
+				do {
+					seed = Mix(Read8(p) ^ kSecret[1], Read8(p + 8) ^ seed);
+					see1 = Mix(Read8(p + 16) ^ kSecret[2], Read8(p + 24) ^ see1);
+					see2 = Mix(Read8(p + 32) ^ kSecret[3], Read8(p + 40) ^ see2);
+					p += 48;
+					i -= 48;
+				} while (i > 48);
+				seed ^= see1 ^ see2;
+			}
+
+			while (i > 16) {
+				seed = Mix(Read8(p) ^ kSecret[1], Read8(p + 8) ^ seed);
+				i -= 16;
+				p += 16;
+			}
+
+			a = Read8(p + i - 16);
+			b = Read8(p + i - 8);
+		}
+
+		a ^= kSecret[1];
+		b ^= seed;
+		Multiply(a, b);
+		return Mix(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+	}
+
+private:
+	static constexpr uint64_t kSecret[4] = {
+		0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+	// 128位乘积，低64位放在a，高64位放在b
+	static void Multiply(uint64_t& a, uint64_t& b) {
+#ifdef _WIN32
+		uint64_t hi;
+		a = _umul128(a, b, &hi);
+		b = hi;
+#else
+		__uint128_t r = a;
+		r *= b;
+		a = (uint64_t)r;
+		b = (uint64_t)(r >> 64);
+#endif
+	}
+
+	static uint64_t Mix(uint64_t a, uint64_t b) {
+		Multiply(a, b);
+		return a ^ b;
+	}
+
+	static uint64_t Read8(const uint8_t* p) {
+		uint64_t v;
+		memcpy(&v, p, 8);
+		return v;
+	}
+
+	static uint64_t Read4(const uint8_t* p) {
+		uint32_t v;
+		memcpy(&v, p, 4);
+		return v;
+	}
+
+	// 1~3个字节
+	static uint64_t Read3(const uint8_t* p, size_t k) {
+		return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+	}
+};
+
+} // namespace smd
@@ -39,6 +39,10 @@ public:
 		m_log_level = lv;
 	}
 
+	LogLevel GetLogLevel() const {
+		return m_log_level;
+	}
+
 	void DoLog(LogLevel lv, const char* fmt, ...) {
 		if (lv <= m_log_level) {
 			char buf[1024];
@@ -63,9 +67,9 @@ private:
 	LogLevel m_log_level = LogLevel::kDebug;
 };
 
-static Log* g_log = nullptr;
+inline Log* g_log = nullptr;
 
-static void SetLogHandler(Log::LOG_FUNC&& func, Log::LogLevel log_level) {
+inline void SetLogHandler(Log::LOG_FUNC&& func, Log::LogLevel log_level) {
 	if (g_log != nullptr) {
 		delete g_log;
 		g_log = nullptr;
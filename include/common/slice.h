@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <cstring>
 #include <string>
+#include <string_view>
 
 namespace smd {
 
@@ -24,6 +25,11 @@ public:
 		: data_(s.data())
 		, size_(s.size()) {}
 
+	// Create a slice that refers to the contents of "s"
+	Slice(std::string_view s)
+		: data_(s.data())
+		, size_(s.size()) {}
+
 	// Create a slice that refers to s[0,strlen(s)-1]
 	Slice(const char* s)
 		: data_(s)
@@ -46,6 +46,13 @@ public:
 
 class Time {
 public:
+	// 1970年以来的毫秒数，用墙上时间，机器重启之后保存在文件里的时间依然有效
+	static int64_t NowMs() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch())
+			.count();
+	}
+
 	static tm LocalTime(time_t t) {
 		tm this_tm;
 #ifdef _WIN32
@@ -335,6 +342,22 @@ public:
 		x |= x >> 16;
 		return x + 1;
 	}
+
+	static inline uint64_t IsPowOf2(uint64_t x) {
+		return !(x & (x - 1));
+	}
+
+	static inline uint64_t NextPowOf2(uint64_t x) {
+		if (IsPowOf2(x))
+			return x;
+		x |= x >> 1;
+		x |= x >> 2;
+		x |= x >> 4;
+		x |= x >> 8;
+		x |= x >> 16;
+		x |= x >> 32;
+		return x + 1;
+	}
 };
 
 } // namespace util
@@ -0,0 +1,965 @@
+﻿#pragma once
+#include <new>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+#include <tuple>
+#include <utility>
+#include <common/functional.h>
+#include <container/shm_pointer.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+	#define SMD_BTREE_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+namespace smd {
+
+enum : size_t {
+	BTREE_NODE_BYTES = 512, // 节点的目标大小：8个cache line，超过小块内存的规格，由伙伴系统按512字节对齐分配
+	BTREE_MAX_HEIGHT = 32,
+};
+
+//
+// 叶子节点：键值对按key有序连续存放，叶子之间双向链接，遍历和范围扫描顺着链表走
+//
+template <typename Value, size_t Slots>
+struct alignas(64) BTreeLeaf {
+	uint32_t count = 0;
+	shm_pointer<BTreeLeaf> prev;
+	shm_pointer<BTreeLeaf> next;
+	alignas(Value) unsigned char storage[sizeof(Value) * Slots];
+
+	Value* slots() {
+		return (Value*)storage;
+	}
+
+	Value& slot(size_t i) {
+		return slots()[i];
+	}
+};
+
+//
+// 内部节点：count个分隔key连续存放，后面是count+1个孩子
+// 孩子i中的key都小于keys[i]，孩子i+1中的key都不小于keys[i]；孩子是叶子还是内部节点由所在的层决定，这里只存原始指针
+//
+template <typename Key, size_t Slots>
+struct alignas(64) BTreeInner {
+	uint32_t count = 0;
+	alignas(Key) unsigned char storage[sizeof(Key) * Slots];
+	int64_t children[Slots + 1];
+
+	Key* keys() {
+		return (Key*)storage;
+	}
+
+	Key& key(size_t i) {
+		return keys()[i];
+	}
+};
+
+// 把n个元素从src搬到dst，原来的元素随之销毁，两段可以重叠
+template <typename T>
+void BTreeRelocate(T* dst, T* src, size_t n) {
+	if (dst == src || n == 0)
+		return;
+
+	if (std::is_trivially_copyable<T>::value) {
+		memmove((void*)dst, (const void*)src, sizeof(T) * n);
+	} else if (dst < src) {
+		for (size_t i = 0; i < n; i++) {
+			::new (dst + i) T(std::move(src[i]));
+			src[i].~T();
+		}
+	} else {
+		for (size_t i = n; i > 0; i--) {
+			::new (dst + i - 1) T(std::move(src[i - 1]));
+			src[i - 1].~T();
+		}
+	}
+}
+
+#ifdef SMD_BTREE_SSE2
+// SSE2没有64位整数的比较：高32位按有符号比较，高32位相等时由b - a的借位决定
+inline __m128i BTreeGreater64(__m128i a, __m128i b) {
+	__m128i r = _mm_and_si128(_mm_cmpeq_epi32(a, b), _mm_sub_epi64(b, a));
+	r = _mm_or_si128(r, _mm_cmpgt_epi32(a, b));
+	return _mm_shuffle_epi32(r, _MM_SHUFFLE(3, 3, 1, 1));
+}
+#endif
+
+//
+// 整数key数组中大于k的个数，内部节点的key连续存放，一次比较多个
+// 无符号数翻转最高位之后按有符号数比较
+//
+template <typename Int>
+size_t BTreeCountGreater(const Int* keys, size_t n, Int k) {
+	size_t count = 0;
+	size_t i = 0;
+#ifdef SMD_BTREE_SSE2
+	if (sizeof(Int) == 8) {
+		const __m128i flip = _mm_set1_epi64x(std::is_signed<Int>::value ? 0 : INT64_MIN);
+		const __m128i kv = _mm_xor_si128(_mm_set1_epi64x(int64_t(k)), flip);
+		for (; i + 2 <= n; i += 2) {
+			__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), flip);
+			int mask = _mm_movemask_pd(_mm_castsi128_pd(BTreeGreater64(v, kv)));
+			count += (mask & 1) + (mask >> 1);
+		}
+	} else if (sizeof(Int) == 4) {
+		const __m128i flip = _mm_set1_epi32(std::is_signed<Int>::value ? 0 : INT32_MIN);
+		const __m128i kv = _mm_xor_si128(_mm_set1_epi32(int32_t(k)), flip);
+		for (; i + 4 <= n; i += 4) {
+			__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), flip);
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, kv)));
+			count += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + (mask >> 3);
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		count += keys[i] > k ? 1 : 0;
+	}
+	return count;
+}
+
+// 整数直接比较，其他类型和shm_map一样使用smd::compare，可以用透明的key查找
+template <typename Key, typename K, typename = void>
+struct BTreeKeyCompare {
+	static bool Less(const Key& key, const K& k) {
+		return smd::compare(k, key) > 0;
+	}
+
+	static bool Greater(const Key& key, const K& k) {
+		return smd::compare(k, key) < 0;
+	}
+};
+
+template <typename Key>
+struct BTreeKeyCompare<Key, Key, std::enable_if_t<std::is_integral<Key>::value>> {
+	static bool Less(const Key& key, const Key& k) {
+		return key < k;
+	}
+
+	static bool Greater(const Key& key, const Key& k) {
+		return key > k;
+	}
+};
+
+template <typename Leaf, typename Pointer, typename Reference>
+struct btree_iterator {
+	typedef btree_iterator<Leaf, Pointer, Reference> this_type;
+
+	shm_pointer<Leaf> _leaf;
+	uint32_t _index;
+
+	btree_iterator()
+		: _leaf(shm_nullptr)
+		, _index(0) {}
+	btree_iterator(shm_pointer<Leaf> leaf, size_t index)
+		: _leaf(leaf)
+		, _index(uint32_t(index)) {}
+	btree_iterator(const this_type& x) = default;
+
+	Reference operator*() const {
+		return _leaf->slot(_index);
+	}
+
+	Pointer operator->() const {
+		return &_leaf->slot(_index);
+	}
+
+	btree_iterator& operator++() {
+		if (++_index == _leaf->count) {
+			_leaf = _leaf->next;
+			_index = 0;
+		}
+		return *this;
+	}
+
+	btree_iterator operator++(int) {
+		this_type tmp(*this);
+		++*this;
+		return tmp;
+	}
+
+	// 和shm_map一样，不能从end()往回退
+	btree_iterator& operator--() {
+		if (_index == 0) {
+			_leaf = _leaf->prev;
+			_index = _leaf != shm_nullptr ? _leaf->count - 1 : 0;
+		} else {
+			--_index;
+		}
+		return *this;
+	}
+
+	btree_iterator operator--(int) {
+		this_type tmp(*this);
+		--*this;
+		return tmp;
+	}
+
+	bool operator==(const this_type& x) const {
+		return _leaf == x._leaf && _index == x._index;
+	}
+
+	bool operator!=(const this_type& x) const {
+		return !(*this == x);
+	}
+};
+
+//
+// B+树实现的有序map，接口和迭代器与shm_map一致
+// 每个节点放若干个key，节点按cache line对齐，查找只需要访问树高（百万级元素约5层）个节点，红黑树要访问约2logn个
+// 所有的键值对都在叶子中，叶子链成双向链表；插入和删除会搬动同一个叶子里的元素，之前的迭代器和引用都会失效
+//
+template <typename Key, typename Value>
+class shm_btree_map {
+public:
+	typedef shm_btree_map<Key, Value> this_type;
+	typedef Key key_type;
+	typedef Value mapped_type;
+	typedef std::pair<Key, Value> value_type;
+
+	enum : size_t {
+		LEAF_SLOTS = (BTREE_NODE_BYTES - 24) / sizeof(value_type) > 4 ? (BTREE_NODE_BYTES - 24) / sizeof(value_type) : 4,
+		INNER_SLOTS = (BTREE_NODE_BYTES - 16) / (sizeof(Key) + 8) > 4 ? (BTREE_NODE_BYTES - 16) / (sizeof(Key) + 8) : 4,
+		LEAF_MIN = LEAF_SLOTS / 2,
+		INNER_MIN = INNER_SLOTS / 2,
+	};
+
+	typedef BTreeLeaf<value_type, LEAF_SLOTS> leaf_type;
+	typedef BTreeInner<Key, INNER_SLOTS> inner_type;
+	typedef shm_pointer<leaf_type> leaf_ptr;
+	typedef shm_pointer<inner_type> inner_ptr;
+	typedef btree_iterator<leaf_type, value_type*, value_type&> iterator;
+	typedef btree_iterator<leaf_type, const value_type*, const value_type&> const_iterator;
+
+	shm_btree_map() = default;
+
+	shm_btree_map(const this_type& r) {
+		for (auto it = r.begin(); it != r.end(); ++it) {
+			insert(*it);
+		}
+	}
+
+	shm_btree_map(this_type&& r) noexcept {
+		swap(r);
+	}
+
+	this_type& operator=(const this_type& r) {
+		if (this != &r) {
+			shm_btree_map(r).swap(*this);
+		}
+		return *this;
+	}
+
+	this_type& operator=(this_type&& r) noexcept {
+		if (this != &r) {
+			clear();
+			swap(r);
+		}
+		return *this;
+	}
+
+	~shm_btree_map() {
+		clear();
+	}
+
+	void swap(this_type& r) {
+		std::swap(m_root, r.m_root);
+		std::swap(m_height, r.m_height);
+		std::swap(m_size, r.m_size);
+	}
+
+	iterator begin() {
+		return iterator(first_leaf(), 0);
+	}
+
+	const_iterator begin() const {
+		return const_iterator(first_leaf(), 0);
+	}
+
+	iterator end() {
+		return iterator();
+	}
+
+	const_iterator end() const {
+		return const_iterator();
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	// 树高，只有一个叶子时为1
+	size_t height() const {
+		return m_height;
+	}
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		return insert_unique(value.first, [&](value_type* slot) { ::new (slot) value_type(value); });
+	}
+
+	std::pair<iterator, bool> insert(value_type&& value) {
+		return insert_unique(value.first, [&](value_type* slot) { ::new (slot) value_type(std::move(value)); });
+	}
+
+	//
+	// emplace(k, v)先用k查找，不存在时直接在槽里构造元素，和try_emplace一样不在栈上构造
+	// k不能直接和Key比较时先构造出Key用来查找，槽里的Key从它复制，长字符串等从容器所在的字典分配
+	//
+	template <class K, class V>
+	std::pair<iterator, bool> emplace(K&& k, V&& v) {
+		if constexpr (std::is_same_v<std::decay_t<K>, Key> || is_transparent_key_v<Key, K>) {
+			return insert_unique(k, [&](value_type* slot) {
+				::new (slot) value_type(std::forward<K>(k), std::forward<V>(v));
+			});
+		} else {
+			const Key key(std::forward<K>(k));
+			return insert_unique(key, [&](value_type* slot) {
+				::new (slot) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+					std::forward_as_tuple(std::forward<V>(v)));
+			});
+		}
+	}
+
+	// 其他形式先构造出元素才知道key，再复制到槽里；key已经存在时元素被丢弃
+	template <typename... P>
+	std::pair<iterator, bool> emplace(P&&... params) {
+		const value_type value(std::forward<P>(params)...);
+		return insert(value);
+	}
+
+	// key不存在时才构造value
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(const Key& k, P&&... args) {
+		return insert_unique(k, [&](value_type* slot) {
+			::new (slot) value_type(std::piecewise_construct, std::forward_as_tuple(k),
+				std::forward_as_tuple(std::forward<P>(args)...));
+		});
+	}
+
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(Key&& k, P&&... args) {
+		return insert_unique(k, [&](value_type* slot) {
+			::new (slot) value_type(std::piecewise_construct, std::forward_as_tuple(std::move(k)),
+				std::forward_as_tuple(std::forward<P>(args)...));
+		});
+	}
+
+	Value& operator[](const Key& k) {
+		return try_emplace(k).first->second;
+	}
+
+	iterator find(const Key& key) {
+		return find_key<iterator>(key);
+	}
+
+	const_iterator find(const Key& key) const {
+		return find_key<const_iterator>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator find(const K& key) {
+		return find_key<iterator>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	const_iterator find(const K& key) const {
+		return find_key<const_iterator>(key);
+	}
+
+	size_t count(const Key& key) const {
+		return find(key) != end() ? 1 : 0;
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_t count(const K& key) const {
+		return find(key) != end() ? 1 : 0;
+	}
+
+	// 第一个不小于key的元素
+	iterator lower_bound(const Key& key) {
+		return bound_key<iterator, false>(key);
+	}
+
+	const_iterator lower_bound(const Key& key) const {
+		return bound_key<const_iterator, false>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator lower_bound(const K& key) {
+		return bound_key<iterator, false>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	const_iterator lower_bound(const K& key) const {
+		return bound_key<const_iterator, false>(key);
+	}
+
+	// 第一个大于key的元素
+	iterator upper_bound(const Key& key) {
+		return bound_key<iterator, true>(key);
+	}
+
+	const_iterator upper_bound(const Key& key) const {
+		return bound_key<const_iterator, true>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator upper_bound(const K& key) {
+		return bound_key<iterator, true>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	const_iterator upper_bound(const K& key) const {
+		return bound_key<const_iterator, true>(key);
+	}
+
+	std::pair<iterator, iterator> equal_range(const Key& key) {
+		return equal_range_key<iterator>(key);
+	}
+
+	std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+		return equal_range_key<const_iterator>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	std::pair<iterator, iterator> equal_range(const K& key) {
+		return equal_range_key<iterator>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+		return equal_range_key<const_iterator>(key);
+	}
+
+	// 和shm_map::scan一样访问[from, to)中的元素，最多limit个；定位到叶子之后顺着叶子链表走
+	template <class F>
+	size_t scan(const Key& from, const Key& to, size_t limit, F&& callback) {
+		return scan_key(from, to, limit, callback);
+	}
+
+	template <class K, class F, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_t scan(const K& from, const K& to, size_t limit, F&& callback) {
+		return scan_key(from, to, limit, callback);
+	}
+
+	// 返回被删除元素的下一个
+	iterator erase(iterator it) {
+		size_t erased = 0;
+		return erase_key(it->first, erased);
+	}
+
+	size_t erase(const Key& key) {
+		size_t erased = 0;
+		erase_key(key, erased);
+		return erased;
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_t erase(const K& key) {
+		size_t erased = 0;
+		erase_key(key, erased);
+		return erased;
+	}
+
+	void clear() {
+		if (m_root != shm_nullptr) {
+			destroy(m_root, m_height);
+		}
+		m_root = shm_nullptr;
+		m_height = 0;
+		m_size = 0;
+	}
+
+private:
+	// 从根到叶子经过的内部节点，以及在每个节点中走的孩子下标
+	struct Path {
+		inner_ptr nodes[BTREE_MAX_HEIGHT];
+		uint32_t index[BTREE_MAX_HEIGHT];
+		size_t depth = 0;
+	};
+
+	// 小于k的key的个数，即第一个不小于k的位置
+	template <class K>
+	static size_t leaf_lower(leaf_type* leaf, const K& k) {
+		const size_t n = leaf->count;
+		value_type* slots = leaf->slots();
+		if (std::is_integral<Key>::value && std::is_same<K, Key>::value) {
+			// 元素不多，不带分支地逐个比较
+			size_t pos = 0;
+			for (size_t i = 0; i < n; i++) {
+				pos += BTreeKeyCompare<Key, K>::Less(slots[i].first, k) ? 1 : 0;
+			}
+			return pos;
+		}
+
+		size_t lo = 0, hi = n;
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (BTreeKeyCompare<Key, K>::Less(slots[mid].first, k)) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	// 不大于k的key的个数，即第一个大于k的位置
+	template <class K>
+	static size_t leaf_upper(leaf_type* leaf, const K& k) {
+		size_t lo = 0, hi = leaf->count;
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (!BTreeKeyCompare<Key, K>::Greater(leaf->slot(mid).first, k)) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	// k所在孩子的下标，等于不大于k的分隔key的个数
+	template <class K>
+	static size_t inner_upper(inner_type* inner, const K& k) {
+		return inner_upper(inner, k, std::integral_constant<bool, std::is_integral<Key>::value && std::is_same<K, Key>::value>());
+	}
+
+	template <class K>
+	static size_t inner_upper(inner_type* inner, const K& k, std::true_type) {
+		return inner->count - BTreeCountGreater(inner->keys(), inner->count, k);
+	}
+
+	template <class K>
+	static size_t inner_upper(inner_type* inner, const K& k, std::false_type) {
+		size_t lo = 0, hi = inner->count;
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (!BTreeKeyCompare<Key, K>::Greater(inner->key(mid), k)) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	leaf_ptr first_leaf() const {
+		if (m_root == shm_nullptr)
+			return shm_nullptr;
+
+		int64_t node = m_root;
+		for (size_t h = m_height; h > 1; h--) {
+			node = inner_ptr(node)->children[0];
+		}
+		return leaf_ptr(node);
+	}
+
+	template <class K>
+	leaf_ptr find_leaf(const K& k) const {
+		int64_t node = m_root;
+		for (size_t h = m_height; h > 1; h--) {
+			inner_type* inner = inner_ptr(node).Ptr();
+			node = inner->children[inner_upper(inner, k)];
+		}
+		return leaf_ptr(node);
+	}
+
+	template <class K>
+	leaf_ptr find_leaf(const K& k, Path& path) const {
+		int64_t node = m_root;
+		path.depth = 0;
+		for (size_t h = m_height; h > 1; h--) {
+			inner_ptr inner(node);
+			auto i = inner_upper(inner.Ptr(), k);
+			path.nodes[path.depth] = inner;
+			path.index[path.depth] = uint32_t(i);
+			path.depth++;
+			node = inner->children[i];
+		}
+		return leaf_ptr(node);
+	}
+
+	template <class It, class K>
+	It find_key(const K& k) const {
+		if (m_root == shm_nullptr)
+			return It();
+
+		auto leaf = find_leaf(k);
+		auto pos = leaf_lower(leaf.Ptr(), k);
+		if (pos < leaf->count && !BTreeKeyCompare<Key, K>::Greater(leaf->slot(pos).first, k))
+			return It(leaf, pos);
+		return It();
+	}
+
+	template <class It, bool Upper, class K>
+	It bound_key(const K& k) const {
+		if (m_root == shm_nullptr)
+			return It();
+
+		auto leaf = find_leaf(k);
+		auto pos = Upper ? leaf_upper(leaf.Ptr(), k) : leaf_lower(leaf.Ptr(), k);
+		if (pos == leaf->count) {
+			// 下一个叶子的第一个元素一定满足条件
+			return It(leaf->next, 0);
+		}
+		return It(leaf, pos);
+	}
+
+	template <class It, class K>
+	std::pair<It, It> equal_range_key(const K& k) const {
+		auto lower = bound_key<It, false>(k);
+		auto upper = lower;
+		if (lower != It() && !BTreeKeyCompare<Key, K>::Greater(lower->first, k)) {
+			++upper;
+		}
+		return std::make_pair(lower, upper);
+	}
+
+	template <class K, class F>
+	size_t scan_key(const K& from, const K& to, size_t limit, F& callback) {
+		if (m_root == shm_nullptr || limit == 0)
+			return 0;
+
+		auto leaf = find_leaf(from);
+		size_t pos = leaf_lower(leaf.Ptr(), from);
+		size_t visited = 0;
+		while (leaf != shm_nullptr) {
+			leaf_type* p = leaf.Ptr();
+			for (; pos < p->count; pos++) {
+				auto& v = p->slot(pos);
+				if (!BTreeKeyCompare<Key, K>::Less(v.first, to))
+					return visited;
+
+				callback(v.first, v.second);
+				if (++visited == limit)
+					return visited;
+			}
+			leaf = p->next;
+			pos = 0;
+		}
+		return visited;
+	}
+
+	// key不存在时调用construct在叶子的空位上构造元素
+	template <class K, class Construct>
+	std::pair<iterator, bool> insert_unique(const K& k, Construct&& construct) {
+		if (m_root == shm_nullptr) {
+			Alloc* alloc = AllocOf(this);
+			m_root = alloc->New<leaf_type>().Raw();
+			m_height = 1;
+		}
+
+		Path path;
+		auto leaf = find_leaf(k, path);
+		size_t pos = leaf_lower(leaf.Ptr(), k);
+		if (pos < leaf->count && !BTreeKeyCompare<Key, K>::Greater(leaf->slot(pos).first, k))
+			return std::make_pair(iterator(leaf, pos), false);
+
+		if (leaf->count < LEAF_SLOTS) {
+			insert_slot(leaf.Ptr(), pos, construct);
+			m_size++;
+			return std::make_pair(iterator(leaf, pos), true);
+		}
+
+		// 在最右边的叶子末尾追加（key递增插入）时左边保持全满，否则对半分
+		const bool append = pos == leaf->count && leaf->next == shm_nullptr;
+		auto right = split_leaf(leaf, append ? leaf->count : leaf->count / 2);
+		auto target = leaf;
+		if (pos > leaf->count || append) {
+			pos -= leaf->count;
+			target = right;
+		}
+		insert_slot(target.Ptr(), pos, construct);
+		m_size++;
+
+		insert_parent(path, Key(right->slot(0).first), right.Raw(), append);
+		return std::make_pair(iterator(target, pos), true);
+	}
+
+	template <class Construct>
+	static void insert_slot(leaf_type* leaf, size_t pos, Construct& construct) {
+		BTreeRelocate(leaf->slots() + pos + 1, leaf->slots() + pos, leaf->count - pos);
+		construct(leaf->slots() + pos);
+		leaf->count++;
+	}
+
+	// [mid, count)搬到新的右兄弟中
+	leaf_ptr split_leaf(leaf_ptr leaf, size_t mid) {
+		Alloc* alloc = AllocOf(this);
+		auto right = alloc->New<leaf_type>();
+		BTreeRelocate(right->slots(), leaf->slots() + mid, leaf->count - mid);
+		right->count = leaf->count - uint32_t(mid);
+		leaf->count = uint32_t(mid);
+
+		right->prev = leaf;
+		right->next = leaf->next;
+		if (leaf->next != shm_nullptr) {
+			leaf->next->prev = right;
+		}
+		leaf->next = right;
+		return right;
+	}
+
+	// 孩子分裂出了新的右兄弟child，把分隔key挂到父节点上，父节点满了继续往上分裂
+	// 追加时路径上都是各层最右边的节点，同样让左边保持全满
+	void insert_parent(Path& path, Key&& key, int64_t child, bool append) {
+		for (size_t d = path.depth; d > 0; d--) {
+			auto inner = path.nodes[d - 1];
+			size_t i = path.index[d - 1];
+			if (inner->count < INNER_SLOTS) {
+				inner_insert(inner.Ptr(), i, std::move(key), child);
+				return;
+			}
+
+			// keys[mid]上移到父节点，它右边的key和孩子搬到新节点
+			const size_t mid = append ? INNER_SLOTS - 1 : INNER_SLOTS / 2;
+			Alloc* alloc = AllocOf(this);
+			auto right = alloc->New<inner_type>();
+			Key promoted(std::move(inner->key(mid)));
+			inner->key(mid).~Key();
+			BTreeRelocate(right->keys(), inner->keys() + mid + 1, inner->count - mid - 1);
+			memcpy(right->children, inner->children + mid + 1, sizeof(int64_t) * (inner->count - mid));
+			right->count = inner->count - uint32_t(mid) - 1;
+			inner->count = uint32_t(mid);
+
+			if (i <= mid) {
+				inner_insert(inner.Ptr(), i, std::move(key), child);
+			} else {
+				inner_insert(right.Ptr(), i - mid - 1, std::move(key), child);
+			}
+
+			key = std::move(promoted);
+			child = right.Raw();
+		}
+
+		// 根分裂，树长高一层
+		Alloc* alloc = AllocOf(this);
+		auto root = alloc->New<inner_type>();
+		::new (root->keys()) Key(std::move(key));
+		root->children[0] = m_root;
+		root->children[1] = child;
+		root->count = 1;
+		m_root = root.Raw();
+		m_height++;
+	}
+
+	// 在位置i插入key，新的孩子放在key的右边
+	static void inner_insert(inner_type* inner, size_t i, Key&& key, int64_t child) {
+		BTreeRelocate(inner->keys() + i + 1, inner->keys() + i, inner->count - i);
+		::new (inner->keys() + i) Key(std::move(key));
+		memmove(inner->children + i + 2, inner->children + i + 1, sizeof(int64_t) * (inner->count - i));
+		inner->children[i + 1] = child;
+		inner->count++;
+	}
+
+	// 删除位置i的key和它右边的孩子
+	static void inner_remove(inner_type* inner, size_t i) {
+		inner->key(i).~Key();
+		BTreeRelocate(inner->keys() + i, inner->keys() + i + 1, inner->count - i - 1);
+		memmove(inner->children + i + 1, inner->children + i + 2, sizeof(int64_t) * (inner->count - i - 1));
+		inner->count--;
+	}
+
+	template <class K>
+	iterator erase_key(const K& k, size_t& erased) {
+		erased = 0;
+		if (m_root == shm_nullptr)
+			return end();
+
+		Path path;
+		auto leaf = find_leaf(k, path);
+		size_t pos = leaf_lower(leaf.Ptr(), k);
+		if (pos == leaf->count || BTreeKeyCompare<Key, K>::Greater(leaf->slot(pos).first, k))
+			return end();
+
+		// 之后不能再使用k，它可能就是被删除的元素里的key
+		leaf->slot(pos).~value_type();
+		BTreeRelocate(leaf->slots() + pos, leaf->slots() + pos + 1, leaf->count - pos - 1);
+		leaf->count--;
+		m_size--;
+		erased = 1;
+
+		rebalance_leaf(path, leaf, pos);
+		if (leaf == shm_nullptr)
+			return end();
+		if (pos == leaf->count)
+			return iterator(leaf->next, 0);
+		return iterator(leaf, pos);
+	}
+
+	//
+	// 叶子中的元素少于一半时，先从兄弟借一个，兄弟也不够时和兄弟合并
+	// leaf和pos跟踪被删除元素之后的那个元素
+	//
+	void rebalance_leaf(Path& path, leaf_ptr& leaf, size_t& pos) {
+		if (path.depth == 0) {
+			if (leaf->count == 0) {
+				g_alloc->Delete(leaf);
+				m_root = shm_nullptr;
+				m_height = 0;
+				leaf = shm_nullptr;
+				pos = 0;
+			}
+			return;
+		}
+
+		if (leaf->count >= LEAF_MIN)
+			return;
+
+		auto parent = path.nodes[path.depth - 1];
+		size_t i = path.index[path.depth - 1];
+		leaf_ptr left = i > 0 ? leaf_ptr(parent->children[i - 1]) : leaf_ptr();
+		leaf_ptr right = i < parent->count ? leaf_ptr(parent->children[i + 1]) : leaf_ptr();
+
+		if (left != shm_nullptr && left->count > LEAF_MIN) {
+			BTreeRelocate(leaf->slots() + 1, leaf->slots(), leaf->count);
+			BTreeRelocate(leaf->slots(), left->slots() + left->count - 1, 1);
+			left->count--;
+			leaf->count++;
+			parent->key(i - 1) = leaf->slot(0).first;
+			pos++;
+			return;
+		}
+
+		if (right != shm_nullptr && right->count > LEAF_MIN) {
+			BTreeRelocate(leaf->slots() + leaf->count, right->slots(), 1);
+			BTreeRelocate(right->slots(), right->slots() + 1, right->count - 1);
+			right->count--;
+			leaf->count++;
+			parent->key(i) = right->slot(0).first;
+			return;
+		}
+
+		if (left != shm_nullptr) {
+			BTreeRelocate(left->slots() + left->count, leaf->slots(), leaf->count);
+			pos += left->count;
+			left->count += leaf->count;
+			leaf->count = 0;
+			unlink_leaf(leaf);
+			g_alloc->Delete(leaf);
+			leaf = left;
+			inner_remove(parent.Ptr(), i - 1);
+		} else {
+			BTreeRelocate(leaf->slots() + leaf->count, right->slots(), right->count);
+			leaf->count += right->count;
+			right->count = 0;
+			unlink_leaf(right);
+			g_alloc->Delete(right);
+			inner_remove(parent.Ptr(), i);
+		}
+
+		rebalance_inner(path);
+	}
+
+	// path的最后一个节点少了一个孩子，同样先借后合并，合并之后继续检查上一层
+	void rebalance_inner(Path& path) {
+		for (; path.depth > 0; path.depth--) {
+			auto node = path.nodes[path.depth - 1];
+			if (path.depth == 1) {
+				// 根只剩一个孩子时，树降低一层
+				if (node->count == 0) {
+					m_root = node->children[0];
+					m_height--;
+					g_alloc->Delete(node);
+				}
+				return;
+			}
+
+			if (node->count >= INNER_MIN)
+				return;
+
+			auto parent = path.nodes[path.depth - 2];
+			size_t j = path.index[path.depth - 2];
+			inner_ptr left = j > 0 ? inner_ptr(parent->children[j - 1]) : inner_ptr();
+			inner_ptr right = j < parent->count ? inner_ptr(parent->children[j + 1]) : inner_ptr();
+
+			if (left != shm_nullptr && left->count > INNER_MIN) {
+				// 经过父节点向右旋转一个key
+				BTreeRelocate(node->keys() + 1, node->keys(), node->count);
+				memmove(node->children + 1, node->children, sizeof(int64_t) * (node->count + 1));
+				::new (node->keys()) Key(std::move(parent->key(j - 1)));
+				node->children[0] = left->children[left->count];
+				node->count++;
+				parent->key(j - 1) = std::move(left->key(left->count - 1));
+				left->key(left->count - 1).~Key();
+				left->count--;
+				return;
+			}
+
+			if (right != shm_nullptr && right->count > INNER_MIN) {
+				::new (node->keys() + node->count) Key(std::move(parent->key(j)));
+				node->children[node->count + 1] = right->children[0];
+				node->count++;
+				parent->key(j) = std::move(right->key(0));
+				right->key(0).~Key();
+				BTreeRelocate(right->keys(), right->keys() + 1, right->count - 1);
+				memmove(right->children, right->children + 1, sizeof(int64_t) * right->count);
+				right->count--;
+				return;
+			}
+
+			if (left != shm_nullptr) {
+				merge_inner(left.Ptr(), parent->key(j - 1), node.Ptr());
+				g_alloc->Delete(node);
+				inner_remove(parent.Ptr(), j - 1);
+			} else {
+				merge_inner(node.Ptr(), parent->key(j), right.Ptr());
+				g_alloc->Delete(right);
+				inner_remove(parent.Ptr(), j);
+			}
+		}
+	}
+
+	// 把分隔key和right的全部key、孩子接到left后面
+	static void merge_inner(inner_type* left, Key& separator, inner_type* right) {
+		::new (left->keys() + left->count) Key(std::move(separator));
+		BTreeRelocate(left->keys() + left->count + 1, right->keys(), right->count);
+		memcpy(left->children + left->count + 1, right->children, sizeof(int64_t) * (right->count + 1));
+		left->count += right->count + 1;
+		right->count = 0;
+	}
+
+	static void unlink_leaf(leaf_ptr leaf) {
+		if (leaf->prev != shm_nullptr) {
+			leaf->prev->next = leaf->next;
+		}
+		if (leaf->next != shm_nullptr) {
+			leaf->next->prev = leaf->prev;
+		}
+	}
+
+	void destroy(int64_t node, size_t height) {
+		if (height == 1) {
+			leaf_ptr leaf(node);
+			for (size_t i = 0; i < leaf->count; i++) {
+				leaf->slot(i).~value_type();
+			}
+			g_alloc->Delete(leaf);
+			return;
+		}
+
+		inner_ptr inner(node);
+		for (size_t i = 0; i <= inner->count; i++) {
+			destroy(inner->children[i], height - 1);
+		}
+		for (size_t i = 0; i < inner->count; i++) {
+			inner->key(i).~Key();
+		}
+		g_alloc->Delete(inner);
+	}
+
+private:
+	int64_t m_root = shm_nullptr;
+	size_t m_height = 0;
+	size_t m_size = 0;
+};
+
+} // namespace smd
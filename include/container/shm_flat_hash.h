@@ -0,0 +1,595 @@
+﻿#pragma once
+#include <new>
+#include <type_traits>
+#include <string.h>
+#include <tuple>
+#include <utility>
+#include <functional>
+#include <common/utility.h>
+#include <common/functional.h>
+#include <container/shm_pointer.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SMD_FLAT_HASH_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace smd {
+
+//
+// 开放寻址的哈希表（Swiss Table）：每个槽位对应一个控制字节，所有的槽位和控制字节放在同一块共享内存里
+// 控制字节的最高位为1表示空或者已删除，否则低7位是哈希值的低7位，查找时一次比较16个控制字节，只有匹配的槽位才去比较key
+// 控制字节的末尾复制了开头的15个字节，从任何位置开始读16个字节都不会越界
+//
+enum : int8_t {
+	FLAT_HASH_EMPTY = -128,
+	FLAT_HASH_DELETED = -2,
+};
+
+inline uint32_t FlatHashTrailingZeros(uint32_t x) {
+#ifdef _MSC_VER
+	unsigned long index = 0;
+	_BitScanForward(&index, x);
+	return uint32_t(index);
+#else
+	return uint32_t(__builtin_ctz(x));
+#endif
+}
+
+// 16位掩码中最高的1前面有几个0
+inline uint32_t FlatHashLeadingZeros16(uint32_t x) {
+#ifdef _MSC_VER
+	unsigned long index = 0;
+	_BitScanReverse(&index, x);
+	return 15 - uint32_t(index);
+#else
+	return uint32_t(__builtin_clz(x)) - 16;
+#endif
+}
+
+// 同时处理16个控制字节，返回的掩码第i位表示第i个控制字节满足条件
+class FlatHashGroup {
+public:
+	enum : size_t { WIDTH = 16 };
+
+	explicit FlatHashGroup(const int8_t* ctrl) {
+#ifdef SMD_FLAT_HASH_SSE2
+		m_ctrl = _mm_loadu_si128((const __m128i*)ctrl);
+#else
+		memcpy(m_ctrl, ctrl, WIDTH);
+#endif
+	}
+
+	uint32_t Match(int8_t h2) const {
+#ifdef SMD_FLAT_HASH_SSE2
+		return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl)));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < WIDTH; i++) {
+			mask |= uint32_t(m_ctrl[i] == h2) << i;
+		}
+		return mask;
+#endif
+	}
+
+	uint32_t MatchEmpty() const {
+		return Match(FLAT_HASH_EMPTY);
+	}
+
+	// 空和已删除的最高位都是1
+	uint32_t MatchEmptyOrDeleted() const {
+#ifdef SMD_FLAT_HASH_SSE2
+		return uint32_t(_mm_movemask_epi8(m_ctrl));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < WIDTH; i++) {
+			mask |= uint32_t(m_ctrl[i] < 0) << i;
+		}
+		return mask;
+#endif
+	}
+
+private:
+#ifdef SMD_FLAT_HASH_SSE2
+	__m128i m_ctrl;
+#else
+	int8_t m_ctrl[WIDTH];
+#endif
+};
+
+template <class Key, class Slot, class KeyOfSlot, class Hash>
+class shm_flat_hash_table;
+
+template <class Slot>
+class FlatHashIterator {
+public:
+	FlatHashIterator(int8_t* ctrl = nullptr, int8_t* ctrl_end = nullptr, Slot* slot = nullptr)
+		: m_ctrl(ctrl)
+		, m_ctrl_end(ctrl_end)
+		, m_slot(slot) {
+		SkipEmpty();
+	}
+
+	Slot& operator*() const {
+		return *m_slot;
+	}
+
+	Slot* operator->() const {
+		return m_slot;
+	}
+
+	FlatHashIterator& operator++() {
+		++m_ctrl;
+		++m_slot;
+		SkipEmpty();
+		return *this;
+	}
+
+	FlatHashIterator operator++(int) {
+		auto res = *this;
+		++*this;
+		return res;
+	}
+
+	bool operator==(const FlatHashIterator& rhs) const {
+		return m_ctrl == rhs.m_ctrl;
+	}
+
+	bool operator!=(const FlatHashIterator& rhs) const {
+		return m_ctrl != rhs.m_ctrl;
+	}
+
+private:
+	template <class Key, class S, class KeyOfSlot, class Hash>
+	friend class shm_flat_hash_table;
+
+	void SkipEmpty() {
+		while (m_ctrl != m_ctrl_end && *m_ctrl < 0) {
+			++m_ctrl;
+			++m_slot;
+		}
+	}
+
+private:
+	int8_t* m_ctrl;
+	int8_t* m_ctrl_end;
+	Slot* m_slot;
+};
+
+//
+// 哈希表的公共部分，map和set的区别只在于槽位里存放什么、怎么从槽位取出key
+// 槽位的容量是2的幂，装填到7/8时扩容，删除留下的墓碑太多时按原来的容量重建
+// 迭代器是当前进程里的裸指针，插入之后可能失效，不能存放在共享内存中
+//
+template <class Key, class Slot, class KeyOfSlot, class Hash>
+class shm_flat_hash_table {
+public:
+	typedef Key key_type;
+	typedef Slot value_type;
+	typedef size_t size_type;
+	typedef FlatHashIterator<Slot> iterator;
+
+	enum : size_t {
+		GROUP_WIDTH = FlatHashGroup::WIDTH,
+		MIN_CAPACITY = GROUP_WIDTH,
+	};
+
+	explicit shm_flat_hash_table(size_t count = 0) {
+		reserve(count);
+	}
+
+	shm_flat_hash_table(const shm_flat_hash_table& r) {
+		reserve(r.size());
+		auto& src = const_cast<shm_flat_hash_table&>(r);
+		for (auto it = src.begin(); it != src.end(); ++it) {
+			auto res = find_or_prepare_insert(KeyOfSlot()(*it));
+			::new (slots() + res.first) Slot(*it);
+		}
+	}
+
+	// 接管r的存储，r变成没有分配的空表
+	shm_flat_hash_table(shm_flat_hash_table&& r) noexcept {
+		swap(r);
+	}
+
+	shm_flat_hash_table& operator=(const shm_flat_hash_table& r) {
+		if (this != &r) {
+			shm_flat_hash_table(r).swap(*this);
+		}
+		return *this;
+	}
+
+	shm_flat_hash_table& operator=(shm_flat_hash_table&& r) noexcept {
+		if (this != &r) {
+			shm_flat_hash_table(std::move(r)).swap(*this);
+		}
+		return *this;
+	}
+
+	~shm_flat_hash_table() {
+		destroy_slots();
+		if (m_block != shm_nullptr) {
+			g_alloc->Free(m_block, alloc_size(m_capacity));
+		}
+		m_capacity = 0;
+	}
+
+	iterator begin() {
+		if (m_capacity == 0)
+			return end();
+		return iterator(ctrl(), ctrl() + m_capacity, slots());
+	}
+
+	iterator end() {
+		if (m_capacity == 0)
+			return iterator();
+		return iterator(ctrl() + m_capacity, ctrl() + m_capacity, slots() + m_capacity);
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	size_t capacity() const {
+		return m_capacity;
+	}
+
+	float load_factor() const {
+		return m_capacity > 0 ? float(m_size) / float(m_capacity) : 0.0f;
+	}
+
+	iterator find(const key_type& key) {
+		return find_key(key);
+	}
+
+	// 用可以直接和Key比较的类型查找，比如shm_flat_hash_set<shm_string>用Slice查找
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator find(const K& key) {
+		return find_key(key);
+	}
+
+	size_type count(const key_type& key) {
+		return find_key(key) == end() ? 0 : 1;
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_type count(const K& key) {
+		return find_key(key) == end() ? 0 : 1;
+	}
+
+	bool contains(const key_type& key) {
+		return find_key(key) != end();
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	bool contains(const K& key) {
+		return find_key(key) != end();
+	}
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		auto res = find_or_prepare_insert(KeyOfSlot()(value));
+		if (!res.second) {
+			::new (slots() + res.first) Slot(value);
+		}
+		return std::make_pair(iterator_at(res.first), !res.second);
+	}
+
+	std::pair<iterator, bool> insert(value_type&& value) {
+		auto res = find_or_prepare_insert(KeyOfSlot()(value));
+		if (!res.second) {
+			::new (slots() + res.first) Slot(std::move(value));
+		}
+		return std::make_pair(iterator_at(res.first), !res.second);
+	}
+
+	iterator erase(iterator position) {
+		size_t index = size_t(position.m_slot - slots());
+		position.m_slot->~Slot();
+		--m_size;
+
+		// 前后都有空位，并且连续的非空槽位不足一组，说明探测从来没有越过这里，可以直接置空
+		int8_t* c = ctrl();
+		size_t mask = m_capacity - 1;
+		uint32_t empty_before = FlatHashGroup(c + ((index - GROUP_WIDTH) & mask)).MatchEmpty();
+		uint32_t empty_after = FlatHashGroup(c + index).MatchEmpty();
+		bool was_never_full = empty_before != 0 && empty_after != 0 &&
+			FlatHashTrailingZeros(empty_after) + FlatHashLeadingZeros16(empty_before) < GROUP_WIDTH;
+		if (was_never_full) {
+			set_ctrl(index, FLAT_HASH_EMPTY);
+			++m_growth_left;
+		} else {
+			set_ctrl(index, FLAT_HASH_DELETED);
+		}
+
+		return ++position;
+	}
+
+	size_type erase(const key_type& key) {
+		return erase_key(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_type erase(const K& key) {
+		return erase_key(key);
+	}
+
+	void clear() {
+		destroy_slots();
+		if (m_capacity > 0) {
+			memset(ctrl(), FLAT_HASH_EMPTY, m_capacity + GROUP_WIDTH - 1);
+		}
+		m_size = 0;
+		m_growth_left = capacity_to_growth(m_capacity);
+	}
+
+	// 保证能放下count个元素而不需要扩容
+	void reserve(size_t count) {
+		if (count <= m_size + m_growth_left)
+			return;
+
+		size_t capacity = util::Utility::NextPowOf2(uint64_t(count + count / 7 + 1));
+		resize(std::max(capacity, size_t(MIN_CAPACITY)));
+	}
+
+	void swap(shm_flat_hash_table& x) {
+		std::swap(m_block, x.m_block);
+		std::swap(m_capacity, x.m_capacity);
+		std::swap(m_size, x.m_size);
+		std::swap(m_growth_left, x.m_growth_left);
+	}
+
+protected:
+	//
+	// 查找key，找到时返回它的位置和true
+	// 找不到时占好一个槽位并返回false，调用者负责在这个槽位上构造元素
+	//
+	std::pair<size_t, bool> find_or_prepare_insert(const key_type& key) {
+		auto hash = hash_of(key);
+		if (m_capacity > 0) {
+			const int8_t* c = ctrl();
+			Slot* s = slots();
+			size_t mask = m_capacity - 1;
+			size_t offset = size_t(hash >> 7) & mask;
+			for (size_t probe = GROUP_WIDTH;; probe += GROUP_WIDTH) {
+				FlatHashGroup g(c + offset);
+				for (uint32_t m = g.Match(int8_t(hash & 0x7F)); m != 0; m &= m - 1) {
+					size_t index = (offset + FlatHashTrailingZeros(m)) & mask;
+					if (KeyOfSlot()(s[index]) == key)
+						return std::make_pair(index, true);
+				}
+
+				if (g.MatchEmpty() != 0)
+					break;
+
+				offset = (offset + probe) & mask;
+			}
+		}
+
+		if (m_growth_left == 0) {
+			// 墓碑占了一半以上时按原来的容量重建就够了
+			if (m_capacity == 0)
+				resize(MIN_CAPACITY);
+			else if (m_size * 2 < capacity_to_growth(m_capacity))
+				resize(m_capacity);
+			else
+				resize(m_capacity * 2);
+		}
+
+		size_t index = find_first_non_full(hash);
+		if (ctrl()[index] == FLAT_HASH_EMPTY) {
+			--m_growth_left;
+		}
+		set_ctrl(index, int8_t(hash & 0x7F));
+		++m_size;
+		return std::make_pair(index, false);
+	}
+
+	Slot* slots() {
+		return (Slot*)(m_block.Ptr() + slot_offset(m_capacity));
+	}
+
+	iterator iterator_at(size_t index) {
+		return iterator(ctrl() + index, ctrl() + m_capacity, slots() + index);
+	}
+
+private:
+	template <class K>
+	iterator find_key(const K& key) {
+		if (m_size == 0)
+			return end();
+
+		auto hash = hash_of(key);
+		const int8_t* c = ctrl();
+		Slot* s = slots();
+		size_t mask = m_capacity - 1;
+		size_t offset = size_t(hash >> 7) & mask;
+		for (size_t probe = GROUP_WIDTH;; probe += GROUP_WIDTH) {
+			FlatHashGroup g(c + offset);
+			for (uint32_t m = g.Match(int8_t(hash & 0x7F)); m != 0; m &= m - 1) {
+				size_t index = (offset + FlatHashTrailingZeros(m)) & mask;
+				if (KeyOfSlot()(s[index]) == key)
+					return iterator_at(index);
+			}
+
+			if (g.MatchEmpty() != 0)
+				return end();
+
+			// 三角数探测，容量是2的幂时能走遍所有的组
+			offset = (offset + probe) & mask;
+		}
+	}
+
+	template <class K>
+	size_type erase_key(const K& key) {
+		auto it = find_key(key);
+		if (it == end())
+			return 0;
+
+		erase(it);
+		return 1;
+	}
+
+	int8_t* ctrl() {
+		return (int8_t*)m_block.Ptr();
+	}
+
+	// 低7位和高位都需要足够分散
+	template <class K>
+	static uint64_t hash_of(const K& key) {
+		return HashMix(uint64_t(Hash()(key)));
+	}
+
+	static size_t capacity_to_growth(size_t capacity) {
+		return capacity - capacity / 8;
+	}
+
+	static size_t slot_offset(size_t capacity) {
+		const size_t align = alignof(Slot);
+		return (capacity + GROUP_WIDTH - 1 + align - 1) / align * align;
+	}
+
+	static size_t alloc_size(size_t capacity) {
+		return slot_offset(capacity) + capacity * sizeof(Slot);
+	}
+
+	// 第一个空的或者已删除的槽位
+	size_t find_first_non_full(uint64_t hash) {
+		const int8_t* c = ctrl();
+		size_t mask = m_capacity - 1;
+		size_t offset = size_t(hash >> 7) & mask;
+		for (size_t probe = GROUP_WIDTH;; probe += GROUP_WIDTH) {
+			uint32_t m = FlatHashGroup(c + offset).MatchEmptyOrDeleted();
+			if (m != 0)
+				return (offset + FlatHashTrailingZeros(m)) & mask;
+			offset = (offset + probe) & mask;
+		}
+	}
+
+	// 开头的控制字节同时写到末尾的副本里
+	void set_ctrl(size_t index, int8_t h) {
+		int8_t* c = ctrl();
+		c[index] = h;
+		if (index < GROUP_WIDTH - 1)
+			c[m_capacity + index] = h;
+	}
+
+	void destroy_slots() {
+		if (m_capacity == 0)
+			return;
+
+		const int8_t* c = ctrl();
+		Slot* s = slots();
+		for (size_t i = 0; i < m_capacity; i++) {
+			if (c[i] >= 0)
+				s[i].~Slot();
+		}
+	}
+
+	// 换一块new_capacity大小的存储，把所有的元素重新放进去，墓碑随之清除
+	void resize(size_t new_capacity) {
+		auto old_block = m_block;
+		auto old_capacity = m_capacity;
+
+		Alloc* alloc = AllocOf(this);
+		m_block = alloc->Malloc<char>(alloc_size(new_capacity));
+		assert(m_block != shm_nullptr);
+		m_capacity = new_capacity;
+		m_growth_left = capacity_to_growth(new_capacity) - m_size;
+		memset(ctrl(), FLAT_HASH_EMPTY, new_capacity + GROUP_WIDTH - 1);
+
+		if (old_block == shm_nullptr)
+			return;
+
+		const int8_t* old_ctrl = (const int8_t*)old_block.Ptr();
+		Slot* old_slots = (Slot*)(old_block.Ptr() + slot_offset(old_capacity));
+		Slot* new_slots = slots();
+		for (size_t i = 0; i < old_capacity; i++) {
+			if (old_ctrl[i] < 0)
+				continue;
+
+			auto hash = hash_of(KeyOfSlot()(old_slots[i]));
+			size_t index = find_first_non_full(hash);
+			set_ctrl(index, int8_t(hash & 0x7F));
+			::new (new_slots + index) Slot(std::move(old_slots[i]));
+			old_slots[i].~Slot();
+		}
+
+		g_alloc->Free(old_block, alloc_size(old_capacity));
+	}
+
+private:
+	shm_pointer<char> m_block = shm_nullptr;
+	size_t m_capacity = 0;
+	size_t m_size = 0;
+	size_t m_growth_left = 0;
+};
+
+template <class Key>
+struct FlatHashSetKey {
+	const Key& operator()(const Key& key) const {
+		return key;
+	}
+};
+
+template <class Key, class Value>
+struct FlatHashMapKey {
+	const Key& operator()(const std::pair<Key, Value>& value) const {
+		return value.first;
+	}
+};
+
+template <class Key, class Hash = std::hash<Key>>
+class shm_flat_hash_set : public shm_flat_hash_table<Key, Key, FlatHashSetKey<Key>, Hash> {
+	typedef shm_flat_hash_table<Key, Key, FlatHashSetKey<Key>, Hash> base_type;
+
+public:
+	explicit shm_flat_hash_set(size_t count = 0)
+		: base_type(count) {}
+};
+
+template <class Key, class Value, class Hash = std::hash<Key>>
+class shm_flat_hash_map : public shm_flat_hash_table<Key, std::pair<Key, Value>, FlatHashMapKey<Key, Value>, Hash> {
+	typedef shm_flat_hash_table<Key, std::pair<Key, Value>, FlatHashMapKey<Key, Value>, Hash> base_type;
+
+public:
+	typedef Value mapped_type;
+	typedef typename base_type::iterator iterator;
+
+	explicit shm_flat_hash_map(size_t count = 0)
+		: base_type(count) {}
+
+	// key不存在时用args构造value，已经存在时什么也不做
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(const Key& key, P&&... args) {
+		auto res = this->find_or_prepare_insert(key);
+		if (!res.second) {
+			::new (this->slots() + res.first) std::pair<Key, Value>(
+				std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<P>(args)...));
+		}
+		return std::make_pair(this->iterator_at(res.first), !res.second);
+	}
+
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(Key&& key, P&&... args) {
+		auto res = this->find_or_prepare_insert(key);
+		if (!res.second) {
+			::new (this->slots() + res.first) std::pair<Key, Value>(std::piecewise_construct,
+				std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<P>(args)...));
+		}
+		return std::make_pair(this->iterator_at(res.first), !res.second);
+	}
+
+	Value& operator[](const Key& key) {
+		return try_emplace(key).first->second;
+	}
+};
+
+} // namespace smd
@@ -1,4 +1,6 @@
 ﻿#pragma once
+#include <type_traits>
+#include <common/functional.h>
 #include <container/shm_pointer.h>
 #include <container/shm_vector.h>
 #include <container/shm_list.h>
@@ -8,6 +10,9 @@ namespace smd {
 template <class Key>
 class shm_hash;
 
+//
+// 迭代的顺序是先旧表再新表，桶的下标把两张表连在一起编号
+//
 template <class Key, class ListIterator>
 class HashIterator {
 public:
@@ -19,15 +24,16 @@ public:
 	HashIterator& operator++() {
 		++iterator_;
 		//如果前进一位后到达了list的末尾，则需要跳转到下一个有item的bucket的list
-		if (iterator_ == container_->m_buckets[bucket_index_].end()) {
+		if (iterator_ == container_->bucket_list(bucket_index_).end()) {
 			for (;;) {
-				if (bucket_index_ == container_->m_buckets.size() - 1) {
+				if (bucket_index_ == container_->bucket_count() - 1) {
 					*this = container_->end();
 					break;
 				} else {
 					++bucket_index_;
-					if (!container_->m_buckets[bucket_index_].empty()) { //此list不为空
-						iterator_ = container_->m_buckets[bucket_index_].begin();
+					auto& list = container_->bucket_list(bucket_index_);
+					if (!list.empty()) { //此list不为空
+						iterator_ = list.begin();
 						break;
 					}
 				}
@@ -63,6 +69,13 @@ public:
 	shm_pointer<shm_hash<Key>> container_;
 };
 
+//
+// 扩容参考redis的渐进式rehash，分摊到之后的多次插入里完成，避免一次插入卡住很久：
+// 1. 准备：按批构造新表的空桶，这期间所有的key还在旧表里
+// 2. 迁移：从旧表的末尾开始，每次把若干个桶里的key搬到新表，搬空的桶随即销毁，旧表逐渐变短
+// 每个key任何时候都只在一张表里：它在旧表中的桶还没有搬走就在旧表，否则在新表
+// 查找和删除不推进迁移，以免使正在使用的迭代器失效，只读的场景可以定期调用step()把迁移做完
+//
 template <class Key>
 class shm_hash {
 	friend class HashIterator<Key, typename shm_list<Key>::iterator>;
@@ -70,16 +83,44 @@ class shm_hash {
 public:
 	typedef size_t size_type;
 	typedef Key key_type;
-	typedef HashIterator<Key, typename shm_list<key_type>::iterator> iterator;
+	typedef HashIterator<Key, typename shm_list<Key>::iterator> iterator;
 	typedef typename shm_list<key_type>::iterator local_iterator;
 
+	enum : size_t {
+		// 每次插入迁移的桶数
+		REHASH_STEP = 2,
+		// 迁移一个桶最多跳过的空桶数
+		REHASH_EMPTY_VISITS = 10,
+		// 准备阶段每一步构造的空桶数
+		REHASH_PREPARE_BATCH = 16,
+	};
+
 	shm_hash(size_t bucket_count = 1)
-		: m_buckets(m_prime_util.NextPrime(bucket_count)) {
+		: m_buckets(bucket_count) {
 		m_buckets.resize(m_buckets.capacity(), shm_list<key_type>());
+		m_bucket_count = m_buckets.size();
+	}
+
+	shm_hash(const shm_hash& r) = default;
+	shm_hash& operator=(const shm_hash& r) = default;
+
+	// 先构造最小的桶数组，再和r交换
+	shm_hash(shm_hash&& r)
+		: shm_hash() {
+		swap(r);
+	}
+
+	shm_hash& operator=(shm_hash&& r) {
+		if (this != &r) {
+			clear();
+			swap(r);
+		}
+		return *this;
 	}
 
 	~shm_hash() {
 		m_buckets.clear();
+		m_new_buckets.clear();
 	}
 
 	bool empty() const {
@@ -90,20 +131,21 @@ public:
 		return m_size;
 	}
 
+	// 两张表中桶的总数，迁移过程中是变化的
 	size_type bucket_count() const {
-		return m_buckets.size();
+		return m_buckets.size() + m_new_buckets.size();
 	}
 
-	size_type bucket_size(size_type i) const {
-		return m_buckets[i].size();
+	size_type bucket_size(size_type i) {
+		return bucket_list(i).size();
 	}
 
 	size_type bucket(const key_type& key) const {
-		return bucket_index(key);
+		return locate(key);
 	}
 
 	float load_factor() const {
-		return (float)size() / (float)bucket_count();
+		return (float)size() / (float)(is_rehashing() ? m_new_bucket_count : m_bucket_count);
 	}
 
 	float max_load_factor() const {
@@ -114,83 +156,148 @@ public:
 		m_max_load_factor = z;
 	}
 
+	bool is_rehashing() const {
+		return m_new_bucket_count > 0;
+	}
+
+	//
+	// 开始扩容到至少n个桶，桶数是新表存储的容量（2的幂）
+	// 上一次扩容还在准备阶段时直接把新表改大；已经开始迁移时记下n，等这次迁移完成后再开始，不会一次做完
+	//
 	void rehash(size_type n) {
-		if (n <= m_buckets.size())
+		if (n <= (is_rehashing() ? m_new_bucket_count : m_bucket_count))
+			return;
+
+		if (is_rehashing() && m_new_buckets.size() == m_new_bucket_count) {
+			m_pending_bucket_count = std::max(m_pending_bucket_count, n);
 			return;
-		shm_hash<Key> temp(next_prime(n));
-		for (auto& val : *this) {
-			temp.insert(val);
 		}
-		std::swap(*this, temp);
+
+		// 一次分配好新表的存储，准备阶段只构造元素，不会再重新分配；分配失败时容量不变
+		m_new_buckets.reserve(n);
+		m_new_bucket_count = m_new_buckets.capacity();
+	}
+
+	//
+	// 推进扩容：准备阶段构造n批空桶，迁移阶段搬走n个非空的桶
+	// 返回扩容是否还在进行
+	//
+	bool step(size_t n = 1) {
+		if (!is_rehashing())
+			return false;
+
+		if (m_new_buckets.size() < m_new_bucket_count) {
+			auto target = std::min(m_new_bucket_count, m_new_buckets.size() + n * REHASH_PREPARE_BATCH);
+			m_new_buckets.resize(target, shm_list<key_type>());
+			return true;
+		}
+
+		size_t empty_visits = n * REHASH_EMPTY_VISITS;
+		while (n > 0 && !m_buckets.empty()) {
+			auto& list = m_buckets.back();
+			if (list.empty()) {
+				m_buckets.pop_back();
+				if (--empty_visits == 0)
+					break;
+				continue;
+			}
+
+			// 直接把节点挂到新表上，不需要复制key
+			while (!list.empty()) {
+				m_new_buckets[new_bucket_index(list.front())].splice_front(list);
+			}
+			m_buckets.pop_back();
+			--n;
+		}
+
+		if (!m_buckets.empty())
+			return true;
+
+		// 旧表已经搬空，新表转正，迁移期间要求的扩容接着开始
+		m_buckets.swap(m_new_buckets);
+		m_new_buckets.shrink_to_fit();
+		m_bucket_count = m_new_bucket_count;
+		m_new_bucket_count = 0;
+		if (m_pending_bucket_count > 0) {
+			auto pending = m_pending_bucket_count;
+			m_pending_bucket_count = 0;
+			rehash(pending);
+		}
+		return is_rehashing();
 	}
 
 	iterator begin() {
 		size_type index = 0;
-		for (; index != m_buckets.size(); ++index) {
-			if (!(m_buckets[index].empty()))
+		for (; index != bucket_count(); ++index) {
+			if (!(bucket_list(index).empty()))
 				break;
 		}
-		if (index == m_buckets.size())
+		if (index == bucket_count())
 			return end();
-		return iterator(index, m_buckets[index].begin(), g_alloc->ToShmPointer<shm_hash<Key>>(this));
+		return iterator(index, bucket_list(index).begin(), g_alloc->ToShmPointer<shm_hash<Key>>(this));
 	}
 
 	iterator end() {
-		return iterator(m_buckets.size() - 1, m_buckets[m_buckets.size() - 1].end(),
+		return iterator(bucket_count() - 1, bucket_list(bucket_count() - 1).end(),
 						g_alloc->ToShmPointer<shm_hash<Key>>(this));
 	}
 
 	local_iterator begin(size_type i) {
-		return m_buckets[i].begin();
+		return bucket_list(i).begin();
 	}
 
 	local_iterator end(size_type i) {
-		return m_buckets[i].end();
+		return bucket_list(i).end();
 	}
 
 	iterator find(const key_type& key) {
-		auto index = bucket_index(key);
-		for (auto it = begin(index); it != end(index); ++it) {
-			if (key == *it)
-				return iterator(index, it, g_alloc->ToShmPointer<shm_hash<Key>>(this));
-		}
-		return end();
+		return find_key(key);
+	}
+
+	// 用可以直接和Key比较的类型查找，比如shm_hash<shm_string>用Slice查找
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator find(const K& key) {
+		return find_key(key);
 	}
 
 	size_type count(const key_type& key) {
-		auto it = find(key);
-		return it == end() ? 0 : 1;
+		return has_key(key) ? 1 : 0;
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_type count(const K& key) {
+		return has_key(key) ? 1 : 0;
 	}
 
 	std::pair<iterator, bool> insert(const key_type& val) {
-		if (!has_key(val)) {
-			if (load_factor() > max_load_factor())
-				rehash(next_prime(size()));
-			auto index = bucket_index(val);
-			m_buckets[index].push_front(val);
-			++m_size;
-			return std::pair<iterator, bool>(
-				iterator(index, m_buckets[index].begin(), g_alloc->ToShmPointer<shm_hash<Key>>(this)), true);
-		}
-		return std::pair<iterator, bool>(end(), false);
+		return insert_key(val);
+	}
+
+	std::pair<iterator, bool> insert(key_type&& val) {
+		return insert_key(std::move(val));
+	}
+
+	// 先构造出key再插入，key已经存在时什么也不做
+	template <typename... P>
+	std::pair<iterator, bool> emplace(P&&... params) {
+		return insert_key(key_type(std::forward<P>(params)...));
 	}
 
 	iterator erase(iterator position) {
 		--m_size;
 		auto t = position++;
 		auto index = t.bucket_index_;
-		m_buckets[index].erase(t.iterator_);
+		bucket_list(index).erase(t.iterator_);
 		return position;
 	}
 
 	bool erase(const key_type& key) {
-		auto it = find(key);
-		if (it == end()) {
-			return false;
-		} else {
-			erase(it);
-			return true;
-		}
+		return erase_key(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	bool erase(const K& key) {
+		return erase_key(key);
 	}
 
 	void clear() {
@@ -201,22 +308,65 @@ public:
 	}
 
 	void swap(shm_hash<Key>& x) {
-		std::swap(m_buckets, x.m_buckets);
+		m_buckets.swap(x.m_buckets);
+		m_new_buckets.swap(x.m_new_buckets);
+		std::swap(m_bucket_count, x.m_bucket_count);
+		std::swap(m_new_bucket_count, x.m_new_bucket_count);
+		std::swap(m_pending_bucket_count, x.m_pending_bucket_count);
 		std::swap(m_size, x.m_size);
 		std::swap(m_max_load_factor, x.m_max_load_factor);
 	}
 
 private:
-	size_type next_prime(size_type n) const {
-		return m_prime_util.NextPrime(n);
+	// 按两张表连在一起的编号取桶
+	shm_list<key_type>& bucket_list(size_type i) {
+		return i < m_buckets.size() ? m_buckets[i] : m_new_buckets[i - m_buckets.size()];
 	}
 
-	size_type bucket_index(const key_type& key) const {
-		return std::hash<key_type>()(key) % m_buckets.size();
+	template <class K>
+	iterator find_key(const K& key) {
+		auto index = locate(key);
+		for (auto it = begin(index); it != end(index); ++it) {
+			if (key == *it)
+				return iterator(index, it, g_alloc->ToShmPointer<shm_hash<Key>>(this));
+		}
+		return end();
 	}
 
-	bool has_key(const key_type& key) {
-		auto& list = m_buckets[bucket_index(key)];
+	template <class K>
+	bool erase_key(const K& key) {
+		auto it = find_key(key);
+		if (it == end()) {
+			return false;
+		} else {
+			erase(it);
+			return true;
+		}
+	}
+
+	// 桶数是2的幂，取模只用到低位，std::hash对整数是恒等映射，先把高位混合进来
+	template <class K>
+	static uint64_t hash_of(const K& key) {
+		return HashMix(uint64_t(std::hash<key_type>()(key)));
+	}
+
+	// key所在的桶：旧表中的桶还没有搬走就在旧表，否则在新表
+	template <class K>
+	size_type locate(const K& key) const {
+		auto hash = hash_of(key);
+		auto index = hash % m_bucket_count;
+		if (index < m_buckets.size() || m_new_buckets.size() < m_new_bucket_count)
+			return index;
+		return m_buckets.size() + hash % m_new_bucket_count;
+	}
+
+	size_type new_bucket_index(const key_type& key) const {
+		return hash_of(key) % m_new_bucket_count;
+	}
+
+	template <class K>
+	bool has_key(const K& key) {
+		auto& list = bucket_list(locate(key));
 		for (auto it = list.begin(); it != list.end(); ++it) {
 			if (key == *it)
 				return true;
@@ -224,15 +374,33 @@ private:
 		return false;
 	}
 
+	template <class V>
+	std::pair<iterator, bool> insert_key(V&& val) {
+		if (!has_key(val)) {
+			if (load_factor() > max_load_factor())
+				rehash(size());
+			step(REHASH_STEP);
+
+			auto index = locate(val);
+			bucket_list(index).push_front(std::forward<V>(val));
+			++m_size;
+			return std::pair<iterator, bool>(
+				iterator(index, bucket_list(index).begin(), g_alloc->ToShmPointer<shm_hash<Key>>(this)), true);
+		}
+		return std::pair<iterator, bool>(end(), false);
+	}
+
 private:
 	shm_vector<shm_list<Key>> m_buckets;
+	// 扩容时的新表，不在扩容时是空的
+	shm_vector<shm_list<Key>> m_new_buckets;
+	// 旧表的桶数，迁移时旧表从末尾开始销毁，取模仍然要用原来的桶数
+	size_t m_bucket_count = 0;
+	size_t m_new_bucket_count = 0;
+	// 迁移期间再次要求扩容的桶数，迁移完成后开始
+	size_t m_pending_bucket_count = 0;
 	size_t m_size = 0;
 	float m_max_load_factor = 0.0f;
-
-	static util::PrimeUtil m_prime_util;
 };
 
-template <class Key>
-util::PrimeUtil shm_hash<Key>::m_prime_util;
-
 } // namespace smd
@@ -0,0 +1,341 @@
+﻿#pragma once
+#include <string>
+#include <string.h>
+#include <assert.h>
+#include <functional>
+
+#include <common/functional.h>
+#include <common/hash.h>
+#include <common/slice.h>
+#include <mem_alloc/alloc.h>
+#include <container/shm_pointer.h>
+
+namespace smd {
+
+class shm_intern_pool;
+
+//
+// 池中的一个字符串，头部后面紧跟着字符串的内容和末尾的0，整块一次分配
+//
+struct InternEntry {
+	shm_pointer<InternEntry> next; // 同一个桶中的下一个
+	shm_pointer<shm_intern_pool> pool;
+	uint64_t hash;
+	uint32_t refcount;
+	uint32_t size;
+
+	char* data() {
+		return (char*)(this + 1);
+	}
+
+	// 按字节从池所在的字典分配，复制字符串的内容，其他字段由池填写
+	static shm_pointer<InternEntry> Create(Alloc* alloc, const Slice& s) {
+		shm_pointer<InternEntry> entry(alloc->Malloc<char>(AllocSize(s.size())).Raw());
+		assert(entry != shm_nullptr);
+		entry->size = uint32_t(s.size());
+		memcpy(entry->data(), s.data(), s.size());
+		entry->data()[s.size()] = '\0';
+		return entry;
+	}
+
+	static void Destroy(shm_pointer<InternEntry> entry) {
+		shm_pointer<char> block(entry.Raw());
+		g_alloc->Free(block, AllocSize(entry->size));
+	}
+
+	static size_t AllocSize(size_t size) {
+		return sizeof(InternEntry) + size + 1;
+	}
+};
+
+//
+// 驻留字符串的句柄：相同内容的字符串在池中只有一份，句柄只是一个指针，带引用计数
+// 同一个池得到的句柄直接比较指针，最后一个句柄析构时从池中删除
+// 空字符串不占用池中的空间，句柄为空
+//
+class shm_istring {
+public:
+	shm_istring() = default;
+
+	shm_istring(const shm_istring& r)
+		: m_entry(r.m_entry) {
+		retain();
+	}
+
+	shm_istring(shm_istring&& r) noexcept
+		: m_entry(r.m_entry) {
+		r.m_entry = shm_nullptr;
+	}
+
+	shm_istring& operator=(const shm_istring& r) {
+		if (m_entry != r.m_entry) {
+			shm_istring(r).swap(*this);
+		}
+		return *this;
+	}
+
+	shm_istring& operator=(shm_istring&& r) noexcept {
+		if (this != &r) {
+			shm_istring(std::move(r)).swap(*this);
+		}
+		return *this;
+	}
+
+	~shm_istring() {
+		release();
+	}
+
+	void swap(shm_istring& r) {
+		std::swap(m_entry, r.m_entry);
+	}
+
+	const char* data() const {
+		return m_entry != shm_nullptr ? m_entry->data() : "";
+	}
+
+	size_t size() const {
+		return m_entry != shm_nullptr ? m_entry->size : 0;
+	}
+
+	bool empty() const {
+		return m_entry == shm_nullptr;
+	}
+
+	// 池中保存的哈希值，和同样内容的shm_string一致
+	uint64_t hash() const {
+		return m_entry != shm_nullptr ? m_entry->hash : BytesHash::Hash("", 0);
+	}
+
+	// 共享同一份内容的句柄数
+	uint32_t use_count() const {
+		return m_entry != shm_nullptr ? m_entry->refcount : 0;
+	}
+
+	std::string ToString() const {
+		return std::string(data(), size());
+	}
+
+	void clear() {
+		shm_istring().swap(*this);
+	}
+
+	bool operator==(const shm_istring& r) const {
+		return m_entry == r.m_entry;
+	}
+
+	bool operator!=(const shm_istring& r) const {
+		return m_entry != r.m_entry;
+	}
+
+	// 按内容排序，可以作为shm_map的key
+	int compare(const shm_istring& r) const {
+		if (m_entry == r.m_entry)
+			return 0;
+
+		const size_t min_len = (size() < r.size()) ? size() : r.size();
+		int ret = memcmp(data(), r.data(), min_len);
+		if (ret == 0) {
+			if (size() < r.size())
+				ret = -1;
+			else if (size() > r.size())
+				ret = +1;
+		}
+		return ret;
+	}
+
+private:
+	friend class shm_intern_pool;
+
+	explicit shm_istring(shm_pointer<InternEntry> entry)
+		: m_entry(entry) {
+		retain();
+	}
+
+	void retain() {
+		if (m_entry != shm_nullptr) {
+			m_entry->refcount++;
+		}
+	}
+
+	void release();
+
+private:
+	shm_pointer<InternEntry> m_entry = shm_nullptr;
+};
+
+//
+// 字符串驻留池，放在共享内存中，和其他容器一样可以作为字典结构的成员
+// 链地址法的哈希表，链接直接放在InternEntry中；池的地址记录在每个字符串中，不能移动，也不能比句柄先析构
+//
+class shm_intern_pool {
+public:
+	enum : size_t {
+		MIN_BUCKET_COUNT = 16,
+	};
+
+	shm_intern_pool() = default;
+	shm_intern_pool(const shm_intern_pool&) = delete;
+	shm_intern_pool& operator=(const shm_intern_pool&) = delete;
+
+	~shm_intern_pool() {
+		if (m_size > 0) {
+			SMD_LOG_ERROR("intern pool destroyed with %llu strings still referenced", m_size);
+		}
+
+		for (size_t i = 0; i < m_bucket_count; i++) {
+			auto entry = m_buckets[i];
+			while (entry != shm_nullptr) {
+				auto next = entry->next;
+				InternEntry::Destroy(entry);
+				entry = next;
+			}
+		}
+
+		if (m_buckets != shm_nullptr) {
+			g_alloc->Free(m_buckets, m_bucket_count);
+		}
+	}
+
+	// 已经存在时返回池中的那一份，否则复制一份放进池中
+	shm_istring intern(const Slice& s) {
+		if (s.size() == 0)
+			return shm_istring();
+
+		const uint64_t hash = BytesHash::Hash(s.data(), s.size());
+		auto entry = lookup(s, hash);
+		if (entry != shm_nullptr)
+			return shm_istring(entry);
+
+		if (m_bucket_count == 0 || m_size + 1 > m_bucket_count) {
+			rehash(m_bucket_count * 2);
+		}
+
+		entry = InternEntry::Create(AllocOf(this), s);
+		entry->pool = g_alloc->ToShmPointer<shm_intern_pool>(this);
+		entry->hash = hash;
+		entry->refcount = 0;
+
+		auto& head = m_buckets[bucket_index(hash)];
+		entry->next = head;
+		head = entry;
+		m_size++;
+		return shm_istring(entry);
+	}
+
+	// 不在池中时返回空句柄
+	shm_istring find(const Slice& s) const {
+		if (s.size() == 0)
+			return shm_istring();
+
+		return shm_istring(lookup(s, BytesHash::Hash(s.data(), s.size())));
+	}
+
+	// 池中不同字符串的个数
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+private:
+	friend class shm_istring;
+
+	shm_pointer<InternEntry> lookup(const Slice& s, uint64_t hash) const {
+		if (m_size == 0)
+			return shm_nullptr;
+
+		for (auto entry = m_buckets[bucket_index(hash)]; entry != shm_nullptr; entry = entry->next) {
+			if (entry->hash == hash && entry->size == s.size() && memcmp(entry->data(), s.data(), s.size()) == 0)
+				return entry;
+		}
+		return shm_nullptr;
+	}
+
+	// 最后一个句柄释放时调用
+	void erase(shm_pointer<InternEntry> entry) {
+		auto index = bucket_index(entry->hash);
+		if (m_buckets[index] == entry) {
+			m_buckets[index] = entry->next;
+		} else {
+			auto prev = m_buckets[index];
+			while (prev->next != entry) {
+				prev = prev->next;
+			}
+			prev->next = entry->next;
+		}
+
+		InternEntry::Destroy(entry);
+		m_size--;
+	}
+
+	size_t bucket_index(uint64_t hash) const {
+		return size_t(hash & (m_bucket_count - 1));
+	}
+
+	// 桶数翻倍，字符串按保存的哈希值挂到新的桶上
+	void rehash(size_t n) {
+		n = n < MIN_BUCKET_COUNT ? size_t(MIN_BUCKET_COUNT) : n;
+		Alloc* alloc = AllocOf(this);
+		auto buckets = alloc->Malloc<shm_pointer<InternEntry>>(n);
+		assert(buckets != shm_nullptr);
+		for (size_t i = 0; i < n; i++) {
+			buckets[i] = shm_nullptr;
+		}
+
+		for (size_t i = 0; i < m_bucket_count; i++) {
+			auto entry = m_buckets[i];
+			while (entry != shm_nullptr) {
+				auto next = entry->next;
+				auto& head = buckets[entry->hash & (n - 1)];
+				entry->next = head;
+				head = entry;
+				entry = next;
+			}
+		}
+
+		if (m_buckets != shm_nullptr) {
+			g_alloc->Free(m_buckets, m_bucket_count);
+		}
+		m_buckets = buckets;
+		m_bucket_count = n;
+	}
+
+private:
+	shm_pointer<shm_pointer<InternEntry>> m_buckets = shm_nullptr;
+	size_t m_bucket_count = 0;
+	size_t m_size = 0;
+};
+
+inline void shm_istring::release() {
+	if (m_entry != shm_nullptr) {
+		if (--m_entry->refcount == 0) {
+			m_entry->pool->erase(m_entry);
+		}
+		m_entry = shm_nullptr;
+	}
+}
+
+inline bool operator<(const shm_istring& x, const shm_istring& y) { return x.compare(y) < 0; }
+inline bool operator>(const shm_istring& x, const shm_istring& y) { return x.compare(y) > 0; }
+
+template <>
+inline int64_t compare(const shm_istring& x, const shm_istring& y) {
+	return x.compare(y);
+}
+
+} // namespace smd
+
+namespace std {
+template <>
+struct hash<smd::shm_istring> {
+	typedef smd::shm_istring argument_type;
+	typedef std::size_t result_type;
+
+	result_type operator()(argument_type const& s) const {
+		return s.hash();
+	}
+};
+
+} // namespace std
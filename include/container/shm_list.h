@@ -1,4 +1,7 @@
 ﻿#pragma once
+#include <assert.h>
+#include <functional>
+#include <utility>
 #include <container/shm_pointer.h>
 
 namespace smd {
@@ -6,25 +9,22 @@ namespace smd {
 template <class T>
 class shm_list;
 
+//
+// 节点只有前后两个指针和数据，首节点的prev和尾节点的next为空
+//
 template <class T>
 struct ListNode {
-	shm_pointer<shm_list<T>> container;
-	T data;
 	shm_pointer<ListNode> prev;
 	shm_pointer<ListNode> next;
+	T data;
 
-	ListNode(shm_pointer<shm_list<T>> c, const T& d, shm_pointer<ListNode> p, shm_pointer<ListNode> n)
-		: container(c)
-		, data(d)
-		, prev(p)
-		, next(n) {}
-
-	bool operator==(const ListNode& n) {
-		return data == n.data && prev == n.prev && next == n.next && &container == &n.container;
-	}
+	template <typename... P>
+	ListNode(P&&... params)
+		: data(std::forward<P>(params)...) {}
 };
 
 // the class of list iterator
+// end()是空指针，不能从end()往回退
 template <class T>
 class ListIterator {
 public:
@@ -72,7 +72,7 @@ public:
 	}
 
 	void swap(ListIterator<T>& x) {
-		swap(p, x.p);
+		std::swap(p, x.p);
 	}
 
 	friend bool operator!=(const ListIterator<T>& x, const ListIterator<T>& y) {
@@ -84,26 +84,29 @@ public:
 	}
 };
 
+//
+// 双向链表，首尾指针和元素个数直接放在链表对象里，不额外分配哨兵节点
+// 节点不指向链表本身，链表对象可以随意搬动（比如放在shm_vector里扩容），也可以放在栈上
+//
 template <class T>
 class shm_list {
 public:
 	typedef shm_pointer<ListNode<T>> nodePtr;
 	typedef ListIterator<T> iterator;
 
-	shm_list()
-		: m_head(NewNode(T()))
-		, m_tail(m_head) {}
-
-	shm_list(const shm_list<T>& r)
-		: m_head(NewNode(*((shm_list<T>&)r).end()))
-		, m_tail(m_head) {
-		shm_list<T>* r1 = (shm_list<T>*)&r;
-		for (iterator it = r1->begin(); it != r1->end(); ++it) {
-			auto& element = *it;
-			push_back(element);
+	shm_list() = default;
+
+	shm_list(const shm_list<T>& r) {
+		for (auto node = r.m_head; node != shm_nullptr; node = node->next) {
+			push_back(node->data);
 		}
 	}
 
+	// 接管r的节点
+	shm_list(shm_list&& r) noexcept {
+		swap(r);
+	}
+
 	shm_list& operator=(const shm_list& l) {
 		if (this != &l) {
 			shm_list(l).swap(*this);
@@ -111,136 +114,263 @@ public:
 		return *this;
 	}
 
+	shm_list& operator=(shm_list&& r) noexcept {
+		if (this != &r) {
+			clear();
+			swap(r);
+		}
+		return *this;
+	}
+
 	~shm_list() {
 		clear();
-		g_alloc->Delete(m_tail.p);
-
-		m_head = shm_nullptr;
-		m_tail = shm_nullptr;
 	}
 
 	T& front() {
-		return (m_head.p->data);
+		return m_head->data;
 	}
 
 	T& back() {
-		return (m_tail.p->prev->data);
+		return m_tail->data;
 	}
 
 	void push_front(const T& val) {
-		auto node = NewNode(val);
-		m_head.p->prev = node;
-		node->next = m_head.p;
-		m_head.p = node;
+		emplace_front(val);
+	}
+
+	void push_front(T&& val) {
+		emplace_front(std::move(val));
+	}
+
+	// 直接在节点中构造元素
+	template <typename... P>
+	T& emplace_front(P&&... params) {
+		auto node = NewNode(std::forward<P>(params)...);
+		LinkBefore(m_head, node);
+		return node->data;
 	}
 
 	void pop_front() {
-		auto node = m_head.p;
-		m_head.p = node->next;
-		m_head.p->prev = shm_nullptr;
+		auto node = m_head;
+		Unlink(node);
 		DeleteNode(node);
 	}
 
 	void push_back(const T& val) {
-		auto node = NewNode(val);
-		if (m_tail.p->prev != shm_nullptr) {
-			// 已有元素
-			auto prev = m_tail.p->prev;
-			prev->next = node;
-			node->next = m_tail.p;
-
-			m_tail.p->prev = node;
-			node->prev = prev;
-		} else {
-			// 空链表
-			node->next = m_tail.p;
-			node->prev = shm_nullptr;
+		emplace_back(val);
+	}
 
-			m_tail.p->prev = node;
-			m_head.p = node;
-		}
+	void push_back(T&& val) {
+		emplace_back(std::move(val));
 	}
 
-	void pop_back() {
-		auto node = m_tail.p->prev;
-		if (node->prev != shm_nullptr) {
-			auto& prev = node->prev;
-			prev->next = node->next;
+	template <typename... P>
+	T& emplace_back(P&&... params) {
+		auto node = NewNode(std::forward<P>(params)...);
+		LinkBefore(shm_nullptr, node);
+		return node->data;
+	}
 
-			m_tail.p->prev = node->prev;
-		} else {
-			m_head.p = m_tail.p;
-			m_head.p->next = shm_nullptr;
-			m_head.p->prev = shm_nullptr;
-		}
+	// 在position之前构造一个元素，返回指向它的迭代器
+	template <typename... P>
+	iterator emplace(iterator position, P&&... params) {
+		auto node = NewNode(std::forward<P>(params)...);
+		LinkBefore(position.p, node);
+		return iterator(node);
+	}
 
+	void pop_back() {
+		auto node = m_tail;
+		Unlink(node);
 		DeleteNode(node);
 	}
 
 	iterator begin() {
-		return m_head;
+		return iterator(m_head);
 	}
 
 	iterator end() {
-		return m_tail;
+		return iterator();
 	}
 
 	bool empty() const {
-		return m_head == m_tail;
+		return m_size == 0;
 	}
 
 	size_t size() const {
-		size_t length = 0;
-		for (auto h = m_head; h != m_tail; ++h)
-			++length;
-		return length;
+		return m_size;
 	}
 
 	void clear() {
-		erase(begin(), end());
+		auto node = m_head;
+		while (node != shm_nullptr) {
+			auto next = node->next;
+			DeleteNode(node);
+			node = next;
+		}
+		m_head = m_tail = shm_nullptr;
+		m_size = 0;
 	}
 
 	iterator erase(iterator position) {
-		if (position == m_head) {
-			pop_front();
-			return m_head;
-		} else {
-			auto prev = position.p->prev;
-			prev->next = position.p->next;
-			position.p->next->prev = prev;
-			DeleteNode(position.p);
-			return iterator(prev->next);
-		}
+		auto next = position.p->next;
+		Unlink(position.p);
+		DeleteNode(position.p);
+		return iterator(next);
 	}
 
 	iterator erase(iterator first, iterator last) {
-		iterator res;
-		for (; first != last;) {
-			auto temp = first++;
-			res = erase(temp);
+		while (first != last) {
+			first = erase(first);
 		}
-		return res;
+		return last;
 	}
 
-private:
-	nodePtr NewNode(const T& val) {
-		auto p = g_alloc->New<ListNode<T>>(g_alloc->ToShmPointer<shm_list<T>>(this), val, shm_nullptr, shm_nullptr);
-		return p;
+	//
+	// 以下操作只改链接，不分配也不复制元素；other可以是自己
+	//
+
+	// 把other的第一个节点摘下来放到自己的头部
+	void splice_front(shm_list& other) {
+		assert(!other.empty());
+		splice(begin(), other, other.begin());
 	}
 
-	void DeleteNode(nodePtr p) {
-		p->prev = p->next = shm_nullptr;
-		g_alloc->Delete(p);
+	// 把other的全部节点移到position之前
+	void splice(iterator position, shm_list& other) {
+		if (this == &other || other.empty())
+			return;
+
+		auto first = other.m_head;
+		auto last = other.m_tail;
+		auto count = other.m_size;
+		other.m_head = other.m_tail = shm_nullptr;
+		other.m_size = 0;
+		LinkRange(position.p, first, last, count);
+	}
+
+	// 把other中it指向的节点移到position之前
+	void splice(iterator position, shm_list& other, iterator it) {
+		if (position == it || (it.p->next == position.p && position.p != shm_nullptr))
+			return;
+		if (this == &other && position.p == shm_nullptr && it.p == m_tail)
+			return;
+
+		other.Unlink(it.p);
+		LinkBefore(position.p, it.p);
+	}
+
+	// 把other中[first, last)的节点移到position之前，position不能在区间内
+	// 来自其他链表时需要数一遍区间的长度
+	void splice(iterator position, shm_list& other, iterator first, iterator last) {
+		if (first == last)
+			return;
+
+		size_t count = 0;
+		if (this != &other) {
+			for (auto it = first; it != last; ++it) {
+				count++;
+			}
+		}
+
+		auto head = first.p;
+		auto tail = last.p != shm_nullptr ? last.p->prev : other.m_tail;
+		other.UnlinkRange(head, tail, count);
+		LinkRange(position.p, head, tail, count);
+	}
+
+	// 两个链表都已经按comp排好序，把other的节点归并进来，相等的元素自己的在前
+	template <class Compare>
+	void merge(shm_list& other, Compare comp) {
+		if (this == &other || other.empty())
+			return;
+
+		auto pos = m_head;
+		while (pos != shm_nullptr && !other.empty()) {
+			if (comp(other.m_head->data, pos->data)) {
+				// 把other中连续小于pos的一段整体挂过来
+				auto head = other.m_head;
+				auto tail = head;
+				size_t count = 1;
+				while (tail->next != shm_nullptr && comp(tail->next->data, pos->data)) {
+					tail = tail->next;
+					count++;
+				}
+				other.UnlinkRange(head, tail, count);
+				LinkRange(pos, head, tail, count);
+			}
+			pos = pos->next;
+		}
+		splice(end(), other);
+	}
+
+	void merge(shm_list& other) {
+		merge(other, std::less<T>());
 	}
 
 	void swap(shm_list<T>& x) {
 		std::swap(m_head, x.m_head);
 		std::swap(m_tail, x.m_tail);
+		std::swap(m_size, x.m_size);
+	}
+
+private:
+	template <typename... P>
+	nodePtr NewNode(P&&... params) {
+		Alloc* alloc = AllocOf(this);
+		return alloc->New<ListNode<T>>(std::forward<P>(params)...);
+	}
+
+	void DeleteNode(nodePtr p) {
+		g_alloc->Delete(p);
+	}
+
+	// 把单个节点挂到pos之前，pos为空时挂到末尾
+	void LinkBefore(nodePtr pos, nodePtr node) {
+		LinkRange(pos, node, node, 1);
+	}
+
+	// 把已经连好的[head, tail]挂到pos之前，count为0表示节点本来就在这个链表里
+	void LinkRange(nodePtr pos, nodePtr head, nodePtr tail, size_t count) {
+		auto prev = pos != shm_nullptr ? pos->prev : m_tail;
+		head->prev = prev;
+		tail->next = pos;
+		if (prev != shm_nullptr) {
+			prev->next = head;
+		} else {
+			m_head = head;
+		}
+		if (pos != shm_nullptr) {
+			pos->prev = tail;
+		} else {
+			m_tail = tail;
+		}
+		m_size += count;
+	}
+
+	void Unlink(nodePtr node) {
+		UnlinkRange(node, node, 1);
+	}
+
+	// 摘下[head, tail]，两端的链接保留原值，由调用者重新设置
+	void UnlinkRange(nodePtr head, nodePtr tail, size_t count) {
+		if (head->prev != shm_nullptr) {
+			head->prev->next = tail->next;
+		} else {
+			m_head = tail->next;
+		}
+		if (tail->next != shm_nullptr) {
+			tail->next->prev = head->prev;
+		} else {
+			m_tail = head->prev;
+		}
+		m_size -= count;
 	}
 
 private:
-	iterator m_head;
-	iterator m_tail;
+	nodePtr m_head = shm_nullptr;
+	nodePtr m_tail = shm_nullptr;
+	size_t m_size = 0;
 };
 
 } // namespace smd
@@ -1,5 +1,12 @@
 ﻿#pragma once
+#include <type_traits>
+#include <tuple>
+#include <utility>
+#include <common/functional.h>
 #include <container/shm_pointer.h>
+#ifdef _WIN32
+	#include <intrin.h>
+#endif
 
 namespace smd {
 
@@ -8,21 +15,31 @@ enum RBTreeNodeColor : bool {
 	RBTREE_NODE_BLACK = true,
 };
 
-template <typename Value>
-struct RBTreeNode {
+// 带排名的树在每个节点上记录子树的节点个数，普通的树没有这个字段，不占空间
+template <bool Counted>
+struct RBTreeNodeCount {};
+
+template <>
+struct RBTreeNodeCount<true> {
+	size_t count = 1;
+};
+
+template <typename Value, bool Counted = false>
+struct RBTreeNode : RBTreeNodeCount<Counted> {
 	RBTreeNodeColor color;
 	shm_pointer<RBTreeNode> parent;
 	shm_pointer<RBTreeNode> left_child;
 	shm_pointer<RBTreeNode> right_child;
 	Value value;
 
-	RBTreeNode(const Value& val)
+	template <typename... P>
+	RBTreeNode(P&&... params)
 		: color(RBTREE_NODE_RED)
-		, value(val) {}
+		, value(std::forward<P>(params)...) {}
 };
 
-template <typename value_type>
-static shm_pointer<RBTreeNode<value_type>> rbtree_prev(shm_pointer<RBTreeNode<value_type>> node) {
+template <typename Node>
+static shm_pointer<Node> rbtree_prev(shm_pointer<Node> node) {
 	if (node == shm_nullptr) {
 		return shm_nullptr;
 	}
@@ -37,7 +54,7 @@ static shm_pointer<RBTreeNode<value_type>> rbtree_prev(shm_pointer<RBTreeNode<va
 		return node;
 	}
 
-	shm_pointer<RBTreeNode<value_type>> n;
+	shm_pointer<Node> n;
 	while ((n = node->parent) != shm_nullptr && node == n->left_child) {
 		node = n;
 	}
@@ -45,8 +62,8 @@ static shm_pointer<RBTreeNode<value_type>> rbtree_prev(shm_pointer<RBTreeNode<va
 	return n;
 }
 
-template <typename value_type>
-static shm_pointer<RBTreeNode<value_type>> rbtree_next(shm_pointer<RBTreeNode<value_type>> node) {
+template <typename Node>
+static shm_pointer<Node> rbtree_next(shm_pointer<Node> node) {
 	if (node == shm_nullptr) {
 		return shm_nullptr;
 	}
@@ -61,7 +78,7 @@ static shm_pointer<RBTreeNode<value_type>> rbtree_next(shm_pointer<RBTreeNode<va
 		return node;
 	}
 
-	shm_pointer<RBTreeNode<value_type>> n;
+	shm_pointer<Node> n;
 	while ((n = node->parent) != shm_nullptr && node == n->right_child) {
 		node = n;
 	}
@@ -69,15 +86,28 @@ static shm_pointer<RBTreeNode<value_type>> rbtree_next(shm_pointer<RBTreeNode<va
 	return n;
 }
 
-template <typename T, typename Pointer, typename Reference>
+// 提前把节点读进缓存，不等待结果
+template <typename Node>
+static void rbtree_prefetch(shm_pointer<Node> node) {
+	if (node == shm_nullptr) {
+		return;
+	}
+#ifdef _WIN32
+	_mm_prefetch((const char*)node.Ptr(), _MM_HINT_T0);
+#else
+	__builtin_prefetch(node.Ptr());
+#endif
+}
+
+template <typename Node, typename Pointer, typename Reference>
 struct rbtree_iterator {
-	typedef rbtree_iterator<T, Pointer, Reference> this_type;
+	typedef rbtree_iterator<Node, Pointer, Reference> this_type;
 
-	shm_pointer<RBTreeNode<T>> _ptr;
+	shm_pointer<Node> _ptr;
 
 	rbtree_iterator()
 		: _ptr(shm_nullptr) {}
-	rbtree_iterator(shm_pointer<RBTreeNode<T>> pNode)
+	rbtree_iterator(shm_pointer<Node> pNode)
 		: _ptr(pNode) {}
 	rbtree_iterator(const this_type& x) = default;
 
@@ -90,24 +120,24 @@ struct rbtree_iterator {
 	}
 
 	rbtree_iterator& operator++() {
-		_ptr = rbtree_next<T>(_ptr);
+		_ptr = rbtree_next<Node>(_ptr);
 		return *this;
 	}
 
 	rbtree_iterator operator++(int) {
 		this_type tmp(*this);
-		_ptr = rbtree_next<T>(_ptr);
+		_ptr = rbtree_next<Node>(_ptr);
 		return tmp;
 	}
 
 	rbtree_iterator& operator--() {
-		_ptr = rbtree_prev<T>(_ptr);
+		_ptr = rbtree_prev<Node>(_ptr);
 		return *this;
 	}
 
 	rbtree_iterator operator--(int) {
 		this_type tmp(*this);
-		_ptr = rbtree_prev<T>(_ptr);
+		_ptr = rbtree_prev<Node>(_ptr);
 		return tmp;
 	}
 
@@ -120,14 +150,24 @@ struct rbtree_iterator {
 	}
 };
 
-template <typename Key, typename Value>
+//
+// OrderStatistic为true时节点上多记录一个子树大小，插入删除和旋转时顺带维护，
+// 可以在O(logn)内完成rank、select、count_range，计数保存在共享内存的节点里，attach之后直接可用
+//
+template <typename Key, typename Value, bool OrderStatistic = false>
 class shm_map {
 public:
-	typedef shm_map<Key, Value> this_type;
+	typedef shm_map<Key, Value, OrderStatistic> this_type;
 	typedef std::pair<Key, Value> value_type;
-	typedef shm_pointer<RBTreeNode<value_type>> rbtree_node_ptr;
-	typedef rbtree_iterator<value_type, value_type*, value_type&> iterator;
-	typedef rbtree_iterator<value_type, const value_type*, const value_type&> const_iterator;
+	typedef RBTreeNode<value_type, OrderStatistic> node_type;
+	typedef shm_pointer<node_type> rbtree_node_ptr;
+	typedef rbtree_iterator<node_type, value_type*, value_type&> iterator;
+	typedef rbtree_iterator<node_type, const value_type*, const value_type&> const_iterator;
+
+	enum : size_t {
+		FIND_GROUP = 16,
+		SORTED_STEPS = 4,
+	};
 
 	shm_map()
 		: root_(shm_nullptr)
@@ -141,6 +181,14 @@ public:
 		}
 	}
 
+	// 接管r的所有节点
+	shm_map(this_type&& r) noexcept
+		: root_(r.root_)
+		, size_(r.size_) {
+		r.root_ = shm_nullptr;
+		r.size_ = 0;
+	}
+
 	this_type& operator=(const this_type& r) {
 		if (this != &r) {
 			shm_map(r).swap(*this);
@@ -148,6 +196,14 @@ public:
 		return *this;
 	}
 
+	this_type& operator=(this_type&& r) noexcept {
+		if (this != &r) {
+			clear();
+			swap(r);
+		}
+		return *this;
+	}
+
 	void swap(this_type& r) {
 		std::swap(root_, r.root_);
 		std::swap(size_, r.size_);
@@ -181,51 +237,58 @@ public:
 		return size_ == 0;
 	}
 
+	// key已经存在时插入失败，返回空指针
 	rbtree_node_ptr insert(const value_type& value) {
-		auto node = createNode(value);
+		return insert_node(createNode(value));
+	}
 
-		auto n = root_;
-		if (n != shm_nullptr) {
-			for (;;) {
-				auto cmp = compare(key(node), n);
-
-				if (cmp < 0) {
-					if (n->left_child != shm_nullptr) {
-						n = n->left_child;
-					} else {
-						n->left_child = node;
-
-						break;
-					}
-				} else if (cmp > 0) {
-					if (n->right_child != shm_nullptr) {
-						n = n->right_child;
-					} else {
-						n->right_child = node;
-
-						break;
-					}
-				} else {
-					//节点重复，插入失败
-					deleteNode(node);
-					return shm_nullptr;
-				}
-			}
+	rbtree_node_ptr insert(value_type&& value) {
+		return insert_node(createNode(std::move(value)));
+	}
+
+	// 先构造出节点再查找，key已经存在时节点会被销毁，能用try_emplace的时候尽量用try_emplace
+	template <typename... P>
+	std::pair<iterator, bool> emplace(P&&... params) {
+		auto node = insert_node(createNode(std::forward<P>(params)...));
+		if (node == shm_nullptr) {
+			return std::make_pair(end(), false);
 		}
+		return std::make_pair(iterator(node), true);
+	}
 
-		node->parent = n;
-		node->left_child = shm_nullptr;
-		node->right_child = shm_nullptr;
-		node->color = RBTREE_NODE_RED;
+	// key不存在时用args直接在节点中构造value，已经存在时什么也不做；查找和插入共用一次下降
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(const Key& k, P&&... args) {
+		return try_emplace_key(shm_nullptr, k, std::forward<P>(args)...);
+	}
 
-		if (n == shm_nullptr) {
-			root_ = node;
-		}
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(Key&& k, P&&... args) {
+		return try_emplace_key(shm_nullptr, std::move(k), std::forward<P>(args)...);
+	}
 
-		repair_after_insert(node);
+	// 用Slice等类型查找，不存在时才构造Key
+	template <class K, typename... P, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	std::pair<iterator, bool> try_emplace(const K& k, P&&... args) {
+		return try_emplace_key(shm_nullptr, k, std::forward<P>(args)...);
+	}
 
-		++size_;
-		return node;
+	//
+	// 带提示的版本：k等于hint或者它的后继，或者落在两者之间时不用从根开始找，否则和不带hint一样
+	// 按key递增的顺序操作一批相邻的key时，把上一次的结果作为下一次的hint，每次只需要比较一两次
+	//
+	template <typename... P>
+	iterator try_emplace(iterator hint, const Key& k, P&&... args) {
+		return try_emplace_key(hint._ptr, k, std::forward<P>(args)...).first;
+	}
+
+	template <class K, typename... P, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator try_emplace(iterator hint, const K& k, P&&... args) {
+		return try_emplace_key(hint._ptr, k, std::forward<P>(args)...).first;
+	}
+
+	Value& operator[](const Key& k) {
+		return try_emplace(k).first->second;
 	}
 
 	iterator find(const Key& key) {
@@ -236,10 +299,189 @@ public:
 		return const_iterator(rbtree_lookup_key(key));
 	}
 
+	// 用可以直接和Key比较的类型查找，比如shm_map<shm_string, ...>用Slice查找
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator find(const K& key) {
+		return iterator(rbtree_lookup_key(key));
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	const_iterator find(const K& key) const {
+		return const_iterator(rbtree_lookup_key(key));
+	}
+
+	// hint的含义和try_emplace一样
+	iterator find(iterator hint, const Key& key) {
+		return iterator(rbtree_lookup_key(key, hint._ptr));
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator find(iterator hint, const K& key) {
+		return iterator(rbtree_lookup_key(key, hint._ptr));
+	}
+
+	//
+	// 批量查找，callback的参数是(size_t i, iterator it)，it是keys[i]所在的位置，不存在时为end()
+	// 同时有FIND_GROUP个key轮流往下走，每走一步预取下一层的节点，多个key等待内存的时间互相重叠
+	// callback按查找结束的先后调用，不是keys的顺序；callback里不能增删节点，可以修改value
+	//
+	template <class K, class F>
+	void find_many(const K* keys, size_t count, F&& callback) {
+		find_group(0, count, [keys](size_t i) -> const K& { return keys[i]; }, callback);
+	}
+
+	//
+	// 按order给出的顺序批量查找，keys[order[0]], keys[order[1]]...必须是递增的，callback和find_many一样
+	// 相邻的key在树里也挨得近时（比如同一个玩家的一组数据），从上一个key的位置往后走几步就能找到，不用从根开始；
+	// 开头FIND_GROUP个key里有一半要从根开始找时说明key很分散，剩下的交给find_many的方式一起往下走
+	//
+	template <class K, class F>
+	void find_sorted(const K* keys, const size_t* order, size_t count, F&& callback) {
+		rbtree_node_ptr n = shm_nullptr;
+		size_t far = 0;
+		for (size_t j = 0; j < count; j++) {
+			if (j == FIND_GROUP && far * 2 >= FIND_GROUP) {
+				find_group(j, count, [keys, order](size_t i) -> const K& { return keys[order[i]]; },
+					[&callback, order](size_t i, iterator it) { callback(order[i], it); });
+				return;
+			}
+
+			const K& k = keys[order[j]];
+			int64_t cmp = 1;
+			for (size_t step = 0; n != shm_nullptr && (cmp = compare(k, n)) > 0 && step < SORTED_STEPS; step++) {
+				n = rbtree_next<node_type>(n);
+			}
+			if (n == shm_nullptr || cmp > 0) {
+				++far;
+				n = rbtree_lower_bound(k);
+				cmp = n != shm_nullptr ? compare(k, n) : 1;
+			}
+			callback(order[j], cmp == 0 ? iterator(n) : end());
+		}
+	}
+
+	size_t count(const Key& key) const {
+		return rbtree_lookup_key(key) != shm_nullptr ? 1 : 0;
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_t count(const K& key) const {
+		return rbtree_lookup_key(key) != shm_nullptr ? 1 : 0;
+	}
+
 	iterator erase(iterator it) {
 		return iterator(rbtree_remove(it._ptr));
 	}
 
+	size_t erase(const Key& key) {
+		return erase_key(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_t erase(const K& key) {
+		return erase_key(key);
+	}
+
+	// 第一个不小于key的元素
+	iterator lower_bound(const Key& key) {
+		return iterator(rbtree_lower_bound(key));
+	}
+
+	const_iterator lower_bound(const Key& key) const {
+		return const_iterator(rbtree_lower_bound(key));
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator lower_bound(const K& key) {
+		return iterator(rbtree_lower_bound(key));
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	const_iterator lower_bound(const K& key) const {
+		return const_iterator(rbtree_lower_bound(key));
+	}
+
+	// 第一个大于key的元素
+	iterator upper_bound(const Key& key) {
+		return iterator(rbtree_upper_bound(key));
+	}
+
+	const_iterator upper_bound(const Key& key) const {
+		return const_iterator(rbtree_upper_bound(key));
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator upper_bound(const K& key) {
+		return iterator(rbtree_upper_bound(key));
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	const_iterator upper_bound(const K& key) const {
+		return const_iterator(rbtree_upper_bound(key));
+	}
+
+	// key不重复，区间里最多一个元素，只需要一次查找
+	std::pair<iterator, iterator> equal_range(const Key& key) {
+		return equal_range_key<iterator>(key);
+	}
+
+	std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+		return equal_range_key<const_iterator>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	std::pair<iterator, iterator> equal_range(const K& key) {
+		return equal_range_key<iterator>(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+		return equal_range_key<const_iterator>(key);
+	}
+
+	//
+	// 按顺序访问[from, to)中的元素，最多limit个，返回访问的个数；callback的参数是(const Key&, Value&)
+	// 只进入和区间相交的子树，不经过父指针回溯，代价是O(logn + k)
+	//
+	template <class F>
+	size_t scan(const Key& from, const Key& to, size_t limit, F&& callback) {
+		return scan_key(from, to, limit, callback);
+	}
+
+	template <class K, class F, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_t scan(const K& from, const K& to, size_t limit, F&& callback) {
+		return scan_key(from, to, limit, callback);
+	}
+
+	// 小于key的元素个数，也就是key在排行中的名次（从0开始）
+	size_t rank(const Key& key) const {
+		return rank_key(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_t rank(const K& key) const {
+		return rank_key(key);
+	}
+
+	// 第k个元素（从0开始），k >= size()时返回end()
+	iterator select(size_t k) {
+		return iterator(rbtree_select(k));
+	}
+
+	const_iterator select(size_t k) const {
+		return const_iterator(rbtree_select(k));
+	}
+
+	// [lo, hi)中的元素个数，和scan的区间一致
+	size_t count_range(const Key& lo, const Key& hi) const {
+		return count_range_key(lo, hi);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_t count_range(const K& lo, const K& hi) const {
+		return count_range_key(lo, hi);
+	}
+
 	void clear() {
 		recurErase(root_);
 		root_ = shm_nullptr;
@@ -247,10 +489,61 @@ public:
 	}
 
 protected:
+	// find_many的实现，key_at(i)是第i个key，对[begin, count)里的每个i调用callback(i, it)
+	template <class KeyAt, class F>
+	void find_group(size_t begin, size_t count, KeyAt&& key_at, F&& callback) {
+		rbtree_node_ptr nodes[FIND_GROUP];
+		size_t indexes[FIND_GROUP];
+		size_t active = 0;
+		size_t next = begin;
+		for (; active < FIND_GROUP && next < count; active++) {
+			indexes[active] = next++;
+			nodes[active] = root_;
+		}
+
+		while (active > 0) {
+			for (size_t g = 0; g < active;) {
+				auto n = nodes[g];
+				int64_t cmp = 0;
+				if (n != shm_nullptr && (cmp = compare(key_at(indexes[g]), n)) != 0) {
+					nodes[g] = cmp < 0 ? n->left_child : n->right_child;
+					rbtree_prefetch(nodes[g]);
+					g++;
+					continue;
+				}
+
+				// 这个key找完了，位置让给下一个key，没有了就把最后一个挪过来
+				callback(indexes[g], iterator(n));
+				if (next < count) {
+					indexes[g] = next++;
+					nodes[g] = root_;
+					g++;
+				} else {
+					--active;
+					indexes[g] = indexes[active];
+					nodes[g] = nodes[active];
+				}
+			}
+		}
+	}
+
 	rbtree_node_ptr root_;
 	size_t size_;
-	static int64_t compare(const Key& k, rbtree_node_ptr node) {
-		return smd::compare(k, key(node));
+	// 通过ADL查找compare，在shm_map.h之后才定义的key类型（比如ZSetKey）也可以提供自己的重载
+	template <class K>
+	static int64_t compare(const K& k, rbtree_node_ptr node) {
+		using smd::compare;
+		return compare(k, key(node));
+	}
+
+	template <class K>
+	size_t erase_key(const K& k) {
+		auto node = rbtree_lookup_key(k);
+		if (node == shm_nullptr)
+			return 0;
+
+		rbtree_remove(node);
+		return 1;
 	}
 
 protected:
@@ -280,8 +573,66 @@ protected:
 		return sibling(node->parent);
 	}
 
-	rbtree_node_ptr createNode(const value_type& val) {
-		return g_alloc->New<RBTreeNode<value_type>>(val);
+	// 把新节点挂到树上，key已经存在时销毁节点，返回空指针
+	rbtree_node_ptr insert_node(rbtree_node_ptr node) {
+		int64_t cmp = 0;
+		auto n = rbtree_search(key(node), shm_nullptr, cmp);
+		if (n != shm_nullptr && cmp == 0) {
+			//节点重复，插入失败
+			deleteNode(node);
+			return shm_nullptr;
+		}
+		return link_node(n, cmp, node);
+	}
+
+	template <class K, typename... P>
+	std::pair<rbtree_node_ptr, bool> try_emplace_key(rbtree_node_ptr hint, K&& k, P&&... args) {
+		int64_t cmp = 0;
+		auto n = rbtree_search(k, hint, cmp);
+		if (n != shm_nullptr && cmp == 0)
+			return std::make_pair(n, false);
+
+		auto node = createNode(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(k)),
+			std::forward_as_tuple(std::forward<P>(args)...));
+		return std::make_pair(link_node(n, cmp, node), true);
+	}
+
+	// 把新节点挂到rbtree_search返回的父节点n下面，cmp是新key和n比较的结果
+	rbtree_node_ptr link_node(rbtree_node_ptr n, int64_t cmp, rbtree_node_ptr node) {
+		if (n != shm_nullptr) {
+			if (cmp < 0) {
+				n->left_child = node;
+			} else {
+				n->right_child = node;
+			}
+		}
+
+		node->parent = n;
+		node->left_child = shm_nullptr;
+		node->right_child = shm_nullptr;
+		node->color = RBTREE_NODE_RED;
+
+		if (n == shm_nullptr) {
+			root_ = node;
+		}
+
+		if constexpr (OrderStatistic) {
+			node->count = 1;
+			for (; n != shm_nullptr; n = n->parent) {
+				++n->count;
+			}
+		}
+
+		repair_after_insert(node);
+
+		++size_;
+		return node;
+	}
+
+	template <typename... P>
+	rbtree_node_ptr createNode(P&&... params) {
+		Alloc* alloc = AllocOf(this);
+		return alloc->New<node_type>(std::forward<P>(params)...);
 	}
 
 	void deleteNode(rbtree_node_ptr& p) {
@@ -312,6 +663,18 @@ protected:
 		}
 	}
 
+	static size_t subtree_count(rbtree_node_ptr x) {
+		return x != shm_nullptr ? x->count : 0;
+	}
+
+	// 旋转之后n接替了node原来的子树，大小不变；node的子树要重新算
+	static void rotate_count(rbtree_node_ptr node, rbtree_node_ptr n) {
+		if constexpr (OrderStatistic) {
+			n->count = node->count;
+			node->count = 1 + subtree_count(node->left_child) + subtree_count(node->right_child);
+		}
+	}
+
 	void rotate_left(rbtree_node_ptr node) {
 		assert(node != shm_nullptr);
 
@@ -327,6 +690,8 @@ protected:
 
 		n->left_child = node;
 		node->parent = n;
+
+		rotate_count(node, n);
 	}
 
 	void rotate_right(rbtree_node_ptr node) {
@@ -344,6 +709,8 @@ protected:
 
 		n->right_child = node;
 		node->parent = n;
+
+		rotate_count(node, n);
 	}
 
 	void repair_after_insert(rbtree_node_ptr node) {
@@ -470,7 +837,8 @@ protected:
 		}
 	}
 
-	rbtree_node_ptr rbtree_lookup_key(const Key& key) {
+	template <class K>
+	rbtree_node_ptr rbtree_lookup_key(const K& key) const {
 		auto n = root_;
 		while (n != shm_nullptr) {
 			auto cmp = compare(key, n);
@@ -487,12 +855,174 @@ protected:
 		return n;
 	}
 
+	template <class K>
+	rbtree_node_ptr rbtree_lookup_key(const K& key, rbtree_node_ptr hint) const {
+		int64_t cmp = 0;
+		auto n = rbtree_search(key, hint, cmp);
+		return cmp == 0 ? n : shm_nullptr;
+	}
+
+	//
+	// 查找key：找到时返回所在的节点，cmp为0；找不到时返回新节点应该挂在下面的父节点，cmp是key和它比较的结果
+	// hint不为空时先看key是否落在hint和它的后继之间，是的话不用从根开始找；否则照常从根往下找
+	// 只检查相邻的位置：离得远时从hint往上爬经过的节点多半不在缓存里，不如从根开始找
+	//
+	template <class K>
+	rbtree_node_ptr rbtree_search(const K& key, rbtree_node_ptr hint, int64_t& cmp) const {
+		if (hint != shm_nullptr && (cmp = compare(key, hint)) >= 0) {
+			if (cmp == 0)
+				return hint;
+
+			// hint没有右孩子时挂在hint的右边，否则挂在后继的左边（后继是右子树最左边的节点，没有左孩子）
+			auto next = rbtree_next<node_type>(hint);
+			if (next == shm_nullptr)
+				return hint;
+
+			auto next_cmp = compare(key, next);
+			if (next_cmp <= 0) {
+				if (next_cmp == 0 || hint->right_child != shm_nullptr) {
+					cmp = next_cmp;
+					return next;
+				}
+				return hint;
+			}
+		}
+
+		auto n = root_;
+		rbtree_node_ptr parent = shm_nullptr;
+		while (n != shm_nullptr) {
+			parent = n;
+			cmp = compare(key, n);
+			if (cmp < 0) {
+				n = n->left_child;
+			} else if (cmp > 0) {
+				n = n->right_child;
+			} else {
+				break;
+			}
+		}
+		return parent;
+	}
+
+	template <class K>
+	rbtree_node_ptr rbtree_lower_bound(const K& key) const {
+		rbtree_node_ptr res = shm_nullptr;
+		auto n = root_;
+		while (n != shm_nullptr) {
+			if (compare(key, n) <= 0) {
+				res = n;
+				n = n->left_child;
+			} else {
+				n = n->right_child;
+			}
+		}
+		return res;
+	}
+
+	template <class K>
+	rbtree_node_ptr rbtree_upper_bound(const K& key) const {
+		rbtree_node_ptr res = shm_nullptr;
+		auto n = root_;
+		while (n != shm_nullptr) {
+			if (compare(key, n) < 0) {
+				res = n;
+				n = n->left_child;
+			} else {
+				n = n->right_child;
+			}
+		}
+		return res;
+	}
+
+	template <class It, class K>
+	std::pair<It, It> equal_range_key(const K& key) const {
+		auto lower = rbtree_lower_bound(key);
+		if (lower != shm_nullptr && compare(key, lower) == 0)
+			return std::make_pair(It(lower), It(rbtree_next<node_type>(lower)));
+		return std::make_pair(It(lower), It(lower));
+	}
+
+	template <class K, class F>
+	size_t scan_key(const K& from, const K& to, size_t limit, F& callback) {
+		size_t visited = 0;
+		if (limit > 0) {
+			scan_node(root_, from, to, limit, visited, callback);
+		}
+		return visited;
+	}
+
+	// 中序遍历x的子树中落在区间内的部分，访问够limit个时返回false
+	template <class K, class F>
+	static bool scan_node(rbtree_node_ptr x, const K& from, const K& to, size_t limit, size_t& visited, F& callback) {
+		while (x != shm_nullptr) {
+			auto& v = value(x);
+			const bool after_from = compare(from, x) <= 0;
+			if (after_from && !scan_node(x->left_child, from, to, limit, visited, callback))
+				return false;
+
+			// 右子树只会更大
+			if (compare(to, x) <= 0)
+				return true;
+
+			if (after_from) {
+				callback(v.first, v.second);
+				if (++visited == limit)
+					return false;
+			}
+			x = x->right_child;
+		}
+		return true;
+	}
+
+	template <class K>
+	size_t rank_key(const K& key) const {
+		static_assert(OrderStatistic, "rank requires shm_map<Key, Value, true>");
+		size_t rank = 0;
+		auto n = root_;
+		while (n != shm_nullptr) {
+			if (compare(key, n) <= 0) {
+				n = n->left_child;
+			} else {
+				rank += subtree_count(n->left_child) + 1;
+				n = n->right_child;
+			}
+		}
+		return rank;
+	}
+
+	template <class K>
+	size_t count_range_key(const K& lo, const K& hi) const {
+		auto lo_rank = rank_key(lo);
+		auto hi_rank = rank_key(hi);
+		return hi_rank > lo_rank ? hi_rank - lo_rank : 0;
+	}
+
+	rbtree_node_ptr rbtree_select(size_t k) const {
+		static_assert(OrderStatistic, "select requires shm_map<Key, Value, true>");
+		auto n = root_;
+		while (n != shm_nullptr) {
+			auto left = subtree_count(n->left_child);
+			if (k < left) {
+				n = n->left_child;
+			} else if (k == left) {
+				break;
+			} else {
+				k -= left + 1;
+				n = n->right_child;
+			}
+		}
+		return n;
+	}
+
 	// 删除一个节点之后，返回下一个节点
 	rbtree_node_ptr rbtree_remove(rbtree_node_ptr node) {
 		if (node == shm_nullptr) {
 			return shm_nullptr;
 		}
 
+		// 有两个孩子时被换掉的是左子树中的前驱，后继节点不受影响
+		auto next = rbtree_next<node_type>(node);
+
 		// 如果待删除的节点有两个孩子需要转换成只有一个孩子，方法是找一个相邻的替换
 		if (node->left_child != shm_nullptr && node->right_child != shm_nullptr) {
 			auto k = node->left_child;
@@ -512,7 +1042,14 @@ protected:
 			std::swap(node, k);
 		}
 
-		// 现在node最多只会有一个孩子
+		// 现在node最多只会有一个孩子，先把它从祖先的计数里去掉，没有孩子时它在修复期间还挂在树上，按0个算
+		if constexpr (OrderStatistic) {
+			node->count = 0;
+			for (auto p = node->parent; p != shm_nullptr; p = p->parent) {
+				--p->count;
+			}
+		}
+
 		auto replacement = node->right_child != shm_nullptr ? node->right_child : node->left_child;
 
 		if (replacement != shm_nullptr) {
@@ -544,7 +1081,7 @@ protected:
 		// auto tmp = node.Ptr();
 		deleteNode(node);
 		--size_;
-		return replacement;
+		return next;
 	}
 
 	rbtree_node_ptr rbtree_first() const {
@@ -574,4 +1111,8 @@ protected:
 	}
 };
 
+// 排行榜用的有序map，可以按名次查询
+template <typename Key, typename Value>
+using shm_rank_map = shm_map<Key, Value, true>;
+
 } // namespace smd
@@ -1,114 +1,186 @@
 ﻿#pragma once
 #include <string>
+#include <string_view>
 #include <assert.h>
 
 #include <common/utility.h>
 #include <common/functional.h>
+#include <common/hash.h>
+#include <common/slice.h>
 #include <mem_alloc/alloc.h>
 #include <container/shm_pointer.h>
 
 namespace smd {
 
-class shm_string {
+//
+// 短字符串直接存放在对象内部（SSO），不需要分配共享内存，也不需要通过指针多跳一次
+// 长度不超过SSO_CAPACITY时使用内部的缓冲区，超过之后从字符串所在的字典分配，内部缓冲区的前16字节用来存放指针和容量
+// capacity是包括末尾0的缓冲区大小，size总是小于capacity
+// CacheHash为true时在对象里缓存哈希值（shm_hashed_string），多占8字节，适合很长、反复哈希的key
+//
+template <bool CacheHash>
+struct ShmStringHash {
+	static uint64_t fix_hash(uint64_t h) { return h; }
+	uint64_t get_hash(const char* buf, size_t size) const { return BytesHash::Hash(buf, size); }
+	void reset_hash() {}
+	void copy_hash(const ShmStringHash&) {}
+	void swap_hash(ShmStringHash&) {}
+};
+
+// 第一次用到时计算，0表示还没有计算过，内容修改时清零
+// 算出来正好是0的换成固定的非0值，否则每次都要重新计算；std::hash对其他类型的结果也做同样的替换
+template <>
+struct ShmStringHash<true> {
+	enum : uint64_t {
+		ZERO_HASH = 0x9e3779b97f4a7c15ULL,
+	};
+
+	static uint64_t fix_hash(uint64_t h) { return h != 0 ? h : uint64_t(ZERO_HASH); }
+
+	uint64_t get_hash(const char* buf, size_t size) const {
+		if (m_hash == 0) {
+			m_hash = fix_hash(BytesHash::Hash(buf, size));
+		}
+		return m_hash;
+	}
+	void reset_hash() { m_hash = 0; }
+	void copy_hash(const ShmStringHash& r) { m_hash = r.m_hash; }
+	void swap_hash(ShmStringHash& r) { std::swap(m_hash, r.m_hash); }
+
+	mutable uint64_t m_hash = 0;
+};
+
+template <bool CacheHash>
+class basic_shm_string : ShmStringHash<CacheHash> {
 public:
-	shm_string(size_t size = 0) {
-		resize(GetSuitableCapacity(size + 1));
+	enum : size_t {
+		SSO_CAPACITY = 23,
+	};
+
+	// size是预留的长度
+	basic_shm_string(size_t size = 0) {
+		init(size + 1);
 	}
 
-	shm_string(const std::string& r) {
-		resize(GetSuitableCapacity(r.size() + 1));
+	basic_shm_string(const std::string& r) {
+		init(r.size() + 1);
 		internal_copy(r.data(), r.size());
 	}
 
-	shm_string(const shm_string& r) {
-		resize(GetSuitableCapacity(r.size() + 1));
+	basic_shm_string(const basic_shm_string& r) {
+		init(r.size() + 1);
 		internal_copy(r.data(), r.size());
+		this->copy_hash(r);
 	}
 
-	shm_string(const char* buf, size_t size) {
-		resize(GetSuitableCapacity(size + 1));
+	basic_shm_string(const char* buf, size_t size) {
+		init(size + 1);
 		internal_copy(buf, size);
 	}
 
-	shm_string& operator=(const std::string& r) {
-		shm_string(r).swap(*this);
+	// 容器用Slice查找之后插入时，直接用Slice构造key
+	explicit basic_shm_string(const Slice& s) {
+		init(s.size() + 1);
+		internal_copy(s.data(), s.size());
+	}
+
+	// 有了Slice的构造函数之后，字符串常量需要单独的重载，否则会有二义性
+	explicit basic_shm_string(const char* s)
+		: basic_shm_string(Slice(s)) {}
+
+	// 接管r的内容，r变成空字符串
+	basic_shm_string(basic_shm_string&& r) noexcept {
+		init(0);
+		swap(r);
+	}
+
+	basic_shm_string& operator=(const std::string& r) {
+		basic_shm_string(r).swap(*this);
+		return *this;
+	}
+
+	basic_shm_string& operator=(const basic_shm_string& r) {
+		if (this != &r) {
+			basic_shm_string(r).swap(*this);
+		}
 		return *this;
 	}
 
-	shm_string& operator=(const shm_string& r) {
+	basic_shm_string& operator=(basic_shm_string&& r) noexcept {
 		if (this != &r) {
-			shm_string(r).swap(*this);
+			basic_shm_string(std::move(r)).swap(*this);
 		}
 		return *this;
 	}
 
-	~shm_string() {
-		resize(0);
+	~basic_shm_string() {
+		release();
 		m_size = 0;
 	}
 
-	char* data() { return m_ptr.Ptr(); }
-	const char* data() const { return m_ptr.Ptr(); }
+	// 通过返回的指针修改内容时，缓存的哈希值会失效
+	char* data() {
+		this->reset_hash();
+		return buffer();
+	}
+	const char* data() const { return const_cast<basic_shm_string*>(this)->buffer(); }
 	size_t size() const { return m_size; }
-	bool empty() { return m_size > 0; }
-	size_t capacity() const { return m_capacity; }
+	bool empty() const { return m_size == 0; }
+	size_t capacity() const { return m_is_heap ? m_heap.capacity : SSO_CAPACITY + 1; }
 
-	shm_string& assign(const std::string& r) {
-		if (r.size() < m_capacity) {
-			internal_copy(r.data(), r.size());
-			shrink_to_fit();
-		} else {
-			resize(GetSuitableCapacity(r.size() + 1));
-			internal_copy(r.data(), r.size());
-		}
+	// 字符串放在对象内部，没有分配共享内存
+	bool is_inline() const { return !m_is_heap; }
 
-		return *this;
+	basic_shm_string& assign(const std::string& r) {
+		return assign(r.data(), r.size());
 	}
 
-	shm_string& append(const shm_string& str) {
-		if (capacity() <= size() + str.size()) {
-			resize(GetSuitableCapacity(size() + str.size() + 1));
+	// 容量够用时直接覆盖，不重新分配
+	basic_shm_string& assign(const char* buf, size_t size) {
+		if (size < capacity()) {
+			internal_copy(buf, size);
+			shrink_to_fit();
+		} else {
+			release();
+			init(size + 1);
+			internal_copy(buf, size);
 		}
 
-		internal_append(str.data(), str.size());
 		return *this;
 	}
 
-	shm_string& append(const std::string& str) {
-		if (capacity() <= size() + str.size()) {
-			resize(GetSuitableCapacity(size() + str.size() + 1));
-		}
-
-		internal_append(str.data(), str.size());
-		return *this;
+	basic_shm_string& append(const basic_shm_string& str) {
+		return append(str.data(), str.size());
 	}
 
-	shm_string& append(const char* s) {
-		size_t len = strlen(s);
-		if (capacity() <= size() + len) {
-			resize(GetSuitableCapacity(size() + len + 1));
-		}
+	basic_shm_string& append(const std::string& str) {
+		return append(str.data(), str.size());
+	}
 
-		internal_append(s, len);
-		return *this;
+	basic_shm_string& append(const char* s) {
+		return append(s, strlen(s));
 	}
 
-	shm_string& append(const char* s, size_t n) {
+	basic_shm_string& append(const char* s, size_t n) {
 		if (capacity() <= size() + n) {
-			resize(GetSuitableCapacity(size() + n + 1));
+			grow(size() + n + 1);
 		}
 
 		internal_append(s, n);
 		return *this;
 	}
 
-	int compare(const shm_string& b) const {
-		const size_t min_len = (size() < b.size()) ? size() : b.size();
-		int r = memcmp(data(), b.data(), min_len);
+	int compare(const basic_shm_string& b) const {
+		return compare(b.data(), b.size());
+	}
+
+	int compare(const char* buf, size_t len) const {
+		const size_t min_len = (size() < len) ? size() : len;
+		int r = memcmp(data(), buf, min_len);
 		if (r == 0) {
-			if (size() < b.size())
+			if (size() < len)
 				r = -1;
-			else if (size() > b.size())
+			else if (size() > len)
 				r = +1;
 		}
 		return r;
@@ -116,12 +188,17 @@ public:
 
 	void clear() {
 		m_size = 0;
+		this->reset_hash();
+		buffer()[0] = '\0';
 		shrink_to_fit();
 	}
 
 	std::string ToString() const { return std::string(data(), size()); }
 
-	bool operator==(const shm_string& rhs) const {
+	// shm_hashed_string缓存计算结果，扩容、重复查找都不用重新计算长key的哈希
+	uint64_t hash() const { return this->get_hash(data(), size()); }
+
+	bool operator==(const basic_shm_string& rhs) const {
 		auto p1 = data();
 		auto p2 = rhs.data();
 		return ((size() == rhs.size()) && (memcmp(p1, p2, size()) == 0));
@@ -143,30 +220,63 @@ public:
 
 private:
 	static size_t GetSuitableCapacity(size_t size) {
-		if (size <= 16)
-			return 16;
-		else
-			return util::Utility::NextPowOf2(uint32_t(size));
+		return util::Utility::NextPowOf2(uint64_t(size));
 	}
 
-	void swap(shm_string& x) {
-		std::swap(m_ptr, x.m_ptr);
-		std::swap(m_capacity, x.m_capacity);
-		std::swap(m_size, x.m_size);
+	void swap(basic_shm_string& x) {
+		char tmp[sizeof(m_local)];
+		memcpy(tmp, m_local, sizeof(m_local));
+		memcpy(m_local, x.m_local, sizeof(m_local));
+		memcpy(x.m_local, tmp, sizeof(m_local));
+
+		const size_t size = m_size;
+		const size_t is_heap = m_is_heap;
+		m_size = x.m_size;
+		m_is_heap = x.m_is_heap;
+		x.m_size = size;
+		x.m_is_heap = is_heap;
+		this->swap_hash(x);
 	}
 
-	void resize(size_t capacity) {
-		if (m_ptr != shm_nullptr) {
-			g_alloc->Free(m_ptr, m_capacity);
-			m_capacity = 0;
+	char* buffer() {
+		return m_is_heap ? m_heap.ptr.Ptr() : m_local;
+	}
+
+	// 空字符串，缓冲区至少能放下capacity个字节
+	void init(size_t capacity) {
+		m_size = 0;
+		this->reset_hash();
+		if (capacity <= SSO_CAPACITY + 1) {
+			m_is_heap = 0;
+			m_local[0] = '\0';
+		} else {
+			m_is_heap = 1;
+			m_heap.capacity = GetSuitableCapacity(capacity);
+			Alloc* alloc = AllocOf(this);
+			m_heap.ptr = alloc->Malloc<char>(m_heap.capacity);
+			m_heap.ptr.Ptr()[0] = '\0';
 		}
+	}
 
-		if (capacity > 0) {
-			m_capacity = capacity;
-			m_ptr = g_alloc->Malloc<char>(m_capacity);
+	void release() {
+		if (m_is_heap) {
+			g_alloc->Free(m_heap.ptr, m_heap.capacity);
+			m_is_heap = 0;
 		}
 	}
 
+	// 扩容，保留原来的内容
+	void grow(size_t capacity) {
+		const size_t new_capacity = GetSuitableCapacity(capacity);
+		Alloc* alloc = AllocOf(this);
+		auto ptr = alloc->Malloc<char>(new_capacity);
+		memcpy(ptr.Ptr(), buffer(), m_size + 1);
+		release();
+		m_is_heap = 1;
+		m_heap.ptr = ptr;
+		m_heap.capacity = new_capacity;
+	}
+
 	void internal_copy(const char* buf, size_t len) {
 		m_size = 0;
 		internal_append(buf, len);
@@ -174,42 +284,126 @@ private:
 
 	void internal_append(const char* buf, size_t len) {
 		// 最后有一个0
-		assert(m_capacity > m_size + len);
-		char* ptr = m_ptr.Ptr();
+		assert(capacity() > m_size + len);
+		char* ptr = buffer();
 		memcpy(&ptr[m_size], buf, len);
-		ptr[len] = '\0';
-		m_size = len;
+		m_size += len;
+		ptr[m_size] = '\0';
+		this->reset_hash();
 	}
 
+	// 长度变短之后能放进内部缓冲区时，释放分配的内存
 	void shrink_to_fit() {
-		// 在此添加代码缩容
+		if (m_is_heap && m_size <= SSO_CAPACITY) {
+			auto ptr = m_heap.ptr;
+			auto capacity = m_heap.capacity;
+			m_is_heap = 0;
+			memcpy(m_local, ptr.Ptr(), m_size + 1);
+			g_alloc->Free(ptr, capacity);
+		}
 	}
 
 private:
-	shm_pointer<char> m_ptr = shm_nullptr;
-	size_t m_capacity = 0;
-	size_t m_size = 0;
+	union {
+		struct {
+			shm_pointer<char> ptr;
+			size_t capacity;
+		} m_heap;
+		char m_local[SSO_CAPACITY + 1];
+	};
+	size_t m_size : 63;
+	size_t m_is_heap : 1;
 };
 
-inline bool operator!=(const shm_string& x, const shm_string& y) { return !(x == y); }
-inline bool operator<(const shm_string& x, const shm_string& y) { return x.compare(y) < 0; }
-inline bool operator>(const shm_string& x, const shm_string& y) { return x.compare(y) > 0; }
+typedef basic_shm_string<false> shm_string;
+typedef basic_shm_string<true> shm_hashed_string;
 
-template <>
-int64_t compare(const shm_string& x, const shm_string& y) {
+template <bool C>
+inline bool operator!=(const basic_shm_string<C>& x, const basic_shm_string<C>& y) { return !(x == y); }
+template <bool C>
+inline bool operator<(const basic_shm_string<C>& x, const basic_shm_string<C>& y) { return x.compare(y) < 0; }
+template <bool C>
+inline bool operator>(const basic_shm_string<C>& x, const basic_shm_string<C>& y) { return x.compare(y) > 0; }
+
+template <bool C>
+inline int64_t compare(const basic_shm_string<C>& x, const basic_shm_string<C>& y) {
 	return x.compare(y);
 }
 
+//
+// 用Slice、std::string、std::string_view、const char*直接和shm_string比较，不需要构造临时的shm_string
+// std::string可以隐式转换成shm_string，需要单独的重载，否则会有二义性
+//
+template <bool C>
+inline bool operator==(const basic_shm_string<C>& x, const Slice& y) {
+	return x.size() == y.size() && memcmp(x.data(), y.data(), y.size()) == 0;
+}
+template <bool C>
+inline bool operator==(const Slice& x, const basic_shm_string<C>& y) { return y == x; }
+template <bool C>
+inline bool operator!=(const basic_shm_string<C>& x, const Slice& y) { return !(x == y); }
+template <bool C>
+inline bool operator!=(const Slice& x, const basic_shm_string<C>& y) { return !(y == x); }
+template <bool C>
+inline bool operator==(const basic_shm_string<C>& x, const std::string& y) { return x == Slice(y); }
+template <bool C>
+inline bool operator==(const std::string& x, const basic_shm_string<C>& y) { return y == Slice(x); }
+template <bool C>
+inline bool operator!=(const basic_shm_string<C>& x, const std::string& y) { return !(x == Slice(y)); }
+template <bool C>
+inline bool operator!=(const std::string& x, const basic_shm_string<C>& y) { return !(y == Slice(x)); }
+template <bool C>
+inline bool operator==(const basic_shm_string<C>& x, const char* y) { return x == Slice(y); }
+template <bool C>
+inline bool operator==(const char* x, const basic_shm_string<C>& y) { return y == Slice(x); }
+template <bool C>
+inline bool operator!=(const basic_shm_string<C>& x, const char* y) { return !(x == Slice(y)); }
+template <bool C>
+inline bool operator!=(const char* x, const basic_shm_string<C>& y) { return !(y == Slice(x)); }
+
+template <bool C>
+inline int64_t compare(const Slice& x, const basic_shm_string<C>& y) {
+	return -int64_t(y.compare(x.data(), x.size()));
+}
+
+template <bool C>
+struct is_transparent_key<basic_shm_string<C>, Slice> : std::true_type {};
+template <bool C>
+struct is_transparent_key<basic_shm_string<C>, std::string> : std::true_type {};
+template <bool C>
+struct is_transparent_key<basic_shm_string<C>, std::string_view> : std::true_type {};
+template <bool C>
+struct is_transparent_key<basic_shm_string<C>, const char*> : std::true_type {};
+template <bool C>
+struct is_transparent_key<basic_shm_string<C>, char*> : std::true_type {};
+
 } // namespace smd
 
 namespace std {
-template <>
-struct hash<smd::shm_string> {
-	typedef smd::shm_string argument_type;
+template <bool C>
+struct hash<smd::basic_shm_string<C>> {
+	typedef smd::basic_shm_string<C> argument_type;
 	typedef std::size_t result_type;
 
+	// shm_hashed_string使用缓存的哈希值，其他类型直接对数据计算，同样内容的结果一致
 	result_type operator()(argument_type const& s) const {
-		return std::hash<std::string>()(s.ToString());
+		return s.hash();
+	}
+
+	result_type operator()(const smd::Slice& s) const {
+		return smd::ShmStringHash<C>::fix_hash(smd::BytesHash::Hash(s.data(), s.size()));
+	}
+
+	result_type operator()(const std::string& s) const {
+		return smd::ShmStringHash<C>::fix_hash(smd::BytesHash::Hash(s.data(), s.size()));
+	}
+
+	result_type operator()(std::string_view s) const {
+		return smd::ShmStringHash<C>::fix_hash(smd::BytesHash::Hash(s.data(), s.size()));
+	}
+
+	result_type operator()(const char* s) const {
+		return smd::ShmStringHash<C>::fix_hash(smd::BytesHash::Hash(s, strlen(s)));
 	}
 };
 
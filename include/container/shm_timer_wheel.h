@@ -0,0 +1,201 @@
+﻿#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+#include <container/shm_list.h>
+
+namespace smd {
+
+// slot是节点所在的槽（level * SLOT_COUNT + index），链表节点不指向链表，删除和移动时靠它找到槽
+template <class T>
+struct TimerWheelEntry {
+	int64_t deadline;
+	int32_t slot;
+	T value;
+
+	template <typename... P>
+	TimerWheelEntry(int64_t d, P&&... params)
+		: deadline(d)
+		, slot(-1)
+		, value(std::forward<P>(params)...) {}
+};
+
+//
+// 分层时间轮：LEVEL_COUNT层，每层SLOT_COUNT个槽，每个槽是一个链表，时间单位由调用者决定（SmdEnv用毫秒）
+// 第l层的一个槽覆盖SLOT_COUNT^l个时间单位，离到期越远放得越高，走到槽的边界时整槽降到下一层（cascade）
+// 节点在层之间移动只改链接，不分配也不复制；加入和每个元素的到期处理都是O(1)
+// 超出最高层范围的元素先放在最高层，降层时重新计算位置
+// add返回元素所在的节点，到期之前可以用它O(1)地删除（remove）或者改到期时间（update）
+// 所有状态都在共享内存里，热重启之后advance会把停机期间的时间补走
+//
+template <class T>
+class shm_timer_wheel {
+public:
+	typedef TimerWheelEntry<T> entry_type;
+	typedef shm_list<entry_type> slot_type;
+	typedef typename slot_type::nodePtr node_ptr;
+
+	enum : int64_t {
+		LEVEL_BITS = 6,
+		SLOT_COUNT = 1 << LEVEL_BITS,
+		SLOT_MASK = SLOT_COUNT - 1,
+		LEVEL_COUNT = 6,
+		MAX_DELTA = (int64_t(1) << (LEVEL_BITS * LEVEL_COUNT)) - 1,
+	};
+
+	shm_timer_wheel()
+		: m_current(0)
+		, m_size(0)
+		, m_level_size() {}
+
+	shm_timer_wheel(const shm_timer_wheel&) = delete;
+	shm_timer_wheel& operator=(const shm_timer_wheel&) = delete;
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	// 下一个要处理的时刻，它之前的都已经处理过了
+	int64_t current() const {
+		return m_current;
+	}
+
+	// 在deadline到期，now是当前时间；已经过期的在下一次advance时处理
+	// 节点直接在目标槽里构造，和时间轮在同一个环境
+	template <typename... P>
+	node_ptr add(int64_t now, int64_t deadline, P&&... params) {
+		// 空的时候重新对齐到当前时间，之前用超前的时间advance过也不影响
+		if (m_size == 0) {
+			m_current = now;
+		}
+
+		const int32_t slot = locate(deadline);
+		auto& list = m_slots[slot / SLOT_COUNT][slot % SLOT_COUNT];
+		auto node = list.emplace(list.begin(), deadline, std::forward<P>(params)...).p;
+		node->data.slot = slot;
+		++m_level_size[slot / SLOT_COUNT];
+		++m_size;
+		return node;
+	}
+
+	// 删除还没有到期的节点
+	void remove(node_ptr node) {
+		const int32_t slot = node->data.slot;
+		m_slots[slot / SLOT_COUNT][slot % SLOT_COUNT].erase(typename slot_type::iterator(node));
+		--m_level_size[slot / SLOT_COUNT];
+		--m_size;
+	}
+
+	// 修改还没有到期的节点的到期时间，节点挪到新的槽，不重新分配
+	void update(node_ptr node, int64_t deadline) {
+		const int32_t slot = node->data.slot;
+		auto& list = m_slots[slot / SLOT_COUNT][slot % SLOT_COUNT];
+		--m_level_size[slot / SLOT_COUNT];
+		node->data.deadline = deadline;
+		place(list, typename slot_type::iterator(node));
+	}
+
+	//
+	// 处理到now为止（包含now）到期的所有元素，callback的参数是(int64_t deadline, T& value)，返回处理的个数
+	// callback里可以再add，新加入的元素最早在下一个时刻处理；正在处理的节点不能remove或者update
+	//
+	template <class F>
+	size_t advance(int64_t now, F&& callback) {
+		size_t fired = 0;
+		while (m_current <= now) {
+			// 空的时间轮直接跳过
+			if (m_size == 0) {
+				m_current = now + 1;
+				break;
+			}
+
+			// 低层都是空的时候，到下一次需要降层的边界之前什么也不用做，停机很久之后补时间主要靠这里
+			int lowest = 0;
+			while (lowest < LEVEL_COUNT - 1 && m_level_size[lowest] == 0) {
+				lowest++;
+			}
+			if (lowest > 0) {
+				const int64_t span = int64_t(1) << (LEVEL_BITS * lowest);
+				const int64_t boundary = (m_current + span - 1) & ~(span - 1);
+				if (boundary > m_current) {
+					m_current = std::min(boundary, now + 1);
+					continue;
+				}
+			}
+
+			const int64_t tick = m_current;
+			for (int level = 1; level < LEVEL_COUNT && (tick & ((int64_t(1) << (LEVEL_BITS * level)) - 1)) == 0;
+				 level++) {
+				cascade(level, (tick >> (LEVEL_BITS * level)) & SLOT_MASK);
+			}
+
+			m_current = tick + 1;
+			auto& slot = m_slots[0][tick & SLOT_MASK];
+			while (!slot.empty()) {
+				auto& entry = slot.front();
+				callback(entry.deadline, entry.value);
+				slot.pop_front();
+				--m_level_size[0];
+				--m_size;
+				++fired;
+			}
+		}
+		return fired;
+	}
+
+	void clear() {
+		for (auto& level : m_slots) {
+			for (auto& slot : level) {
+				slot.clear();
+			}
+		}
+		for (auto& n : m_level_size) {
+			n = 0;
+		}
+		m_size = 0;
+	}
+
+private:
+	// 按到期时间计算所在的槽
+	int32_t locate(int64_t deadline) const {
+		deadline = std::max(deadline, m_current);
+		const int64_t delta = std::min(deadline - m_current, int64_t(MAX_DELTA));
+		const int64_t expire = m_current + delta;
+
+		int level = 0;
+		while (level < LEVEL_COUNT - 1 && (delta >> (LEVEL_BITS * (level + 1))) != 0) {
+			level++;
+		}
+		return int32_t(level * SLOT_COUNT + ((expire >> (LEVEL_BITS * level)) & SLOT_MASK));
+	}
+
+	// 把src中it指向的节点按它的到期时间挂到对应的槽上
+	void place(slot_type& src, typename slot_type::iterator it) {
+		const int32_t slot = locate(it->deadline);
+		auto& dst = m_slots[slot / SLOT_COUNT][slot % SLOT_COUNT];
+		dst.splice(dst.begin(), src, it);
+		it->slot = slot;
+		++m_level_size[slot / SLOT_COUNT];
+	}
+
+	// 整槽降层，节点按自己的到期时间重新放置
+	void cascade(int level, int64_t index) {
+		auto& slot = m_slots[level][index];
+		while (!slot.empty()) {
+			place(slot, slot.begin());
+			--m_level_size[level];
+		}
+	}
+
+private:
+	int64_t m_current;
+	size_t m_size;
+	size_t m_level_size[LEVEL_COUNT];
+	slot_type m_slots[LEVEL_COUNT][SLOT_COUNT];
+};
+
+} // namespace smd
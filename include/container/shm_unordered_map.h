@@ -0,0 +1,458 @@
+﻿#pragma once
+#include <new>
+#include <type_traits>
+#include <tuple>
+#include <utility>
+#include <functional>
+#include <common/functional.h>
+#include <mem_alloc/alloc.h>
+#include <container/shm_pointer.h>
+
+namespace smd {
+
+//
+// 哈希表的节点：key和value放在一起，同时缓存哈希值，扩容时不需要重新计算，查找时先比较哈希值再比较key
+//
+template <class Value>
+struct UnorderedMapNode {
+	shm_pointer<UnorderedMapNode> next;
+	uint64_t hash;
+	Value value;
+
+	template <typename... P>
+	UnorderedMapNode(uint64_t h, P&&... params)
+		: next(shm_nullptr)
+		, hash(h)
+		, value(std::forward<P>(params)...) {}
+};
+
+template <class Value, typename Pointer, typename Reference>
+class UnorderedMapIterator {
+public:
+	typedef UnorderedMapIterator<Value, Pointer, Reference> this_type;
+	typedef shm_pointer<UnorderedMapNode<Value>> node_ptr;
+
+	UnorderedMapIterator()
+		: m_node(shm_nullptr)
+		, m_index(0)
+		, m_buckets(shm_nullptr)
+		, m_bucket_count(0) {}
+
+	UnorderedMapIterator(node_ptr node, size_t index, shm_pointer<node_ptr> buckets, size_t bucket_count)
+		: m_node(node)
+		, m_index(index)
+		, m_buckets(buckets)
+		, m_bucket_count(bucket_count) {}
+
+	// iterator可以转换成const_iterator
+	template <typename P, typename R>
+	UnorderedMapIterator(const UnorderedMapIterator<Value, P, R>& r)
+		: m_node(r.m_node)
+		, m_index(r.m_index)
+		, m_buckets(r.m_buckets)
+		, m_bucket_count(r.m_bucket_count) {}
+
+	Reference operator*() const {
+		return m_node->value;
+	}
+
+	Pointer operator->() const {
+		return &(m_node->value);
+	}
+
+	this_type& operator++() {
+		m_node = m_node->next;
+		if (m_node == shm_nullptr) {
+			// 跳到下一个非空的桶
+			while (++m_index < m_bucket_count) {
+				m_node = m_buckets[m_index];
+				if (m_node != shm_nullptr)
+					break;
+			}
+		}
+		return *this;
+	}
+
+	this_type operator++(int) {
+		this_type tmp(*this);
+		++*this;
+		return tmp;
+	}
+
+	bool operator==(const this_type& x) const {
+		return m_node == x.m_node;
+	}
+
+	bool operator!=(const this_type& x) const {
+		return m_node != x.m_node;
+	}
+
+public:
+	node_ptr m_node;
+	size_t m_index;
+	shm_pointer<node_ptr> m_buckets;
+	size_t m_bucket_count;
+};
+
+//
+// 链地址法的哈希表：桶数组里只存放单链表的头指针，每个元素一个节点
+// 节点分配之后不会移动，元素的引用在插入其他元素、扩容之后依然有效，可以直接替换shm_map<Key, Value>
+// 桶数是2的幂，超过最大装填因子时桶数翻倍，扩容只是把节点重新挂到新的桶上，不会分配和复制节点
+//
+template <class Key, class Value, class Hash = std::hash<Key>>
+class shm_unordered_map {
+public:
+	typedef shm_unordered_map<Key, Value, Hash> this_type;
+	typedef Key key_type;
+	typedef Value mapped_type;
+	typedef std::pair<Key, Value> value_type;
+	typedef size_t size_type;
+	typedef UnorderedMapNode<value_type> node_type;
+	typedef shm_pointer<node_type> node_ptr;
+	typedef UnorderedMapIterator<value_type, value_type*, value_type&> iterator;
+	typedef UnorderedMapIterator<value_type, const value_type*, const value_type&> const_iterator;
+
+	enum : size_t {
+		MIN_BUCKET_COUNT = 16,
+	};
+
+	explicit shm_unordered_map(size_t bucket_count = 0) {
+		if (bucket_count > 0)
+			rehash(bucket_count);
+	}
+
+	shm_unordered_map(const this_type& r)
+		: m_max_load_factor(r.m_max_load_factor) {
+		reserve(r.size());
+		for (auto it = r.begin(); it != r.end(); ++it) {
+			insert(*it);
+		}
+	}
+
+	// 接管r的桶数组和节点，r变成没有分配的空表
+	shm_unordered_map(this_type&& r) noexcept {
+		swap(r);
+	}
+
+	this_type& operator=(const this_type& r) {
+		if (this != &r) {
+			this_type(r).swap(*this);
+		}
+		return *this;
+	}
+
+	this_type& operator=(this_type&& r) noexcept {
+		if (this != &r) {
+			this_type(std::move(r)).swap(*this);
+		}
+		return *this;
+	}
+
+	~shm_unordered_map() {
+		clear();
+		if (m_buckets != shm_nullptr) {
+			g_alloc->Free(m_buckets, m_bucket_count);
+		}
+		m_bucket_count = 0;
+	}
+
+	void swap(this_type& r) {
+		std::swap(m_buckets, r.m_buckets);
+		std::swap(m_bucket_count, r.m_bucket_count);
+		std::swap(m_size, r.m_size);
+		std::swap(m_max_load_factor, r.m_max_load_factor);
+	}
+
+	iterator begin() {
+		return first_node();
+	}
+
+	const_iterator begin() const {
+		return const_cast<this_type*>(this)->first_node();
+	}
+
+	iterator end() {
+		return iterator();
+	}
+
+	const_iterator end() const {
+		return const_iterator();
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	size_type bucket_count() const {
+		return m_bucket_count;
+	}
+
+	float load_factor() const {
+		return m_bucket_count > 0 ? float(m_size) / float(m_bucket_count) : 0.0f;
+	}
+
+	float max_load_factor() const {
+		return m_max_load_factor;
+	}
+
+	void max_load_factor(float z) {
+		m_max_load_factor = z;
+	}
+
+	iterator find(const key_type& key) {
+		return find_key(key);
+	}
+
+	const_iterator find(const key_type& key) const {
+		return const_cast<this_type*>(this)->find_key(key);
+	}
+
+	// 用可以直接和Key比较的类型查找，比如shm_unordered_map<shm_string, ...>用Slice查找
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	iterator find(const K& key) {
+		return find_key(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	const_iterator find(const K& key) const {
+		return const_cast<this_type*>(this)->find_key(key);
+	}
+
+	size_type count(const key_type& key) const {
+		return find(key) == end() ? 0 : 1;
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_type count(const K& key) const {
+		return find(key) == end() ? 0 : 1;
+	}
+
+	bool contains(const key_type& key) const {
+		return find(key) != end();
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	bool contains(const K& key) const {
+		return find(key) != end();
+	}
+
+	Value& at(const key_type& key) {
+		auto it = find(key);
+		assert(it != end());
+		return it->second;
+	}
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		return try_emplace(value.first, value.second);
+	}
+
+	std::pair<iterator, bool> insert(value_type&& value) {
+		return try_emplace(std::move(value.first), std::move(value.second));
+	}
+
+	// 先构造出节点再查找，key已经存在时节点会被销毁，能用try_emplace的时候尽量用try_emplace
+	template <typename... P>
+	std::pair<iterator, bool> emplace(P&&... params) {
+		Alloc* alloc = AllocOf(this);
+		auto node = alloc->New<node_type>(0, std::forward<P>(params)...);
+		node->hash = hash_of(node->value.first);
+		auto it = find(node->value.first);
+		if (it != end()) {
+			g_alloc->Delete(node);
+			return std::make_pair(it, false);
+		}
+		return std::make_pair(link_node(node), true);
+	}
+
+	// key不存在时用args构造value，已经存在时什么也不做
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(const key_type& key, P&&... args) {
+		auto it = find(key);
+		if (it != end())
+			return std::make_pair(it, false);
+
+		Alloc* alloc = AllocOf(this);
+		auto node = alloc->New<node_type>(hash_of(key), std::piecewise_construct, std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<P>(args)...));
+		return std::make_pair(link_node(node), true);
+	}
+
+	template <typename... P>
+	std::pair<iterator, bool> try_emplace(key_type&& key, P&&... args) {
+		auto it = find(key);
+		if (it != end())
+			return std::make_pair(it, false);
+
+		auto hash = hash_of(key);
+		Alloc* alloc = AllocOf(this);
+		auto node = alloc->New<node_type>(hash, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+			std::forward_as_tuple(std::forward<P>(args)...));
+		return std::make_pair(link_node(node), true);
+	}
+
+	// 用Slice等类型查找，不存在时才在节点里构造Key
+	template <class K, typename... P, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	std::pair<iterator, bool> try_emplace(const K& key, P&&... args) {
+		auto it = find(key);
+		if (it != end())
+			return std::make_pair(it, false);
+
+		Alloc* alloc = AllocOf(this);
+		auto node = alloc->New<node_type>(hash_of(key), std::piecewise_construct, std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<P>(args)...));
+		return std::make_pair(link_node(node), true);
+	}
+
+	Value& operator[](const key_type& key) {
+		return try_emplace(key).first->second;
+	}
+
+	// 删除一个元素之后，返回下一个元素
+	iterator erase(const_iterator position) {
+		auto node = position.m_node;
+		auto index = position.m_index;
+		iterator next(node, index, m_buckets, m_bucket_count);
+		++next;
+
+		// 单链表，要从桶的头部找到前一个节点
+		if (m_buckets[index] == node) {
+			m_buckets[index] = node->next;
+		} else {
+			auto prev = m_buckets[index];
+			while (prev->next != node) {
+				prev = prev->next;
+			}
+			prev->next = node->next;
+		}
+
+		g_alloc->Delete(node);
+		--m_size;
+		return next;
+	}
+
+	size_type erase(const key_type& key) {
+		return erase_key(key);
+	}
+
+	template <class K, typename = std::enable_if_t<is_transparent_key_v<Key, K>>>
+	size_type erase(const K& key) {
+		return erase_key(key);
+	}
+
+	void clear() {
+		for (size_t i = 0; i < m_bucket_count; i++) {
+			auto node = m_buckets[i];
+			while (node != shm_nullptr) {
+				auto next = node->next;
+				g_alloc->Delete(node);
+				node = next;
+			}
+			m_buckets[i] = shm_nullptr;
+		}
+		m_size = 0;
+	}
+
+	// 桶数至少为n，只会扩大
+	void rehash(size_type n) {
+		n = util::Utility::NextPowOf2(uint64_t(std::max(n, size_t(MIN_BUCKET_COUNT))));
+		if (n <= m_bucket_count)
+			return;
+
+		Alloc* alloc = AllocOf(this);
+		auto buckets = alloc->Malloc<node_ptr>(n);
+		assert(buckets != shm_nullptr);
+		for (size_t i = 0; i < n; i++) {
+			buckets[i] = shm_nullptr;
+		}
+
+		// 节点按缓存的哈希值挂到新的桶上
+		for (size_t i = 0; i < m_bucket_count; i++) {
+			auto node = m_buckets[i];
+			while (node != shm_nullptr) {
+				auto next = node->next;
+				auto& head = buckets[node->hash & (n - 1)];
+				node->next = head;
+				head = node;
+				node = next;
+			}
+		}
+
+		if (m_buckets != shm_nullptr) {
+			g_alloc->Free(m_buckets, m_bucket_count);
+		}
+		m_buckets = buckets;
+		m_bucket_count = n;
+	}
+
+	// 保证能放下count个元素而不需要扩容
+	void reserve(size_type count) {
+		rehash(size_type(float(count) / m_max_load_factor) + 1);
+	}
+
+private:
+	template <class K>
+	static uint64_t hash_of(const K& key) {
+		return HashMix(uint64_t(Hash()(key)));
+	}
+
+	template <class K>
+	iterator find_key(const K& key) {
+		if (m_size == 0)
+			return end();
+
+		auto hash = hash_of(key);
+		auto index = bucket_index(hash);
+		for (auto node = m_buckets[index]; node != shm_nullptr; node = node->next) {
+			if (node->hash == hash && node->value.first == key)
+				return iterator(node, index, m_buckets, m_bucket_count);
+		}
+		return end();
+	}
+
+	template <class K>
+	size_type erase_key(const K& key) {
+		auto it = find_key(key);
+		if (it == end())
+			return 0;
+
+		erase(it);
+		return 1;
+	}
+
+	size_t bucket_index(uint64_t hash) const {
+		return size_t(hash & (m_bucket_count - 1));
+	}
+
+	iterator first_node() {
+		for (size_t i = 0; i < m_bucket_count; i++) {
+			if (m_buckets[i] != shm_nullptr)
+				return iterator(m_buckets[i], i, m_buckets, m_bucket_count);
+		}
+		return end();
+	}
+
+	// 把新节点挂到它的桶的头部，需要时先扩容
+	iterator link_node(node_ptr node) {
+		if (m_bucket_count == 0 || float(m_size + 1) > float(m_bucket_count) * m_max_load_factor) {
+			rehash(m_bucket_count * 2);
+		}
+
+		auto index = bucket_index(node->hash);
+		node->next = m_buckets[index];
+		m_buckets[index] = node;
+		++m_size;
+		return iterator(node, index, m_buckets, m_bucket_count);
+	}
+
+private:
+	shm_pointer<node_ptr> m_buckets = shm_nullptr;
+	size_t m_bucket_count = 0;
+	size_t m_size = 0;
+	float m_max_load_factor = 1.0f;
+};
+
+} // namespace smd
@@ -1,26 +1,46 @@
 ﻿#pragma once
+#include <new>
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
 #include <container/shm_pointer.h>
 
 namespace smd {
 
+//
+// 元素直接存放在一块连续的共享内存里，容量不够时按2倍扩展
+// 可以按位复制的类型在扩容、插入、删除时直接memcpy/memmove，其他类型逐个移动构造再析构旧的元素
+// 迭代器是当前进程里的裸指针，只在本次访问期间有效，扩容之后失效，不能存放在共享内存中
+//
 template <class T>
 class shm_vector {
+public:
 	typedef T value_type;
-	typedef shm_pointer<T> iterator;
 	typedef T& reference;
-	typedef iterator pointer;
+	typedef const T& const_reference;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+	typedef size_t size_type;
 
-public:
-	shm_vector(size_t capacity = 1) {
+	explicit shm_vector(size_t capacity = 0) {
 		reserve(capacity);
 	}
 
+	// 分配失败时是空的vector
 	shm_vector(const shm_vector& r) {
-		reserve(r.size());
+		if (!reserve(r.size()))
+			return;
+		T* dst = data();
 		for (size_t i = 0; i < r.size(); i++) {
-			const auto& element = r[i];
-			push_back(element);
+			::new (dst + i) T(r[i]);
 		}
+		m_size = r.size();
+	}
+
+	// 接管r的存储，不复制元素
+	shm_vector(shm_vector&& r) noexcept {
+		swap(r);
 	}
 
 	shm_vector& operator=(const shm_vector& r) {
@@ -30,136 +50,327 @@ public:
 		return *this;
 	}
 
-	~shm_vector() {
-		while (!empty()) {
-			pop_back();
+	shm_vector& operator=(shm_vector&& r) noexcept {
+		if (this != &r) {
+			shm_vector(std::move(r)).swap(*this);
 		}
+		return *this;
+	}
 
-		//实际分配的空间比容量大1.
-		g_alloc->Free(m_start, capacity() + 1);
-		m_finish = shm_nullptr;
-		m_end_of_storage = shm_nullptr;
+	~shm_vector() {
+		clear();
+		if (m_start != shm_nullptr) {
+			g_alloc->Free(m_start, m_capacity);
+		}
+		m_capacity = 0;
 	}
 
 	size_t size() const {
-		return m_finish - m_start;
+		return m_size;
 	}
 
-	bool empty() {
-		return m_finish == m_start;
+	bool empty() const {
+		return m_size == 0;
 	}
 
 	size_t capacity() const {
-		return m_end_of_storage - m_start;
+		return m_capacity;
 	}
 
 	//访问元素相关
+	T* data() {
+		return m_start != shm_nullptr ? m_start.Ptr() : nullptr;
+	}
+
+	const T* data() const {
+		return m_start != shm_nullptr ? m_start.Ptr() : nullptr;
+	}
+
 	reference operator[](size_t i) {
-		return *m_start[i];
+		assert(i < m_size);
+		return m_start.Ptr()[i];
 	}
 
-	reference operator[](size_t i) const {
-		return *m_start[i];
+	const_reference operator[](size_t i) const {
+		assert(i < m_size);
+		return m_start.Ptr()[i];
 	}
 
 	reference front() {
-		return **m_start;
+		return (*this)[0];
 	}
 
 	reference back() {
-		return *(m_start[size() - 1]);
+		return (*this)[m_size - 1];
+	}
+
+	iterator begin() {
+		return data();
+	}
+
+	iterator end() {
+		return data() + m_size;
+	}
+
+	const_iterator begin() const {
+		return data();
+	}
+
+	const_iterator end() const {
+		return data() + m_size;
 	}
 
 	void push_back(const value_type& value) {
-		if (m_finish != m_end_of_storage) {
-			auto new_element = g_alloc->New<value_type>(value);
-			*m_finish = new_element;
-			++m_finish;
+		emplace_back(value);
+	}
+
+	void push_back(value_type&& value) {
+		emplace_back(std::move(value));
+	}
+
+	// 扩容失败时不插入，没有新元素可以返回，debug版本直接assert
+	template <typename... P>
+	reference emplace_back(P&&... params) {
+		if (m_size == m_capacity) {
+			// 参数可能引用着自己的元素，先在旧的存储上构造出来再扩容
+			T tmp(std::forward<P>(params)...);
+			if (!reserve(m_size + 1)) {
+				assert(false);
+				return *data();
+			}
+			::new (data() + m_size) T(std::move(tmp));
 		} else {
-			reserve(capacity() + 2);
-			push_back(value);
+			::new (data() + m_size) T(std::forward<P>(params)...);
 		}
+		return (*this)[m_size++];
 	}
 
 	void pop_back() {
-		--m_finish;
-		auto d = *m_finish;
-		g_alloc->Delete(d);
+		assert(m_size > 0);
+		--m_size;
+		(data() + m_size)->~T();
 	}
 
 	void clear() {
-		while (!empty()) {
-			pop_back();
+		T* p = data();
+		for (size_t i = 0; i < m_size; i++) {
+			p[i].~T();
+		}
+		m_size = 0;
+	}
+
+	// 在pos之前插入一个元素，返回指向新元素的迭代器；扩容失败时不插入，返回end()
+	iterator insert(const_iterator pos, const value_type& value) {
+		return insert(pos, size_t(1), value);
+	}
+
+	iterator insert(const_iterator pos, size_t n, const value_type& value) {
+		auto index = size_t(pos - begin());
+		if (n == 0)
+			return begin() + index;
+
+		// value可能就是自己的元素，扩容或者移动之后就失效了
+		T tmp(value);
+		if (!reserve(m_size + n))
+			return end();
+		T* hole = OpenGap(index, n);
+		for (size_t i = 0; i < n; i++) {
+			AssignGap(hole + i, index + i, tmp);
 		}
+		m_size += n;
+		return begin() + index;
 	}
 
-	// 设置容量
-	void reserve(size_t new_capacity) {
-		auto old_size = size();
-		new_capacity = GetSuitableCapacity(std::max(old_size, new_capacity));
+	// 把[first, last)插入到pos之前，区间不能来自自己
+	template <class InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+	iterator insert(const_iterator pos, InputIt first, InputIt last) {
+		auto index = size_t(pos - begin());
+		auto n = size_t(std::distance(first, last));
+		if (n == 0)
+			return begin() + index;
 
-		//多分配一个，用来存放尾结点
-		auto new_list = g_alloc->Malloc<shm_pointer<value_type>>(new_capacity + 1);
-		if (old_size > 0) {
-			memcpy(new_list.Ptr(), m_start.Ptr(), sizeof(shm_pointer<value_type>) * old_size);
-			g_alloc->Free(m_start, capacity() + 1);
+		if (!reserve(m_size + n))
+			return end();
+		T* hole = OpenGap(index, n);
+		for (size_t i = 0; i < n; ++i, ++first) {
+			AssignGap(hole + i, index + i, *first);
 		}
+		m_size += n;
+		return begin() + index;
+	}
 
-		m_start = new_list;
-		m_finish = m_start + old_size;
-		m_end_of_storage = m_start + new_capacity;
+	iterator erase(const_iterator pos) {
+		return erase(pos, pos + 1);
 	}
 
-	// 改变vector中元素的数目
-	void resize(size_t n, const value_type& val) {
-		/*
-		如果n比当前的vector元素数目要小，vector的容量要缩减到resize的第一个参数大小，并移除那些超出n的元素同时销毁他们。
-		如果n比当前vector元素数目要大，在vector的末尾扩展需要的元素数目，如果第二个参数val指定了，扩展的新元素初始化为
-			val的副本，否则按类型默认初始化。
-		注意：如果n大于当前的vector的容量(是容量，并非vector的size)，将会引起自动内存分配。所以现有的pointer,references,iterators将会失效。
-		*/
-		const auto ori_size = size();
-		if (n == ori_size)
-			return;
+	// 删除[first, last)，返回指向被删除区间之后第一个元素的迭代器
+	iterator erase(const_iterator first, const_iterator last) {
+		auto index = size_t(first - begin());
+		auto n = size_t(last - first);
+		if (n == 0)
+			return begin() + index;
 
-		if (n > capacity()) {
-			reserve(n);
+		T* p = data();
+		if (std::is_trivially_copyable<T>::value) {
+			memmove((void*)(p + index), (const void*)(p + index + n), sizeof(T) * (m_size - index - n));
+		} else {
+			std::move(p + index + n, p + m_size, p + index);
+			for (size_t i = m_size - n; i < m_size; i++) {
+				p[i].~T();
+			}
 		}
+		m_size -= n;
+		return begin() + index;
+	}
+
+	// 设置容量，按2的幂对齐，只会扩大不会缩小
+	// 分配失败时vector保持原样，返回false
+	bool reserve(size_t new_capacity) {
+		if (new_capacity <= m_capacity)
+			return true;
 
-		if (n > ori_size) {
-			// 在末尾添加元素
-			for (auto i = ori_size; i < n; i++) {
-				push_back(val);
+		new_capacity = GetSuitableCapacity(std::max(new_capacity, m_capacity * 2));
+		Alloc* alloc = AllocOf(this);
+		auto new_start = alloc->Malloc<value_type>(new_capacity);
+		if (new_start == shm_nullptr) {
+			SMD_LOG_ERROR("shm_vector reserve failed, size:%llu, capacity:%llu", m_size, new_capacity);
+			return false;
+		}
+
+		if (m_start != shm_nullptr) {
+			Relocate(new_start.Ptr(), m_start.Ptr(), m_size);
+			g_alloc->Free(m_start, m_capacity);
+		}
+
+		m_start = new_start;
+		m_capacity = new_capacity;
+		return true;
+	}
+
+	// 改变vector中元素的数目，多出来的元素按类型默认初始化
+	void resize(size_t n) {
+		if (n > m_size) {
+			if (!reserve(n))
+				return;
+			T* p = data();
+			for (size_t i = m_size; i < n; i++) {
+				::new (p + i) T();
 			}
+			m_size = n;
 		} else {
-			// 销毁部分元素
-			for (auto i = n; i < ori_size; i++) {
-				pop_back();
+			Shrink(n);
+		}
+	}
+
+	// 改变vector中元素的数目，多出来的元素是val的副本
+	// n大于容量时会重新分配，现有的引用和迭代器都会失效
+	void resize(size_t n, const value_type& val) {
+		if (n > m_size) {
+			T tmp(val);
+			if (!reserve(n))
+				return;
+			T* p = data();
+			for (size_t i = m_size; i < n; i++) {
+				::new (p + i) T(tmp);
 			}
+			m_size = n;
+		} else {
+			Shrink(n);
 		}
 	}
 
-private:
+	// 释放多余的容量
+	void shrink_to_fit() {
+		if (m_size == m_capacity)
+			return;
+
+		if (m_size == 0) {
+			g_alloc->Free(m_start, m_capacity);
+			m_capacity = 0;
+			return;
+		}
+
+		Alloc* alloc = AllocOf(this);
+		auto new_start = alloc->Malloc<value_type>(m_size);
+		if (new_start == shm_nullptr) {
+			SMD_LOG_ERROR("shm_vector shrink_to_fit failed, size:%llu, capacity:%llu", m_size, m_capacity);
+			return;
+		}
+		Relocate(new_start.Ptr(), m_start.Ptr(), m_size);
+		g_alloc->Free(m_start, m_capacity);
+		m_start = new_start;
+		m_capacity = m_size;
+	}
+
 	void swap(shm_vector& x) {
 		std::swap(m_start, x.m_start);
-		std::swap(m_finish, x.m_finish);
-		std::swap(m_end_of_storage, x.m_end_of_storage);
+		std::swap(m_size, x.m_size);
+		std::swap(m_capacity, x.m_capacity);
 	}
 
+private:
 	size_t GetSuitableCapacity(size_t size) {
 		if (size < 1)
 			size = 1;
-		return util::Utility::NextPowOf2(uint32_t(size));
+		return util::Utility::NextPowOf2(uint64_t(size));
 	}
 
-	void shrink_to_fit() {
-		// 在此添加代码缩容
+	// 把n个元素搬到新的存储上，旧的元素随之销毁
+	static void Relocate(T* dst, T* src, size_t n) {
+		if (std::is_trivially_copyable<T>::value) {
+			memcpy((void*)dst, (const void*)src, sizeof(T) * n);
+		} else {
+			for (size_t i = 0; i < n; i++) {
+				::new (dst + i) T(std::move(src[i]));
+				src[i].~T();
+			}
+		}
+	}
+
+	//
+	// 把index之后的元素后移n个位置，空出[index, index + n)，容量必须已经足够
+	// 空位中落在原来size之外的部分是未构造的内存，之内的部分是已经移走的元素
+	//
+	T* OpenGap(size_t index, size_t n) {
+		T* p = data();
+		if (std::is_trivially_copyable<T>::value) {
+			memmove((void*)(p + index + n), (const void*)(p + index), sizeof(T) * (m_size - index));
+			return p + index;
+		}
+
+		for (size_t i = m_size; i > index; i--) {
+			size_t from = i - 1;
+			size_t to = from + n;
+			if (to >= m_size) {
+				::new (p + to) T(std::move(p[from]));
+			} else {
+				p[to] = std::move(p[from]);
+			}
+		}
+		return p + index;
+	}
+
+	template <class V>
+	void AssignGap(T* slot, size_t index, V&& value) {
+		if (std::is_trivially_copyable<T>::value || index >= m_size) {
+			::new (slot) T(std::forward<V>(value));
+		} else {
+			*slot = std::forward<V>(value);
+		}
+	}
+
+	void Shrink(size_t n) {
+		T* p = data();
+		for (size_t i = n; i < m_size; i++) {
+			p[i].~T();
+		}
+		m_size = std::min(m_size, n);
 	}
 
 private:
-	shm_pointer<shm_pointer<value_type>> m_start = shm_nullptr;
-	shm_pointer<shm_pointer<value_type>> m_finish = shm_nullptr;
-	shm_pointer<shm_pointer<value_type>> m_end_of_storage = shm_nullptr;
+	shm_pointer<value_type> m_start = shm_nullptr;
+	size_t m_size = 0;
+	size_t m_capacity = 0;
 };
 
 } // namespace smd
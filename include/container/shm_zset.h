@@ -0,0 +1,218 @@
+﻿#pragma once
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <common/functional.h>
+#include <common/slice.h>
+#include <container/shm_string.h>
+#include <container/shm_unordered_map.h>
+#include <container/shm_map.h>
+
+namespace smd {
+
+//
+// 有序集合的排序键：先按分数，分数相同时按成员的字典序，和Redis一致
+//
+// 查找用的键，成员直接用Slice，不构造shm_string
+struct ZSetSliceKey {
+	double score;
+	Slice member;
+};
+
+struct ZSetKey {
+	double score;
+	shm_string member;
+
+	ZSetKey(double s, const Slice& m)
+		: score(s)
+		, member(m.data(), m.size()) {}
+
+	// 插入时在树的节点里直接构造
+	explicit ZSetKey(const ZSetSliceKey& k)
+		: score(k.score)
+		, member(k.member.data(), k.member.size()) {}
+};
+
+template <>
+inline int64_t compare(const ZSetKey& x, const ZSetKey& y) {
+	if (x.score != y.score)
+		return x.score < y.score ? -1 : 1;
+	return x.member.compare(y.member);
+}
+
+inline int64_t compare(const ZSetSliceKey& x, const ZSetKey& y) {
+	if (x.score != y.score)
+		return x.score < y.score ? -1 : 1;
+	return -int64_t(y.member.compare(x.member.data(), x.member.size()));
+}
+
+template <>
+struct is_transparent_key<ZSetKey, ZSetSliceKey> : std::true_type {};
+
+//
+// Redis的sorted set：成员到分数的哈希表，加上按(分数, 成员)排序、带子树大小的红黑树
+// ZSCORE查哈希表是O(1)，ZADD、ZREM、ZRANK以及ZRANGE、ZRANGEBYSCORE的定位都是O(logn)
+// 成员在哈希表和树里各存一份，短成员放在shm_string内部，不会有额外的分配
+// 分数不能是NaN
+//
+class shm_zset {
+public:
+	typedef shm_rank_map<ZSetKey, bool> tree_type;
+	typedef shm_unordered_map<shm_string, double> dict_type;
+
+	size_t size() const {
+		return m_dict.size();
+	}
+
+	bool empty() const {
+		return m_dict.empty();
+	}
+
+	// ZADD：成员不存在时插入并返回true，已经存在时更新分数并返回false
+	bool add(const Slice& member, double score) {
+		assert(!isnan(score));
+		auto it = m_dict.find(member);
+		if (it != m_dict.end()) {
+			update(it->second, member, score);
+			return false;
+		}
+
+		m_dict.try_emplace(member, score);
+		m_tree.try_emplace(ZSetSliceKey{score, member}, true);
+		return true;
+	}
+
+	// ZINCRBY：成员不存在时从0开始加，返回新的分数
+	double incrby(const Slice& member, double increment) {
+		auto it = m_dict.find(member);
+		if (it == m_dict.end()) {
+			add(member, increment);
+			return increment;
+		}
+
+		update(it->second, member, it->second + increment);
+		return it->second;
+	}
+
+	// ZSCORE
+	bool score(const Slice& member, double* score) const {
+		auto it = m_dict.find(member);
+		if (it == m_dict.end())
+			return false;
+
+		if (score != nullptr) {
+			*score = it->second;
+		}
+		return true;
+	}
+
+	// ZRANK：按分数从小到大的名次，从0开始
+	bool rank(const Slice& member, size_t* rank) const {
+		auto it = m_dict.find(member);
+		if (it == m_dict.end())
+			return false;
+
+		if (rank != nullptr) {
+			*rank = m_tree.rank(ZSetSliceKey{it->second, member});
+		}
+		return true;
+	}
+
+	// ZREVRANK：按分数从大到小的名次
+	bool revrank(const Slice& member, size_t* rank) const {
+		size_t r = 0;
+		if (!this->rank(member, &r))
+			return false;
+
+		if (rank != nullptr) {
+			*rank = size() - 1 - r;
+		}
+		return true;
+	}
+
+	// ZREM
+	bool remove(const Slice& member) {
+		auto it = m_dict.find(member);
+		if (it == m_dict.end())
+			return false;
+
+		m_tree.erase(ZSetSliceKey{it->second, member});
+		m_dict.erase(it);
+		return true;
+	}
+
+	//
+	// ZRANGE：按名次访问[start, stop]，两端都包含，负数表示从末尾倒数，-1是最后一个
+	// callback的参数是(const shm_string& member, double score)，返回访问的个数
+	//
+	template <class F>
+	size_t range(int64_t start, int64_t stop, F&& callback) const {
+		const int64_t count = int64_t(size());
+		if (start < 0)
+			start = std::max(start + count, int64_t(0));
+		if (stop < 0)
+			stop += count;
+		if (stop >= count)
+			stop = count - 1;
+		if (start > stop)
+			return 0;
+
+		size_t visited = 0;
+		for (auto it = m_tree.select(size_t(start)); visited < size_t(stop - start + 1); ++it, ++visited) {
+			callback(it->first.member, it->first.score);
+		}
+		return visited;
+	}
+
+	// ZRANGEBYSCORE：分数在[min, max]内的成员，跳过前offset个，最多limit个
+	template <class F>
+	size_t range_by_score(double min, double max, size_t offset, size_t limit, F&& callback) const {
+		if (limit == 0 || min > max)
+			return 0;
+
+		// 空成员比分数相同的其他成员都小，从它开始就是分数不小于min的第一个
+		auto first = ZSetSliceKey{min, Slice()};
+		auto it = offset > 0 ? m_tree.select(m_tree.rank(first) + offset) : m_tree.lower_bound(first);
+		size_t visited = 0;
+		for (; it != m_tree.end() && it->first.score <= max; ++it) {
+			callback(it->first.member, it->first.score);
+			if (++visited == limit)
+				break;
+		}
+		return visited;
+	}
+
+	// ZCOUNT：分数在[min, max]内的成员个数，只需要两次定位
+	size_t count(double min, double max) const {
+		if (min > max)
+			return 0;
+
+		auto lo = m_tree.rank(ZSetSliceKey{min, Slice()});
+		if (max == std::numeric_limits<double>::infinity())
+			return size() - lo;
+		return m_tree.rank(ZSetSliceKey{nextafter(max, std::numeric_limits<double>::infinity()), Slice()}) - lo;
+	}
+
+	void clear() {
+		m_tree.clear();
+		m_dict.clear();
+	}
+
+private:
+	// 分数变化时在树里删掉旧的位置再插入，哈希表里的分数原地修改
+	void update(double& stored, const Slice& member, double score) {
+		assert(!isnan(score));
+		if (stored == score)
+			return;
+
+		m_tree.erase(ZSetSliceKey{stored, member});
+		m_tree.try_emplace(ZSetSliceKey{score, member}, true);
+		stored = score;
+	}
+
+private:
+	tree_type m_tree;
+	dict_type m_dict;
+};
+
+} // namespace smd
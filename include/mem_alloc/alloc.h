@@ -1,28 +1,228 @@
 ﻿#pragma once
 #include <mem_alloc/buddy.h>
+#include <mem_alloc/buddy_list.h>
+#include <mem_alloc/shm_handle.h>
 #include <container/shm_pointer.h>
 #include <common/log.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace smd {
 
+// 伙伴系统的实现方式，冷启动时选定，热启动沿用共享内存中记录的方式
+enum class BuddyType : uint32_t {
+	kTree = 0,	   // SmdBuddyAlloc，每个字节一个节点的满二叉树，每次都从根节点开始查找
+	kFreeList = 1, // SmdBuddyListAlloc，每一阶一个空闲链表，分配和回收只访问用到的那几阶
+};
+
+class Alloc;
+
+// 以字典编号为下标的分配器，回收时按指针中的编号找到对应的分配器
+inline Alloc* g_env_alloc[SHM_ENV_NUM] = {};
+
+//
+// 所有字典所有段的存储区，按起始地址排好序，按地址找所在的字典时二分查找，不用逐个字典逐段比较
+// 只在创建段和析构字典时修改
+//
+struct SegmentRange {
+	const char* begin;
+	const char* end;
+	Alloc* alloc;
+};
+
+inline std::vector<SegmentRange> g_segment_ranges;
+
+inline void AddSegmentRange(const char* begin, size_t size, Alloc* alloc) {
+	auto it = std::lower_bound(g_segment_ranges.begin(), g_segment_ranges.end(), begin,
+		[](const SegmentRange& r, const char* p) { return r.begin < p; });
+	g_segment_ranges.insert(it, SegmentRange{begin, begin + size, alloc});
+}
+
+inline void RemoveSegmentRanges(Alloc* alloc) {
+	g_segment_ranges.erase(std::remove_if(g_segment_ranges.begin(), g_segment_ranges.end(),
+							   [alloc](const SegmentRange& r) { return r.alloc == alloc; }),
+		g_segment_ranges.end());
+}
+
+// 地址所在的字典，不在任何字典里时返回空
+inline Alloc* FindAllocByAddress(const void* p) {
+	auto it = std::upper_bound(g_segment_ranges.begin(), g_segment_ranges.end(), (const char*)p,
+		[](const char* q, const SegmentRange& r) { return q < r.begin; });
+	if (it == g_segment_ranges.begin())
+		return nullptr;
+	--it;
+	return (const char*)p < it->end ? it->alloc : nullptr;
+}
+
 class Alloc {
 public:
-	Alloc(void* ptr, size_t off_set, unsigned level, bool attached) {
-		const char* base_ptr = (const char*)ptr + off_set;
-		m_buddy = (SmdBuddyAlloc::buddy*)base_ptr;
-		g_storage_ptr = base_ptr + SmdBuddyAlloc::get_index_size(level);
+	enum {
+		SLAB_PAGE_SIZE = 16 * 1024, // 小块内存每次从伙伴系统申请一页，再切分成同样大小的块
+		SLAB_PAGE_HEAD = 32,		// 页头SlabPage的大小，块从页头之后开始切分
+		SLAB_MAX_SIZE = 256,		// 不超过这个大小的内存走小块内存分配
+		SLAB_CLASS_NUM = 16,
+		BLOCK_MAP_SHIFT = 6,					  // 块表每个字节对应64字节的存储区
+		BLOCK_MAP_GRANULE = 1 << BLOCK_MAP_SHIFT, // 伙伴系统分配的最小块
+	};
 
-		if (!attached) {
-			m_buddy = SmdBuddyAlloc::buddy_new(base_ptr, level);
+	//
+	// 小块内存的页头，放在页的开头
+	// 同规格还有空闲块的页串成双向链表，分配总是从链表头的页里取；页里的块全部回收之后把页还给伙伴系统，
+	// 但链表里只剩这一页时留着，避免在一页的边界上反复分配回收时每次都向伙伴系统申请和归还
+	//
+	struct SlabPage {
+		int64_t prev;
+		int64_t next;
+		int64_t free;	 // 页内回收的块组成的单向链表，链接存放在空闲块的前8个字节
+		uint32_t cursor; // 页内还没有切分出去的位置
+		uint32_t live;	 // 已经分配出去的块数
+	};
+	static_assert(sizeof(SlabPage) == SLAB_PAGE_HEAD, "SlabPage size");
+
+	//
+	// 块表：存储区每64字节对应一个字节，记录从这里开始的块是怎么分配出来的，回收和查询大小都不需要遍历索引
+	// 伙伴系统的块只记录在起始位置，值为块的阶数；小块内存的页每个字节都记录为 BLOCK_SLAB | 规格
+	// 只有已分配的块才会被读取，所以块表不需要初始化
+	// 伙伴系统的最小块就是块表的粒度：改成16字节时块表占存储区的1/16（64字节时是1/64），不管用不用小块内存都要付出；
+	// 小块内存默认打开，64字节以下的分配都走小块内存，关闭时按64字节占用，
+	// 比如100万个24字节的链表节点占用64MB，16字节的粒度是32MB（bench_slab）
+	//
+	enum : uint8_t {
+		BLOCK_SLAB = 0x80,
+	};
+
+	enum : uint32_t {
+		ALLOC_MAGIC = 0x41444d53, // "SMDA"
+	};
+
+	//
+	// 分配器的头部，存放在共享内存中偏移为0的位置，热重启之后依然有效
+	//
+	struct AllocHead {
+		uint32_t magic;
+		uint32_t enable_slab;
+		int64_t slab_partial[SLAB_CLASS_NUM]; // 各规格还有空闲块的页组成的链表
+		uint64_t slab_pages;
+		uint64_t committed; // 已分配出去的块的实际大小（按规格或者伙伴系统的块向上取整）
+		uint32_t segment_num;					// 共享内存的段数，第0段是Env::Create创建的那一段
+		uint32_t alloc_segment;					// 最近一次分配成功的段，优先从这一段分配
+		uint8_t segment_level[SHM_SEGMENT_NUM]; // 每一段伙伴系统的level
+	};
+
+	//
+	// 扩展段开头的段头：扩展段的key由第0段的key推导出来，可能和别的字典的key重合，
+	// 删除上一次留下的段和挂接之前都先检查段头，不是自己的段时报错，不删除也不挂接
+	//
+	struct SegmentHead {
+		uint32_t magic;
+		uint32_t index;
+		int32_t owner_key; // 第0段的key
+		uint32_t level;
+	};
+
+	enum : uint32_t {
+		SEGMENT_MAGIC = 0x53444d53, // "SMDS"
+		SEGMENT_HEAD_SIZE = 64,		// 段头之后的部分按64字节对齐
+	};
 
+	//
+	// 一段共享内存，依次是块表、伙伴系统的索引、存储区，链表实现的存储区必须紧跟在它的索引后面
+	//
+	struct Segment {
+		uint8_t* block_map;
+		void* buddy;
+		const char* storage;
+		uint64_t size;
+	};
+
+	//
+	// shm不为空时，空间不够会自动创建新的段，新段的level比上一段大1，热启动时按共享内存中的记录挂接所有的段
+	// env_id是字典的编号，会写进分配出去的指针里，同一个进程中同时挂接的字典编号不能相同
+	//
+	Alloc(void* ptr,
+		size_t off_set,
+		unsigned level,
+		bool attached,
+		bool enable_slab = true,
+		BuddyType buddy_type = BuddyType::kTree,
+		ShmHandle* shm = nullptr,
+		unsigned env_id = 0)
+		: m_buddy_type(buddy_type)
+		, m_shm(shm)
+		, m_env_id(env_id) {
+		InitSegment(0, (char*)ptr + off_set, level, attached);
+
+		if (!attached) {
 			//
-			// 这样能让以后分配的地址不会为0，也不用回收
+			// 第一块内存用来存放分配器头部，这样能让以后分配的地址不会为0，也不用回收
 			//
+			auto head_off = SegmentMalloc(0, BlockOrder(sizeof(AllocHead))) & SHM_OFFSET_MASK;
+			assert(head_off == 0);
+			m_head = (AllocHead*)(m_segments[0].storage + head_off);
+			memset(m_head, 0, sizeof(AllocHead));
+			m_head->magic = ALLOC_MAGIC;
+			m_head->enable_slab = enable_slab ? 1 : 0;
+			for (int i = 0; i < SLAB_CLASS_NUM; i++) {
+				m_head->slab_partial[i] = shm_nullptr;
+			}
+			m_head->segment_num = 1;
+			m_head->segment_level[0] = uint8_t(level);
 
-			Malloc<char>();
+			// 上一次留下来的扩展段已经没有用了
+			for (unsigned i = 1; m_shm != nullptr && i < SHM_SEGMENT_NUM && IsOwnSegment(i) && m_shm->remove_segment(i);
+				 i++) {
+			}
+		} else {
+			m_head = (AllocHead*)m_segments[0].storage;
+			if (m_head->magic != ALLOC_MAGIC) {
+				SMD_LOG_ERROR("Alloc head is corrupted, magic:0x%08x", m_head->magic);
+				assert(false);
+			}
+
+			for (unsigned i = 1; i < m_head->segment_num; i++) {
+				if (!AttachSegment(i)) {
+					assert(false);
+					break;
+				}
+			}
 		}
 	}
 
+	~Alloc() {
+		RemoveSegmentRanges(this);
+		for (auto& shm : m_segment_shm) {
+			if (shm != nullptr) {
+				shm->release();
+			}
+		}
+	}
+
+	// 索引区的大小，包括块表
+	static size_t GetIndexSize(BuddyType buddy_type, unsigned level) {
+		if (buddy_type == BuddyType::kFreeList)
+			return GetBlockMapSize(level) + SmdBuddyListAlloc::get_index_size(level);
+		return GetBlockMapSize(level) + SmdBuddyAlloc::get_index_size(level);
+	}
+
+	// 块表的大小，按64字节对齐
+	static size_t GetBlockMapSize(unsigned level) {
+		uint64_t size = ((uint64_t(1) << level) + BLOCK_MAP_GRANULE - 1) >> BLOCK_MAP_SHIFT;
+		return (size + 63) & ~uint64_t(63);
+	}
+
+	// 存储区的大小
+	static size_t GetStorageSize(BuddyType buddy_type, unsigned level) {
+		if (buddy_type == BuddyType::kFreeList)
+			return SmdBuddyListAlloc::get_storage_size(level);
+		return SmdBuddyAlloc::get_storage_size(level);
+	}
+
+	// 一段共享内存的大小
+	static size_t GetSegmentSize(BuddyType buddy_type, unsigned level) {
+		return GetIndexSize(buddy_type, level) + GetStorageSize(buddy_type, level);
+	}
+
 	template <class T>
 	shm_pointer<T> Malloc(size_t n = 1) {
 		auto size = sizeof(T) * n;
@@ -31,18 +231,42 @@ public:
 		return shm_pointer<T>(addr);
 	}
 
+	//
+	// 块的大小从块表中查出来，n只用来统计申请的字节数
+	//
 	template <class T>
 	void Free(shm_pointer<T>& p, size_t n = 1) {
 		assert(p != shm_nullptr && p != 0);
+
+		// 其他字典分配出来的内存，交给它自己的分配器回收
+		Alloc* owner = g_env_alloc[p.Raw() >> SHM_ENV_SHIFT];
+		if (owner != this && owner != nullptr) {
+			owner->Free(p, n);
+			return;
+		}
+
 		auto size = sizeof(T) * n;
 		// SMD_LOG_DEBUG("free: 0x%p:(%d)", p, size);
 		_Free(p.Raw(), size);
 		p = shm_nullptr;
 	}
 
+	// 块实际的大小，不小于申请的大小
+	template <class T>
+	size_t GetBlockSize(const shm_pointer<T>& p) const {
+		assert(p != shm_nullptr);
+		Alloc* owner = g_env_alloc[p.Raw() >> SHM_ENV_SHIFT];
+		if (owner != this && owner != nullptr)
+			return owner->GetBlockSize(p);
+		return BlockSize(p.Raw());
+	}
+
 	template <class T, typename... P>
 	shm_pointer<T> New(P&&... params) {
 		auto t = Malloc<T>();
+		if (t == shm_nullptr)
+			return t;
+
 		::new (t.Ptr()) T(std::forward<P>(params)...);
 		return t;
 	}
@@ -61,49 +285,432 @@ public:
 		p = nullptr;
 	}
 
+	// 申请的字节数
 	size_t GetUsed() const {
 		return m_used;
 	}
 
+	// 本进程调用Malloc的次数，用来检查热点路径有没有多余的分配
+	size_t GetMallocCount() const {
+		return m_malloc_count;
+	}
+
+	// 实际占用的字节数，记录在共享内存中，热重启之后依然有效
+	uint64_t GetCommitted() const {
+		return m_head->committed;
+	}
+
+	// 地址在这个字典的某一段里
+	bool Contains(const void* p) const {
+		int64_t offset;
+		return FindSegment((const char*)p, offset);
+	}
+
+	// 先在自己的段中找地址所在的段，再找其他的字典，都不在时按自己的第0段计算
 	template <class T>
 	shm_pointer<T> ToShmPointer(void* p) const {
-		int64_t offset = (const char*)p - g_storage_ptr;
-		return shm_pointer<T>(offset);
+		int64_t offset;
+		if (FindSegment((const char*)p, offset))
+			return shm_pointer<T>(offset);
+
+		Alloc* owner = FindAllocByAddress(p);
+		if (owner != nullptr && owner != this && owner->FindSegment((const char*)p, offset))
+			return shm_pointer<T>(offset);
+
+		offset = (const char*)p - m_segments[0].storage;
+		return shm_pointer<T>(ShmSegmentPointer(m_env_id, 0, offset));
+	}
+
+	unsigned GetEnvId() const {
+		return m_env_id;
+	}
+
+	uint32_t GetSegmentNum() const {
+		return m_head->segment_num;
+	}
+
+	// 把扩展段的修改写回文件，第0段由Env自己处理
+	bool Flush(bool async = false) {
+		bool ok = true;
+		for (auto& shm : m_segment_shm) {
+			if (shm != nullptr && !shm->flush(async)) {
+				ok = false;
+			}
+		}
+		return ok;
+	}
+
+	BuddyType GetBuddyType() const {
+		return m_buddy_type;
+	}
+
+	bool IsSlabEnabled() const {
+		return m_head->enable_slab != 0;
+	}
+
+	uint64_t GetSlabPages() const {
+		return m_head->slab_pages;
 	}
 
 private:
 	int64_t _Malloc(size_t size) {
-		auto off_set = SmdBuddyAlloc::buddy_alloc(m_buddy, uint32_t(size));
+		int64_t off_set;
+		if (size <= SLAB_MAX_SIZE && IsSlabEnabled()) {
+			off_set = SlabMalloc(SlabClass(size));
+		} else {
+			off_set = BuddyMalloc(size);
+		}
+
+		// 空间不够了，调用者都不检查返回值，调试版本直接断言；发布版本返回空指针
 		if (off_set < 0) {
+			SMD_LOG_ERROR("malloc failed, size:%llu", size);
 			assert(false);
-			return 0;
+			return shm_nullptr;
 		}
 
-		SMD_LOG_DEBUG("malloc: 0x%08x:(%llu)", off_set, size);
+		SMD_LOG_DEBUG("malloc: 0x%08llx:(%llu)", off_set, size);
 		m_used += size;
+		m_malloc_count++;
+		m_head->committed += BlockSize(off_set);
 		return off_set;
 	}
 
 	void _Free(int64_t off_set, size_t size) {
-		SMD_LOG_DEBUG("free: 0x%08x:(%llu)", off_set, size);
+		SMD_LOG_DEBUG("free: 0x%08llx:(%llu)", off_set, size);
+		const uint8_t block = BlockMap(off_set);
+		const size_t block_size = BlockSize(off_set);
+		assert(size <= block_size);
+
 		m_used -= size;
-		SmdBuddyAlloc::buddy_free(m_buddy, int(off_set));
+		m_head->committed -= block_size;
+		if (block & BLOCK_SLAB) {
+			SlabFree(block & ~BLOCK_SLAB, off_set);
+		} else {
+			BuddyFree(off_set, block);
+		}
+	}
+
+	bool FindSegment(const char* p, int64_t& offset) const {
+		for (unsigned i = 0; i < m_segments.size(); i++) {
+			const Segment& segment = m_segments[i];
+			if (p >= segment.storage && p < segment.storage + segment.size) {
+				offset = ShmSegmentPointer(m_env_id, i, p - segment.storage);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static unsigned SegmentIndex(int64_t off_set) {
+		return unsigned(off_set >> SHM_SEGMENT_SHIFT) % SHM_SEGMENT_NUM;
+	}
+
+	uint8_t& BlockMap(int64_t off_set) const {
+		const Segment& segment = m_segments[SegmentIndex(off_set)];
+		return segment.block_map[(off_set & SHM_OFFSET_MASK) >> BLOCK_MAP_SHIFT];
+	}
+
+	size_t BlockSize(int64_t off_set) const {
+		const uint8_t block = BlockMap(off_set);
+		if (block & BLOCK_SLAB)
+			return SlabClassSize(block & ~BLOCK_SLAB);
+		return size_t(1) << block;
+	}
+
+	// 伙伴系统的块至少是块表的一个粒度
+	static int BlockOrder(size_t size) {
+		int order = BLOCK_MAP_SHIFT;
+		while ((size_t(1) << order) < size) {
+			order++;
+		}
+		return order;
+	}
+
+	//
+	// 先从最近一次分配成功的段里分配，再依次尝试其他的段，都不够时创建新的段
+	//
+	int64_t BuddyMalloc(size_t size) {
+		const int order = BlockOrder(size);
+		int64_t off_set = SegmentMalloc(m_head->alloc_segment, order);
+		if (off_set >= 0)
+			return off_set;
+
+		for (unsigned i = 0; i < m_head->segment_num; i++) {
+			if (i == m_head->alloc_segment)
+				continue;
+
+			off_set = SegmentMalloc(i, order);
+			if (off_set >= 0) {
+				m_head->alloc_segment = i;
+				return off_set;
+			}
+		}
+
+		if (!GrowSegment(order))
+			return -1;
+
+		m_head->alloc_segment = m_head->segment_num - 1;
+		return SegmentMalloc(m_head->alloc_segment, order);
+	}
+
+	// 在指定的段里分配，阶数记录在块表中，返回的是带段号的指针
+	int64_t SegmentMalloc(unsigned index, int order) {
+		const Segment& segment = m_segments[index];
+		int64_t off_set;
+		if (m_buddy_type == BuddyType::kFreeList)
+			off_set = SmdBuddyListAlloc::buddy_alloc((SmdBuddyListAlloc::buddy*)segment.buddy, size_t(1) << order);
+		else
+			off_set = SmdBuddyAlloc::buddy_alloc((SmdBuddyAlloc::buddy*)segment.buddy, size_t(1) << order);
+
+		if (off_set < 0)
+			return -1;
+
+		segment.block_map[off_set >> BLOCK_MAP_SHIFT] = uint8_t(order);
+		return ShmSegmentPointer(m_env_id, index, off_set);
+	}
+
+	void BuddyFree(int64_t off_set, int order) {
+		const Segment& segment = m_segments[SegmentIndex(off_set)];
+		off_set &= SHM_OFFSET_MASK;
+		if (m_buddy_type == BuddyType::kFreeList)
+			SmdBuddyListAlloc::buddy_free((SmdBuddyListAlloc::buddy*)segment.buddy, off_set, size_t(1) << order);
+		else
+			SmdBuddyAlloc::buddy_free((SmdBuddyAlloc::buddy*)segment.buddy, off_set, size_t(1) << order);
+	}
+
+	void InitSegment(unsigned index, char* ptr, unsigned level, bool attached) {
+		Segment segment;
+		segment.block_map = (uint8_t*)ptr;
+		segment.buddy = ptr + GetBlockMapSize(level);
+		segment.storage = ptr + GetIndexSize(m_buddy_type, level);
+		segment.size = uint64_t(1) << level;
+		if (!attached) {
+			if (m_buddy_type == BuddyType::kFreeList)
+				SmdBuddyListAlloc::buddy_new((const char*)segment.buddy, level);
+			else
+				SmdBuddyAlloc::buddy_new((const char*)segment.buddy, level);
+		}
+
+		if (m_segments.size() <= index) {
+			m_segments.resize(index + 1);
+			m_segment_shm.resize(index + 1);
+		}
+		m_segments[index] = segment;
+		SetShmSegmentBase(m_env_id, index, segment.storage);
+		AddSegmentRange(segment.storage, segment.size, this);
+	}
+
+	// 新段的level比上一段大1，并且至少能放下这次要分配的块
+	bool GrowSegment(int order) {
+		const unsigned index = m_head->segment_num;
+		if (m_shm == nullptr || index >= SHM_SEGMENT_NUM)
+			return false;
+
+		unsigned level = m_head->segment_level[index - 1] + 1u;
+		level = level > unsigned(order) ? level : unsigned(order);
+		if (level > SmdBuddyAlloc::MAX_LEVEL)
+			return false;
+
+		// 创建时会删掉同一个key上已有的共享内存，别的字典的不能删
+		SegmentHead head;
+		if (m_shm->peek_segment(index, &head, sizeof(head)) && !CheckSegmentHead(head, index, 0)) {
+			return false;
+		}
+
+		auto shm = std::unique_ptr<ShmHandle>(new ShmHandle());
+		auto ptr = m_shm->acquire_segment(*shm, index, SEGMENT_HEAD_SIZE + GetSegmentSize(m_buddy_type, level), false)
+					   .first;
+		if (ptr == nullptr) {
+			SMD_LOG_ERROR("Create segment failed, index:%u, level:%u", index, level);
+			return false;
+		}
+
+		auto seg_head = (SegmentHead*)ptr;
+		seg_head->magic = SEGMENT_MAGIC;
+		seg_head->index = index;
+		seg_head->owner_key = m_shm->key();
+		seg_head->level = level;
+		InitSegment(index, (char*)ptr + SEGMENT_HEAD_SIZE, level, false);
+		m_segment_shm[index] = std::move(shm);
+		m_head->segment_level[index] = uint8_t(level);
+		m_head->segment_num++;
+		SMD_LOG_INFO("New segment has been created, index:%u, level:%u", index, level);
+		return true;
+	}
+
+	bool AttachSegment(unsigned index) {
+		const unsigned level = m_head->segment_level[index];
+		auto shm = std::unique_ptr<ShmHandle>(new ShmHandle());
+		auto result = m_shm == nullptr
+			? std::make_pair((void*)nullptr, false)
+			: m_shm->acquire_segment(*shm, index, SEGMENT_HEAD_SIZE + GetSegmentSize(m_buddy_type, level), true);
+		if (result.first == nullptr || !result.second) {
+			SMD_LOG_ERROR("Attach segment failed, index:%u, level:%u", index, level);
+			return false;
+		}
+
+		if (!CheckSegmentHead(*(const SegmentHead*)result.first, index, level)) {
+			shm->release();
+			return false;
+		}
+
+		InitSegment(index, (char*)result.first + SEGMENT_HEAD_SIZE, level, true);
+		m_segment_shm[index] = std::move(shm);
+		return true;
+	}
+
+	// 段头是自己的第index段，level为0时不检查
+	bool CheckSegmentHead(const SegmentHead& head, unsigned index, unsigned level) const {
+		if (head.magic != SEGMENT_MAGIC || head.index != index || head.owner_key != m_shm->key() ||
+			(level != 0 && head.level != level)) {
+			SMD_LOG_ERROR("Segment belongs to others, index:%u, key:%d, magic:0x%08x, owner:%d, index in head:%u",
+				index, m_shm->key(), head.magic, head.owner_key, head.index);
+			return false;
+		}
+		return true;
+	}
+
+	// 第index段存在并且是自己的
+	bool IsOwnSegment(unsigned index) const {
+		SegmentHead head;
+		return m_shm->peek_segment(index, &head, sizeof(head)) && CheckSegmentHead(head, index, 0);
+	}
+
+	//
+	// 小块内存分配，规格为：8~64按8递增，65~128按16递增，129~256按32递增
+	//
+	static int SlabClass(size_t size) {
+		if (size <= 64)
+			return size == 0 ? 0 : int((size - 1) / 8);
+		else if (size <= 128)
+			return 8 + int((size - 65) / 16);
+		else
+			return 12 + int((size - 129) / 32);
+	}
+
+	static size_t SlabClassSize(int index) {
+		static const size_t class_size[SLAB_CLASS_NUM] = {
+			8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256};
+		return class_size[index];
+	}
+
+	int64_t& SlabNext(int64_t off_set) {
+		return *shm_pointer<int64_t>(off_set);
+	}
+
+	// 块所在的页：页是伙伴系统按页的大小对齐分配的
+	static int64_t SlabPageOf(int64_t off_set) {
+		return off_set & ~int64_t(SLAB_PAGE_SIZE - 1);
+	}
+
+	SlabPage& GetSlabPage(int64_t page) {
+		return *shm_pointer<SlabPage>(page);
+	}
+
+	// 页里没有空闲块，也没有可以切分的位置了
+	static bool IsSlabPageFull(const SlabPage& p, int64_t size) {
+		return p.free == shm_nullptr && p.cursor + size > SLAB_PAGE_SIZE;
+	}
+
+	void LinkSlabPage(int index, int64_t page) {
+		SlabPage& p = GetSlabPage(page);
+		p.prev = shm_nullptr;
+		p.next = m_head->slab_partial[index];
+		if (p.next != shm_nullptr)
+			GetSlabPage(p.next).prev = page;
+		m_head->slab_partial[index] = page;
+	}
+
+	void UnlinkSlabPage(int index, int64_t page) {
+		SlabPage& p = GetSlabPage(page);
+		if (p.prev != shm_nullptr)
+			GetSlabPage(p.prev).next = p.next;
+		else
+			m_head->slab_partial[index] = p.next;
+		if (p.next != shm_nullptr)
+			GetSlabPage(p.next).prev = p.prev;
+	}
+
+	int64_t SlabMalloc(int index) {
+		int64_t page = m_head->slab_partial[index];
+		if (page == shm_nullptr) {
+			page = BuddyMalloc(SLAB_PAGE_SIZE);
+			if (page < 0) {
+				return -1;
+			}
+
+			// 页是按需切分的，没用到的部分不会被访问
+			SlabPage& p = GetSlabPage(page);
+			p.free = shm_nullptr;
+			p.cursor = SLAB_PAGE_HEAD;
+			p.live = 0;
+			LinkSlabPage(index, page);
+			m_head->slab_pages++;
+			memset(&BlockMap(page), BLOCK_SLAB | index, SLAB_PAGE_SIZE >> BLOCK_MAP_SHIFT);
+		}
+
+		// 优先使用回收的块，再从页中切一块出来
+		SlabPage& p = GetSlabPage(page);
+		const int64_t size = (int64_t)SlabClassSize(index);
+		int64_t off_set = p.free;
+		if (off_set != shm_nullptr) {
+			p.free = SlabNext(off_set);
+		} else {
+			off_set = page + p.cursor;
+			p.cursor += uint32_t(size);
+		}
+		p.live++;
+
+		if (IsSlabPageFull(p, size))
+			UnlinkSlabPage(index, page);
+		return off_set;
+	}
+
+	void SlabFree(int index, int64_t off_set) {
+		const int64_t page = SlabPageOf(off_set);
+		SlabPage& p = GetSlabPage(page);
+		const bool full = IsSlabPageFull(p, (int64_t)SlabClassSize(index));
+		SlabNext(off_set) = p.free;
+		p.free = off_set;
+		p.live--;
+
+		if (full) {
+			LinkSlabPage(index, page);
+		} else if (p.live == 0 && (p.prev != shm_nullptr || p.next != shm_nullptr)) {
+			UnlinkSlabPage(index, page);
+			BuddyFree(page, BlockOrder(SLAB_PAGE_SIZE));
+			m_head->slab_pages--;
+		}
 	}
 
 private:
-	SmdBuddyAlloc::buddy* m_buddy;
+	const BuddyType m_buddy_type;
+	ShmHandle* m_shm;
+	const unsigned m_env_id;
+	std::vector<Segment> m_segments;
+	std::vector<std::unique_ptr<ShmHandle>> m_segment_shm; // 扩展段，第0段由Env自己管理
+	AllocHead* m_head = nullptr;
 	size_t m_used = 0;
+	size_t m_malloc_count = 0;
 };
 
-static Alloc* g_alloc = nullptr;
+// 当前使用的分配器，Env::Create之后或者调用Env::Activate切换
+inline Alloc* g_alloc = nullptr;
 
-static void CreateAlloc(void* ptr, size_t off_set, unsigned level, bool attached) {
-	if (g_alloc != nullptr) {
-		delete g_alloc;
-		g_alloc = nullptr;
-	}
+// 已经创建的字典个数
+inline unsigned g_env_alloc_num = 0;
+
+//
+// 容器从自己所在的字典分配内存：按容器的地址找到它所在的字典，当前字典是别的字典时写这个容器也不会把节点分配到别处
+// 不在任何字典里的容器（例如栈上的临时对象）用当前的分配器；只有一个字典时不用查找，多个时按地址二分查找
+// 回收按指针里的字典编号找到分配器，不需要这样查找
+//
+inline Alloc* AllocOf(const void* container) {
+	if (g_env_alloc_num <= 1)
+		return g_alloc;
 
-	g_alloc = new Alloc(ptr, off_set, level, attached);
+	Alloc* alloc = FindAllocByAddress(container);
+	return alloc != nullptr ? alloc : g_alloc;
 }
 
 } // namespace smd
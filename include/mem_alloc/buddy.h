@@ -15,7 +15,7 @@ public:
 	};
 
 	enum {
-		MAX_LEVEL = 32,
+		MAX_LEVEL = 40,
 	};
 
 #pragma pack(push, 1)
@@ -25,34 +25,38 @@ public:
 	};
 #pragma pack(pop)
 
-	static int get_index_size(int level) {
-		int size = 1 << level;
-		return (sizeof(buddy) + sizeof(uint8_t) * (size * 2 - 2));
+	// 索引区的大小按64字节对齐，这样存储区的起始地址也是对齐的
+	static uint64_t get_index_size(int level) {
+		uint64_t size = uint64_t(1) << level;
+		uint64_t index_size = sizeof(buddy) + sizeof(uint8_t) * (size * 2 - 2);
+		return (index_size + 63) & ~uint64_t(63);
 	}
 
-	static int get_storage_size(int level) {
-		int size = 1 << (level + 1);
+	static uint64_t get_storage_size(int level) {
+		uint64_t size = uint64_t(1) << (level + 1);
 		return size;
 	}
 
+	//
+	// 只需要初始化根节点：节点在父节点拆分的时候才会被初始化，所有的遍历都只会进入已经拆分的节点，
+	// 所以NODE_UNUSED的节点下面的整棵子树都不会被访问，不需要提前清零
+	//
 	static buddy* buddy_new(const char* p, int level) {
-		int size = 1 << level;
-
 		buddy* self = (buddy*)p;
 		self->level = level;
-		memset(self->tree, NODE_UNUSED, size * 2 - 1);
+		self->tree[0] = NODE_UNUSED;
 		return self;
 	}
 
-	static int buddy_alloc(buddy* self, uint32_t s) {
-		const uint32_t size = s == 0 ? 1 : next_pow_of_2(s);
-		uint32_t length = 1 << self->level;
+	static int64_t buddy_alloc(buddy* self, uint64_t s) {
+		const uint64_t size = s == 0 ? 1 : next_pow_of_2(s);
+		uint64_t length = uint64_t(1) << self->level;
 
 		// 空间不够了
 		if (size > length)
 			return -1;
 
-		int index = 0;
+		int64_t index = 0;
 		int level = 0;
 
 		while (index >= 0) {
@@ -100,11 +104,11 @@ public:
 		return -1;
 	}
 
-	static void buddy_free(buddy* self, int offset) {
-		assert(offset < (1 << self->level));
-		int left = 0;
-		int length = 1 << self->level;
-		int index = 0;
+	static void buddy_free(buddy* self, int64_t offset) {
+		assert(offset < (int64_t(1) << self->level));
+		int64_t left = 0;
+		int64_t length = int64_t(1) << self->level;
+		int64_t index = 0;
 
 		for (;;) {
 			switch (self->tree[index]) {
@@ -128,11 +132,26 @@ public:
 		}
 	}
 
-	static int buddy_size(buddy* self, int offset) {
-		assert(offset < (1 << self->level));
-		int left = 0;
-		int length = 1 << self->level;
-		int index = 0;
+	// 已知块的大小时，直接定位到对应的节点，不用从根节点往下找
+	static void buddy_free(buddy* self, int64_t offset, uint64_t s) {
+		const uint64_t size = s == 0 ? 1 : next_pow_of_2(s);
+		int order = 0;
+		while ((uint64_t(1) << order) < size) {
+			order++;
+		}
+
+		assert(order <= self->level && (offset & (size - 1)) == 0);
+		int depth = self->level - order;
+		int64_t index = (int64_t(1) << depth) - 1 + (offset >> order);
+		assert(self->tree[index] == NODE_USED);
+		_combine(self, index);
+	}
+
+	static int64_t buddy_size(buddy* self, int64_t offset) {
+		assert(offset < (int64_t(1) << self->level));
+		int64_t left = 0;
+		int64_t length = int64_t(1) << self->level;
+		int64_t index = 0;
 
 		for (;;) {
 			switch (self->tree[index]) {
@@ -155,13 +174,13 @@ public:
 		}
 	}
 
-	static void _dump(buddy* self, int index, int level) {
+	static void _dump(buddy* self, int64_t index, int level) {
 		switch (self->tree[index]) {
 		case NODE_UNUSED:
-			printf("(%d:%d)", _index_offset(index, level, self->level), 1 << (self->level - level));
+			printf("(%lld:%lld)", (long long)_index_offset(index, level, self->level), 1LL << (self->level - level));
 			break;
 		case NODE_USED:
-			printf("[%d:%d]", _index_offset(index, level, self->level), 1 << (self->level - level));
+			printf("[%lld:%lld]", (long long)_index_offset(index, level, self->level), 1LL << (self->level - level));
 			break;
 		case NODE_FULL:
 			printf("{");
@@ -184,11 +203,11 @@ public:
 	}
 
 private:
-	static inline uint32_t is_pow_of_2(uint32_t x) {
+	static inline uint64_t is_pow_of_2(uint64_t x) {
 		return !(x & (x - 1));
 	}
 
-	static inline uint32_t next_pow_of_2(uint32_t x) {
+	static inline uint64_t next_pow_of_2(uint64_t x) {
 		if (is_pow_of_2(x))
 			return x;
 		x |= x >> 1;
@@ -196,16 +215,17 @@ private:
 		x |= x >> 4;
 		x |= x >> 8;
 		x |= x >> 16;
+		x |= x >> 32;
 		return x + 1;
 	}
 
-	static inline int _index_offset(int index, int level, int max_level) {
-		return ((index + 1) - (1 << level)) << (max_level - level);
+	static inline int64_t _index_offset(int64_t index, int level, int max_level) {
+		return ((index + 1) - (int64_t(1) << level)) << (max_level - level);
 	}
 
-	static void _mark_parent(buddy* self, int index) {
+	static void _mark_parent(buddy* self, int64_t index) {
 		for (;;) {
-			int buddy = index - 1 + (index & 1) * 2;
+			int64_t buddy = index - 1 + (index & 1) * 2;
 			if (buddy > 0 && (self->tree[buddy] == NODE_USED || self->tree[buddy] == NODE_FULL)) {
 				index = (index + 1) / 2 - 1;
 				self->tree[index] = NODE_FULL;
@@ -215,9 +235,9 @@ private:
 		}
 	}
 
-	static void _combine(buddy* self, int index) {
+	static void _combine(buddy* self, int64_t index) {
 		for (;;) {
-			int buddy = index - 1 + (index & 1) * 2;
+			int64_t buddy = index - 1 + (index & 1) * 2;
 			if (buddy < 0 || self->tree[buddy] != NODE_UNUSED) {
 				self->tree[index] = NODE_UNUSED;
 				while (((index = (index + 1) / 2 - 1) >= 0) && self->tree[index] == NODE_FULL) {
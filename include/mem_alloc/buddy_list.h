@@ -0,0 +1,257 @@
+﻿#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace smd {
+
+//
+// 另一种伙伴系统的实现：每一阶维护一个空闲块组成的双向链表，再用每阶一个位图记录哪些块是空闲的。
+// 分配时直接从能满足要求的最小一阶取块，回收时只需要检查伙伴块的位，不需要从根节点开始遍历整棵树。
+// 空闲链表的链接存放在空闲块本身的前16个字节里，所以最小的块是16字节。
+// 位图按4K分页，每页有一个初始化标记，第一次访问的时候才清零，这样冷启动的时间与共享内存的大小无关。
+//
+class SmdBuddyListAlloc {
+public:
+	enum {
+		MIN_ORDER = 4, // 最小的块是 1 << MIN_ORDER 字节
+		MAX_LEVEL = 40,
+		BITMAP_PAGE_WORDS = 512, // 位图每页4K
+	};
+
+	// 空闲块开头存放的链表节点
+	struct free_node {
+		int64_t prev;
+		int64_t next;
+	};
+
+#pragma pack(push, 1)
+	struct buddy {
+		int level;
+		int marker_words;				  // 位图页初始化标记占用的字数
+		uint64_t bitmap_words;			  // 位图占用的字数
+		uint64_t index_size;			  // 索引区的大小，存储区紧跟在索引区后面
+		uint64_t nonempty_mask;			  // 第k位为1表示第k阶的空闲链表不为空
+		int64_t free_head[MAX_LEVEL + 1]; // 每一阶空闲链表的表头
+		uint64_t data[1];				  // 先是位图页的初始化标记，然后是从MIN_ORDER阶开始每一阶一个位图
+	};
+#pragma pack(pop)
+
+	static uint64_t get_index_size(int level) {
+		uint64_t words = get_marker_words(level) + get_bitmap_words(level);
+		uint64_t index_size = sizeof(buddy) - sizeof(uint64_t) + sizeof(uint64_t) * words;
+		return (index_size + 63) & ~uint64_t(63);
+	}
+
+	static uint64_t get_storage_size(int level) {
+		return uint64_t(1) << level;
+	}
+
+	static buddy* buddy_new(const char* p, int level) {
+		assert(level >= MIN_ORDER && level <= MAX_LEVEL);
+
+		buddy* self = (buddy*)p;
+		self->level = level;
+		self->marker_words = int(get_marker_words(level));
+		self->bitmap_words = get_bitmap_words(level);
+		self->index_size = get_index_size(level);
+		self->nonempty_mask = 0;
+		for (int i = 0; i <= MAX_LEVEL; i++) {
+			self->free_head[i] = -1;
+		}
+
+		// 只清理初始化标记，位图本身等到用到的时候再清零
+		memset(self->data, 0, sizeof(uint64_t) * self->marker_words);
+
+		// 一开始只有一个最大的空闲块
+		_push(self, 0, level);
+		return self;
+	}
+
+	static int64_t buddy_alloc(buddy* self, uint64_t s) {
+		const int order = _order_of(s);
+		if (order > self->level)
+			return -1;
+
+		// 找到不小于order的第一个非空阶
+		const uint64_t mask = self->nonempty_mask >> order;
+		if (mask == 0)
+			return -1;
+
+		int k = order + _ctz(mask);
+		int64_t offset = self->free_head[k];
+		_remove(self, offset, k);
+
+		// 大块拆分，后一半放回低一阶的空闲链表
+		while (k > order) {
+			k--;
+			_push(self, offset + (int64_t(1) << k), k);
+		}
+
+		return offset;
+	}
+
+	static void buddy_free(buddy* self, int64_t offset, uint64_t s) {
+		assert(offset >= 0 && offset < (int64_t(1) << self->level));
+		int order = _order_of(s);
+		assert((offset & ((int64_t(1) << order) - 1)) == 0);
+
+		// 伙伴块也是空闲的就合并，一直合并到不能合并为止
+		while (order < self->level) {
+			int64_t buddy_offset = offset ^ (int64_t(1) << order);
+			if (!_test(self, buddy_offset, order))
+				break;
+
+			_remove(self, buddy_offset, order);
+			offset = offset < buddy_offset ? offset : buddy_offset;
+			order++;
+		}
+
+		_push(self, offset, order);
+	}
+
+	// 某一阶空闲块的数量，主要用于调试
+	static uint64_t buddy_free_count(buddy* self, int order) {
+		uint64_t count = 0;
+		for (int64_t offset = self->free_head[order]; offset >= 0; offset = _node(self, offset)->next) {
+			count++;
+		}
+		return count;
+	}
+
+	static void buddy_dump(buddy* self) {
+		for (int k = MIN_ORDER; k <= self->level; k++) {
+			if (self->free_head[k] < 0)
+				continue;
+
+			printf("[%d]", k);
+			for (int64_t offset = self->free_head[k]; offset >= 0; offset = _node(self, offset)->next) {
+				printf(" %lld", (long long)offset);
+			}
+			printf("\n");
+		}
+	}
+
+private:
+	static inline uint64_t get_bitmap_words(int level) {
+		// 各阶的块数之和：2^(level-MIN_ORDER+1) - 1
+		uint64_t bits = (uint64_t(1) << (level - MIN_ORDER + 1)) - 1;
+		return (bits + 63) / 64;
+	}
+
+	static inline uint64_t get_marker_words(int level) {
+		uint64_t pages = (get_bitmap_words(level) + BITMAP_PAGE_WORDS - 1) / BITMAP_PAGE_WORDS;
+		return (pages + 63) / 64;
+	}
+
+	static inline int _ctz(uint64_t x) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, x);
+		return int(index);
+#else
+		return __builtin_ctzll(x);
+#endif
+	}
+
+	static inline int _clz(uint64_t x) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, x);
+		return 63 - int(index);
+#else
+		return __builtin_clzll(x);
+#endif
+	}
+
+	// 能容纳s字节的最小阶
+	static inline int _order_of(uint64_t s) {
+		if (s <= (uint64_t(1) << MIN_ORDER))
+			return MIN_ORDER;
+		return 64 - _clz(s - 1);
+	}
+
+	// 第k阶位图在整个位图中的起始位置
+	static inline uint64_t _bit_base(buddy* self, int order) {
+		return (uint64_t(1) << (self->level - MIN_ORDER + 1)) - (uint64_t(1) << (self->level - order + 1));
+	}
+
+	static inline uint64_t _bit_index(buddy* self, int64_t offset, int order) {
+		return _bit_base(self, order) + (uint64_t(offset) >> order);
+	}
+
+	// 位图中的一个字，所在的页第一次被访问时先清零
+	static inline uint64_t& _word(buddy* self, uint64_t w) {
+		uint64_t* markers = self->data;
+		uint64_t* bitmap = self->data + self->marker_words;
+		uint64_t page = w / BITMAP_PAGE_WORDS;
+		uint64_t& marker = markers[page / 64];
+		uint64_t bit = uint64_t(1) << (page % 64);
+		if ((marker & bit) == 0) {
+			uint64_t begin = page * BITMAP_PAGE_WORDS;
+			uint64_t end = begin + BITMAP_PAGE_WORDS;
+			end = end < self->bitmap_words ? end : self->bitmap_words;
+			memset(&bitmap[begin], 0, sizeof(uint64_t) * (end - begin));
+			marker |= bit;
+		}
+
+		return bitmap[w];
+	}
+
+	static inline bool _test(buddy* self, int64_t offset, int order) {
+		uint64_t i = _bit_index(self, offset, order);
+		return (_word(self, i / 64) >> (i % 64)) & 1;
+	}
+
+	static inline void _set(buddy* self, int64_t offset, int order) {
+		uint64_t i = _bit_index(self, offset, order);
+		_word(self, i / 64) |= uint64_t(1) << (i % 64);
+	}
+
+	static inline void _clear(buddy* self, int64_t offset, int order) {
+		uint64_t i = _bit_index(self, offset, order);
+		_word(self, i / 64) &= ~(uint64_t(1) << (i % 64));
+	}
+
+	// 存储区紧跟在索引区后面
+	static inline free_node* _node(buddy* self, int64_t offset) {
+		return (free_node*)((char*)self + self->index_size + offset);
+	}
+
+	static void _push(buddy* self, int64_t offset, int order) {
+		free_node* node = _node(self, offset);
+		node->prev = -1;
+		node->next = self->free_head[order];
+		if (node->next >= 0) {
+			_node(self, node->next)->prev = offset;
+		}
+
+		self->free_head[order] = offset;
+		self->nonempty_mask |= uint64_t(1) << order;
+		_set(self, offset, order);
+	}
+
+	static void _remove(buddy* self, int64_t offset, int order) {
+		free_node* node = _node(self, offset);
+		if (node->prev >= 0) {
+			_node(self, node->prev)->next = node->next;
+		} else {
+			self->free_head[order] = node->next;
+			if (node->next < 0) {
+				self->nonempty_mask &= ~(uint64_t(1) << order);
+			}
+		}
+
+		if (node->next >= 0) {
+			_node(self, node->next)->prev = node->prev;
+		}
+
+		_clear(self, offset, order);
+	}
+};
+
+} // namespace smd
@@ -1,32 +1,130 @@
 ﻿#pragma once
 #include <cstddef>
+#include <stdint.h>
+#include <string>
 
 #ifdef _WIN32
 	#include <mem_alloc/shm_win.h>
 #else
 	#include "mem_alloc/shm_linux.h"
+	#include "mem_alloc/shm_mmap.h"
 #endif
 
 namespace smd {
 
+//
+// file_path不为空时映射这个文件，否则使用系统的共享内存
+//
 class ShmHandle {
 public:
-	std::pair<void*, bool> acquire(int shm_key, size_t size, bool enable_attach) {
-		return m_shm.acquire(shm_key, size, enable_attach);
+	enum {
+		SEGMENT_KEY_STEP = 0x00100000, // 扩展段的key依次加上这个值
+	};
+
+	std::pair<void*, bool> acquire(
+		int shm_key, size_t size, bool enable_attach, bool huge_page = false, const std::string& file_path = "") {
+		m_shm_key = shm_key;
+		m_huge_page = huge_page;
+		m_file_path = file_path;
+		m_use_file = !file_path.empty();
+#ifdef _WIN32
+		if (m_use_file) {
+			SMD_LOG_ERROR("File backed segment is not supported, path:%s", file_path.c_str());
+			return std::make_pair(nullptr, false);
+		}
+#else
+		if (m_use_file) {
+			if (huge_page) {
+				SMD_LOG_WARN("Huge page is ignored for file backed segment, path:%s", file_path.c_str());
+			}
+			return m_file.acquire(file_path, size, enable_attach);
+		}
+#endif
+		return m_shm.acquire(shm_key, size, enable_attach, huge_page);
 	}
 
 	void release() {
+#ifndef _WIN32
+		if (m_use_file) {
+			m_file.release();
+			return;
+		}
+#endif
 		m_shm.release();
 	}
 
+	//
+	// 扩展段使用和第一段相同的方式创建，key和文件名由第一段推导出来
+	//
+	std::pair<void*, bool> acquire_segment(ShmHandle& segment, unsigned index, size_t size, bool enable_attach) const {
+		return segment.acquire(segment_key(index), size, enable_attach, m_huge_page, segment_path(index));
+	}
+
+	// 删除上一次留下来的扩展段，不存在时返回false
+	bool remove_segment(unsigned index) const {
+#ifdef _WIN32
+		return false;
+#else
+		if (m_use_file)
+			return ShmMmap::remove(segment_path(index));
+		return ShmLinux::remove(segment_key(index));
+#endif
+	}
+
+	// 读出扩展段开头的len个字节，用来在删除和挂接之前确认段属于谁，段不存在时返回false
+	bool peek_segment(unsigned index, void* out, size_t len) const {
+#ifdef _WIN32
+		return false;
+#else
+		if (m_use_file)
+			return ShmMmap::peek(segment_path(index), out, len);
+		return ShmLinux::peek(segment_key(index), out, len);
+#endif
+	}
+
+	int key() const {
+		return m_shm_key;
+	}
+
+	// 把修改写回文件，系统的共享内存没有对应的文件，直接返回
+	bool flush(bool async = false) {
+#ifndef _WIN32
+		if (m_use_file)
+			return m_file.flush(async);
+#endif
+		return m_shm.flush(async);
+	}
+
+	// 实际使用的页大小
+	size_t page_size() const {
+#ifndef _WIN32
+		if (m_use_file)
+			return m_file.page_size();
+#endif
+		return m_shm.page_size();
+	}
+
 private:
+	// 按无符号数计算，溢出时回绕；算出来的key可能和别的字典的key相同，由Alloc检查段头
+	int segment_key(unsigned index) const {
+		return int(uint32_t(m_shm_key) + uint32_t(index) * uint32_t(SEGMENT_KEY_STEP));
+	}
+
+	std::string segment_path(unsigned index) const {
+		return m_file_path.empty() ? m_file_path : m_file_path + "." + std::to_string(index);
+	}
+
+private:
+	int m_shm_key = 0;
+	bool m_huge_page = false;
+	std::string m_file_path;
+	bool m_use_file = false;
 #ifdef _WIN32
 	ShmWin m_shm;
 #else
 	ShmLinux m_shm;
+	ShmMmap m_file;
 #endif
 };
 
-static ShmHandle g_shmHandle;
-
 } // namespace smd
@@ -13,6 +13,20 @@
 
 #include <common/log.h>
 
+//
+// 共享内存只在真正访问的时候才占用物理内存，创建时不预留交换空间，这样几十G的共享内存也能创建成功
+//
+#ifndef SHM_NORESERVE
+	#define SHM_NORESERVE 0
+#endif
+
+//
+// 大页需要系统预留（/proc/sys/vm/nr_hugepages），没有预留或者没有权限时退回普通页
+//
+#ifndef SHM_HUGETLB
+	#define SHM_HUGETLB 0
+#endif
+
 namespace smd {
 struct info_t {
 	std::atomic_size_t acc_;
@@ -28,13 +42,29 @@ inline std::atomic_size_t& acc_of(void* mem, std::size_t size) {
 
 class ShmLinux {
 public:
-	std::pair<void*, bool> acquire(int shm_key, size_t size, bool enable_attach) {
+	enum : size_t {
+		NORMAL_PAGE_SIZE = 4 * 1024,
+		HUGE_PAGE_SIZE = 2 * 1024 * 1024,
+	};
+
+	std::pair<void*, bool> acquire(int shm_key, size_t size, bool enable_attach, bool huge_page = false) {
 		size_ = calc_size(size);
-		auto shm_id = shmget(shm_key, size_, 0);
+		page_size_ = 0;
+		// 大小传0，这样已有的共享内存不管多大都能找到
+		auto shm_id = shmget(shm_key, 0, 0);
 		bool is_attached = true;
 
+		// 已有的共享内存比需要的小，不能再挂接了，只能重新创建
+		if (enable_attach && shm_id >= 0) {
+			struct shmid_ds ds;
+			if (shmctl(shm_id, IPC_STAT, &ds) == 0 && ds.shm_segsz < size_) {
+				SMD_LOG_ERROR("Existed block is too small, key:%d, size:%llu, need:%llu", shm_key, ds.shm_segsz, size_);
+				enable_attach = false;
+			}
+		}
+
 		if (!enable_attach) {
-			if (shm_id > 0) {
+			if (shm_id >= 0) {
 				if (shmctl(shm_id, IPC_RMID, nullptr) < 0) {
 					SMD_LOG_ERROR("Remove block failed, key:%d, errno:%d", shm_key, errno);
 					return std::make_pair(nullptr, is_attached);
@@ -42,7 +72,7 @@ public:
 				SMD_LOG_INFO("Existed block has been removed");
 			}
 
-			shm_id = shmget(shm_key, size_, 0666 | IPC_CREAT | IPC_EXCL);
+			shm_id = create(shm_key, huge_page);
 			if (shm_id < 0) {
 				SMD_LOG_ERROR("Create block failed, key:%d, errno:%d", shm_key, errno);
 				return std::make_pair(nullptr, is_attached);
@@ -51,7 +81,7 @@ public:
 			is_attached = false;
 		} else {
 			if (shm_id < 0) {
-				shm_id = shmget(shm_key, size_, 0666 | IPC_CREAT | IPC_EXCL);
+				shm_id = create(shm_key, huge_page);
 			}
 
 			if (shm_id < 0) {
@@ -67,7 +97,11 @@ public:
 			return std::make_pair(nullptr, is_attached);
 		}
 
-		SMD_LOG_INFO("Link block successfully, key:%d, size:%llu", shm_key, size_);
+		if (page_size_ == 0) {
+			page_size_ = query_page_size(mem_);
+		}
+
+		SMD_LOG_INFO("Link block successfully, key:%d, size:%llu, page_size:%llu", shm_key, size_, page_size_);
 		acc_of(mem_, size_).fetch_add(1, std::memory_order_release);
 		return std::make_pair(mem_, is_attached);
 	}
@@ -80,8 +114,94 @@ public:
 		}
 	}
 
+	// 实际使用的页大小
+	size_t page_size() const {
+		return page_size_;
+	}
+
+	static bool remove(int shm_key) {
+		auto shm_id = shmget(shm_key, 0, 0);
+		if (shm_id < 0)
+			return false;
+
+		if (shmctl(shm_id, IPC_RMID, nullptr) < 0) {
+			SMD_LOG_ERROR("Remove block failed, key:%d, errno:%d", shm_key, errno);
+			return false;
+		}
+
+		SMD_LOG_INFO("Block has been removed, key:%d", shm_key);
+		return true;
+	}
+
+	// 只读挂接一下，把开头的len个字节复制出来，不存在时返回false
+	static bool peek(int shm_key, void* out, size_t len) {
+		auto shm_id = shmget(shm_key, 0, 0);
+		if (shm_id < 0)
+			return false;
+
+		auto mem = shmat(shm_id, nullptr, SHM_RDONLY);
+		if (mem == reinterpret_cast<void*>(-1)) {
+			SMD_LOG_ERROR("Link block failed key:%d, errno:%d", shm_key, errno);
+			return false;
+		}
+
+		memcpy(out, mem, len);
+		shmdt(mem);
+		return true;
+	}
+
+	// SysV共享内存没有对应的文件，不需要写回
+	bool flush(bool async) {
+		return mem_ != nullptr;
+	}
+
+	// 从/proc/self/smaps中查出一段映射的页大小
+	static size_t query_page_size(void* mem) {
+		FILE* fp = fopen("/proc/self/smaps", "r");
+		if (fp == nullptr)
+			return NORMAL_PAGE_SIZE;
+
+		char line[512];
+		bool found = false;
+		size_t page_kb = 0;
+		while (fgets(line, sizeof(line), fp) != nullptr) {
+			unsigned long long start = 0;
+			if (!found) {
+				found = sscanf(line, "%llx-", &start) == 1 && start == (unsigned long long)mem;
+			} else if (sscanf(line, "KernelPageSize: %zu kB", &page_kb) == 1) {
+				break;
+			}
+		}
+
+		fclose(fp);
+		return page_kb > 0 ? page_kb * 1024 : NORMAL_PAGE_SIZE;
+	}
+
+private:
+	//
+	// 大页要求大小是大页的整数倍，多出来的部分不使用，计数器的位置和普通页时一样
+	// 大页不加SHM_NORESERVE，预留的大页不够时在这里就失败，而不是在访问的时候收到SIGBUS
+	//
+	int create(int shm_key, bool huge_page) {
+		if (huge_page && SHM_HUGETLB != 0) {
+			size_t huge_size = (size_ + HUGE_PAGE_SIZE - 1) & ~size_t(HUGE_PAGE_SIZE - 1);
+			int shm_id = shmget(shm_key, huge_size, 0666 | IPC_CREAT | IPC_EXCL | SHM_HUGETLB);
+			if (shm_id >= 0) {
+				page_size_ = HUGE_PAGE_SIZE;
+				return shm_id;
+			}
+
+			SMD_LOG_WARN("Create huge page block failed, fall back to normal pages, key:%d, errno:%d", shm_key,
+				errno);
+		}
+
+		page_size_ = NORMAL_PAGE_SIZE;
+		return shmget(shm_key, size_, 0666 | IPC_CREAT | IPC_EXCL | SHM_NORESERVE);
+	}
+
 private:
 	void* mem_ = nullptr;
 	size_t size_ = 0;
+	size_t page_size_ = 0;
 };
 } // namespace smd
@@ -0,0 +1,118 @@
+﻿#pragma once
+#include <mem_alloc/shm_linux.h>
+
+namespace smd {
+
+//
+// 映射一个文件作为共享内存，文件在/dev/shm下时和SysV共享内存一样只在内存中，放在磁盘上时重启机器之后依然可以挂接
+// 文件是稀疏的，挂接之后按需缺页读入，不需要把整个文件读一遍
+//
+class ShmMmap {
+public:
+	std::pair<void*, bool> acquire(const std::string& path, size_t size, bool enable_attach) {
+		size_ = calc_size(size);
+		bool is_attached = false;
+
+		int fd = -1;
+		if (enable_attach) {
+			fd = open(path.c_str(), O_RDWR);
+			if (fd >= 0) {
+				// 已有的文件比需要的小，不能再挂接了，只能重新创建
+				struct stat st;
+				if (fstat(fd, &st) == 0 && size_t(st.st_size) >= size_) {
+					is_attached = true;
+				} else {
+					SMD_LOG_ERROR("Existed file is too small, path:%s, size:%llu, need:%llu", path.c_str(),
+						(unsigned long long)st.st_size, size_);
+					close(fd);
+					fd = -1;
+				}
+			}
+		}
+
+		if (fd < 0) {
+			// 先截断成0再扩展，旧的内容全部丢弃，新文件没有写过的部分不占用磁盘
+			fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+			if (fd < 0) {
+				SMD_LOG_ERROR("Create file failed, path:%s, errno:%d", path.c_str(), errno);
+				return std::make_pair(nullptr, is_attached);
+			}
+
+			if (ftruncate(fd, off_t(size_)) < 0) {
+				SMD_LOG_ERROR("Resize file failed, path:%s, errno:%d, size:%llu", path.c_str(), errno, size_);
+				close(fd);
+				return std::make_pair(nullptr, is_attached);
+			}
+
+			SMD_LOG_INFO("Create file successfully, path:%s, size:%llu", path.c_str(), size_);
+		}
+
+		// 映射建立之后文件描述符就不需要了
+		mem_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mem_ == MAP_FAILED) {
+			SMD_LOG_ERROR("Map file failed, path:%s, errno:%d, size:%llu", path.c_str(), errno, size_);
+			mem_ = nullptr;
+			return std::make_pair(nullptr, is_attached);
+		}
+
+		page_size_ = ShmLinux::query_page_size(mem_);
+		SMD_LOG_INFO("Map file successfully, path:%s, size:%llu, page_size:%llu", path.c_str(), size_, page_size_);
+		acc_of(mem_, size_).fetch_add(1, std::memory_order_release);
+		return std::make_pair(mem_, is_attached);
+	}
+
+	//
+	// 把修改过的页写回文件，进程退出时内核也会写回，只有需要在机器掉电或者重启之前落盘时才需要调用
+	// async为true时只是发起写回，不等待完成
+	//
+	bool flush(bool async) {
+		if (mem_ == nullptr)
+			return false;
+
+		if (msync(mem_, size_, async ? MS_ASYNC : MS_SYNC) < 0) {
+			SMD_LOG_ERROR("Flush failed, errno:%d", errno);
+			return false;
+		}
+
+		return true;
+	}
+
+	void release() {
+		if (mem_ != nullptr && size_ > 0) {
+			munmap(mem_, size_);
+			mem_ = nullptr;
+			size_ = 0;
+		}
+	}
+
+	static bool remove(const std::string& path) {
+		if (unlink(path.c_str()) < 0)
+			return false;
+
+		SMD_LOG_INFO("File has been removed, path:%s", path.c_str());
+		return true;
+	}
+
+	// 读出文件开头的len个字节，不存在时返回false
+	static bool peek(const std::string& path, void* out, size_t len) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		auto n = pread(fd, out, len, 0);
+		close(fd);
+		return n == ssize_t(len);
+	}
+
+	size_t page_size() const {
+		return page_size_;
+	}
+
+private:
+	void* mem_ = nullptr;
+	size_t size_ = 0;
+	size_t page_size_ = 0;
+};
+
+} // namespace smd
@@ -8,7 +8,12 @@ class ShmWin {
 public:
 	ShmWin() {}
 
-	std::pair<void*, bool> acquire(int shm_key, size_t size, bool enable_attach) {
+	// 大页需要SeLockMemoryPrivilege权限，这里不支持，总是使用普通页
+	std::pair<void*, bool> acquire(int shm_key, size_t size, bool enable_attach, bool huge_page = false) {
+		if (huge_page) {
+			SMD_LOG_WARN("Huge page is not supported, fall back to normal pages, key:%d", shm_key);
+		}
+
 		char fmt_name[64];
 		_snprintf_s(fmt_name, sizeof(fmt_name), "%d", shm_key);
 
@@ -53,6 +58,17 @@ public:
 		return std::make_pair(m_memPtr, is_attached);
 	}
 
+	// 页面文件支撑的共享内存，不需要写回
+	bool flush(bool async) {
+		return m_memPtr != nullptr;
+	}
+
+	size_t page_size() const {
+		SYSTEM_INFO info;
+		::GetSystemInfo(&info);
+		return info.dwPageSize;
+	}
+
 	void release() {
 		if (m_memPtr != nullptr) {
 			::UnmapViewOfFile(static_cast<LPCVOID>(m_memPtr));
@@ -1,65 +1,159 @@
 ﻿#pragma once
 #include <time.h>
 #include <container/shm_string.h>
+#include <container/shm_istring.h>
 #include <container/shm_list.h>
 #include <container/shm_vector.h>
 #include <container/shm_hash.h>
+#include <container/shm_flat_hash.h>
+#include <container/shm_unordered_map.h>
 #include <container/shm_map.h>
+#include <container/shm_btree_map.h>
+#include <container/shm_zset.h>
+#include <container/shm_timer_wheel.h>
 #include <common/slice.h>
 #include <mem_alloc/shm_handle.h>
 
 namespace smd {
 
+// 创建共享内存字典时的可选参数
+struct EnvOptions {
+	// 是否启用小块内存分配，只在冷启动时生效，热启动沿用共享内存中记录的设置
+	bool enable_slab = true;
+
+	// 伙伴系统的实现方式
+	BuddyType buddy_type = BuddyType::kTree;
+
+	// 是否使用2M的大页，减少随机访问时的TLB缺失，系统没有预留大页时退回普通页
+	bool huge_page = false;
+
+	// 不为空时映射这个文件作为共享内存，文件放在磁盘上时重启机器之后依然可以热启动
+	std::string file_path;
+
+	// 字典的编号，会写进共享内存的指针里，同一个进程中同时使用多个字典时编号不能相同，热启动时必须和冷启动时一样
+	unsigned env_id = 0;
+};
+
 template <typename T>
-struct ShmHead {
+struct alignas(64) ShmHead {
 	size_t total_size;
 	time_t create_time;
 	time_t last_visit_time;
 	uint32_t visit_num;
 	int shm_key;
+	BuddyType buddy_type;
+	uint32_t env_id;
+	size_t page_size; // 实际使用的页大小
 	shm_pointer<T> entry;
 };
 
 template <typename T>
 class Env {
 public:
-	static Env* Create(int shm_key, unsigned level, bool enable_attach);
+	// level是第一段共享内存的大小，空间不够时自动创建新的段，热启动时挂接所有的段
+	static Env* Create(int shm_key, unsigned level, bool enable_attach, const EnvOptions& options = EnvOptions());
+
+	~Env();
 
 	bool IsAttached() const {
 		return m_is_attached;
 	}
 
+	//
+	// 切换当前使用的字典，之后容器都从这个字典分配内存；回收不需要切换，会按指针找到对应的字典
+	// 同一时刻只有一个当前字典，所以不能在多个线程中同时修改不同的字典
+	//
+	void Activate() {
+		g_alloc = m_alloc;
+	}
+
+	Alloc* GetAlloc() const {
+		return m_alloc;
+	}
+
 	T& GetEntry() {
 		return *m_head.entry;
 	}
 
+	size_t GetPageSize() const {
+		return m_head.page_size;
+	}
+
+	// 把修改写回文件，只对文件映射的共享内存有意义
+	bool Flush(bool async = false) {
+		bool ok = m_shm->flush(async);
+		return m_alloc->Flush(async) && ok;
+	}
+
 private:
-	Env(void* ptr, bool is_attached);
+	Env(void* ptr, bool is_attached, ShmHandle* shm, Alloc* alloc);
 	Env(const Env&) = delete;
 	Env& operator=(const Env&) = delete;
 
 private:
 	const bool m_is_attached;
 	ShmHead<T>& m_head;
+	ShmHandle* m_shm;
+	Alloc* m_alloc;
 };
 
 template <typename T>
-Env<T>::Env(void* ptr, bool is_attached)
+Env<T>::Env(void* ptr, bool is_attached, ShmHandle* shm, Alloc* alloc)
 	: m_is_attached(is_attached)
-	, m_head(*((ShmHead<T>*)ptr)) {
+	, m_head(*((ShmHead<T>*)ptr))
+	, m_shm(shm)
+	, m_alloc(alloc) {
 	m_head.visit_num++;
 	m_head.last_visit_time = time(nullptr);
 	if (!is_attached) {
-		m_head.entry = g_alloc->New<T>();
+		m_head.entry = m_alloc->New<T>();
+	}
+}
+
+//
+// 字典的分配器和共享内存都归字典自己所有，析构之后字典中的指针就不能再访问了
+//
+template <typename T>
+Env<T>::~Env() {
+	if (g_env_alloc[m_alloc->GetEnvId()] == m_alloc) {
+		g_env_alloc[m_alloc->GetEnvId()] = nullptr;
+		g_env_alloc_num--;
 	}
+
+	if (g_alloc == m_alloc) {
+		g_alloc = nullptr;
+	}
+
+	delete m_alloc;
+	m_shm->release();
+	delete m_shm;
 }
 
 template <typename T>
-Env<T>* Env<T>::Create(int shm_key, unsigned level, bool enable_attach) {
-	size_t size = sizeof(ShmHead<T>) + SmdBuddyAlloc::get_index_size(level) + SmdBuddyAlloc::get_storage_size(level);
-	auto [ptr, is_attached] = g_shmHandle.acquire(shm_key, size, enable_attach);
+Env<T>* Env<T>::Create(int shm_key, unsigned level, bool enable_attach, const EnvOptions& options) {
+	if (level > SmdBuddyAlloc::MAX_LEVEL) {
+		SMD_LOG_ERROR("level %u is too large, max:%d", level, SmdBuddyAlloc::MAX_LEVEL);
+		return nullptr;
+	}
+
+	if (options.env_id >= SHM_ENV_NUM) {
+		SMD_LOG_ERROR("env_id %u is too large, max:%d", options.env_id, SHM_ENV_NUM - 1);
+		return nullptr;
+	}
+
+	// 同一个编号的字典只能有一个，指针里的编号要能唯一地找到分配器；之前的字典析构之后才能再用这个编号
+	if (g_env_alloc[options.env_id] != nullptr) {
+		SMD_LOG_ERROR("env_id %u is in use", options.env_id);
+		return nullptr;
+	}
+
+	size_t size = sizeof(ShmHead<T>) + Alloc::GetIndexSize(options.buddy_type, level) +
+				  Alloc::GetStorageSize(options.buddy_type, level);
+	auto shm = new ShmHandle();
+	auto [ptr, is_attached] = shm->acquire(shm_key, size, enable_attach, options.huge_page, options.file_path);
 	if (ptr == nullptr) {
 		SMD_LOG_ERROR("acquire failed, key:%d, size:%llu", shm_key, size);
+		delete shm;
 		return nullptr;
 	}
 
@@ -73,25 +167,45 @@ Env<T>* Env<T>::Create(int shm_key, unsigned level, bool enable_attach) {
 		is_attached = false;
 	}
 
+	if (is_attached && head->buddy_type != options.buddy_type) {
+		SMD_LOG_ERROR("Attach failed, buddy_type %u mismatch %u", (uint32_t)head->buddy_type,
+			(uint32_t)options.buddy_type);
+		is_attached = false;
+	}
+
+	if (is_attached && head->env_id != options.env_id) {
+		SMD_LOG_ERROR("Attach failed, env_id %u mismatch %u", head->env_id, options.env_id);
+		is_attached = false;
+	}
+
 	if (is_attached && head->total_size != size) {
 		SMD_LOG_ERROR("Attach failed, total_size %llu mismatch %llu", head->total_size, size);
 		is_attached = false;
 	}
 
+	const size_t page_size = shm->page_size();
 	if (!is_attached) {
 		memset(ptr, 0, sizeof(ShmHead<T>));
 		head->total_size = size;
 		head->create_time = time(nullptr);
 		head->visit_num = 0;
 		head->shm_key = shm_key;
+		head->buddy_type = options.buddy_type;
+		head->env_id = options.env_id;
 
-		SMD_LOG_INFO("New env has been created, key:%d, size:%llu", shm_key, size);
+		SMD_LOG_INFO("New env has been created, key:%d, size:%llu, page_size:%llu", shm_key, size, page_size);
 	} else {
-		SMD_LOG_INFO("Existed env has been attached, key:%d, size:%llu", shm_key, size);
+		SMD_LOG_INFO("Existed env has been attached, key:%d, size:%llu, page_size:%llu", shm_key, size, page_size);
 	}
 
-	CreateAlloc(ptr, sizeof(ShmHead<T>), level, is_attached);
-	auto env = new Env(ptr, is_attached);
+	head->page_size = page_size;
+
+	auto alloc = new Alloc(
+		ptr, sizeof(ShmHead<T>), level, is_attached, options.enable_slab, options.buddy_type, shm, options.env_id);
+	g_env_alloc[options.env_id] = alloc;
+	g_env_alloc_num++;
+	g_alloc = alloc;
+	auto env = new Env(ptr, is_attached, shm, alloc);
 	return env;
 }
 
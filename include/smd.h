@@ -1,19 +1,36 @@
 ﻿#pragma once
+#include <vector>
+#include <algorithm>
 #include <sm_env.h>
 
 namespace smd {
 
+// 过期时间和它在时间轮里的节点，改过期时间时直接移动节点，清除时一起删掉，时间轮里没有过时的记录
+struct ExpireEntry {
+	int64_t deadline;
+	shm_timer_wheel<shm_string>::node_ptr node;
+
+	ExpireEntry(int64_t d, shm_timer_wheel<shm_string>::node_ptr n)
+		: deadline(d)
+		, node(n) {}
+};
+
 struct StSmd {
 	shm_map<shm_string, shm_string> all_strings;
 	shm_map<shm_string, shm_list<shm_string>> all_lists;
 	shm_map<shm_string, shm_map<shm_string, shm_string>> all_maps;
 	shm_map<shm_string, shm_hash<shm_string>> all_hashes;
+	shm_map<shm_string, shm_zset> all_zsets;
+
+	// 字符串的过期时间（毫秒），时间轮按到期时间排好，每个有过期时间的key在时间轮里正好有一个节点
+	shm_unordered_map<shm_string, ExpireEntry> all_expires;
+	shm_timer_wheel<shm_string> expire_wheel;
 };
 
 class SmdEnv : public smd::Env<StSmd> {
 public:
 	//
-	// 内置string, list, map, hash 四种基本数据类型
+	// 内置string, list, map, hash, zset 五种基本数据类型
 	//
 	shm_map<shm_string, shm_string>& GetAllStrings() {
 		return GetEntry().all_strings;
@@ -31,6 +48,10 @@ public:
 		return GetEntry().all_hashes;
 	}
 
+	shm_map<shm_string, shm_zset>& GetAllZSets() {
+		return GetEntry().all_zsets;
+	}
+
 	//
 	// 字符串操作
 	//
@@ -40,26 +61,62 @@ public:
 	bool SGet(const Slice& key, Slice* value);
 	// 删除操作
 	bool SDel(const Slice& key);
+
+	//
+	// 过期时间，单位是毫秒；SSet会清除key的过期时间，和Redis的SET一致
+	// 读的时候发现过期会顺便删除，其余的由Tick()删除，需要定期调用
+	//
+	// 写入并设置过期时间
+	void SSetEx(const Slice& key, const Slice& value, int64_t ttl_ms);
+	// key不存在时返回false，ttl_ms <= 0时直接删除
+	bool Expire(const Slice& key, int64_t ttl_ms);
+	// 剩余的毫秒数，key不存在返回-2，没有过期时间返回-1
+	int64_t TTL(const Slice& key);
+	// 删除到期的key，返回删除的个数
+	size_t Tick();
+	size_t Tick(int64_t now_ms);
+
+	//
+	// 批量操作：先把key排好序，和上一个key在树里挨着的key从上一个的位置往后找（shm_map::find_sorted），
+	// key分散时多个key交替往下走并预取节点，互相掩盖访存的延迟；不存在的key按顺序从上一个的位置插入；
+	// 过期时间的处理和单个的操作一致
+	//
+	// 批量写，keys和values一一对应，key重复时以后面的为准
+	void MSet(const Slice* keys, const Slice* values, size_t count);
+	// 批量读，values[i]是keys[i]的值，不存在时为空；found不为空时记录每个key是否存在，返回存在的个数
+	size_t MGet(const Slice* keys, size_t count, Slice* values, bool* found = nullptr);
+	// 批量删除，返回删除的个数
+	size_t MDel(const Slice* keys, size_t count);
+
+private:
+	// keys按字典序排好之后的下标，相同的key保持原来的顺序
+	static std::vector<size_t> SortedOrder(const Slice* keys, size_t count);
+	void SetDeadline(const Slice& key, int64_t now_ms, int64_t deadline);
+	// 清除key的过期时间
+	void ClearDeadline(const Slice& key);
+	// key已经过期时删除，返回true
+	bool ExpireIfNeeded(const Slice& key, int64_t now_ms);
 };
 
 // 写操作
-void SmdEnv::SSet(const Slice& key, const Slice& value) {
-	auto& all_strings = GetAllStrings();
-	shm_string str_key(key.data(), key.size());
-	auto it = all_strings.find(str_key);
-	if (it == all_strings.end()) {
-		shm_string str_value(value.data(), value.size());
-		all_strings.insert(std::make_pair(str_key, str_value));
-	} else {
-		it->second = value.ToString();
+inline void SmdEnv::SSet(const Slice& key, const Slice& value) {
+	// 直接用Slice查找，查找和插入只走一次树；key已经存在时只需要覆盖value，不用构造shm_string临时对象
+	auto res = GetAllStrings().try_emplace(key, value.data(), value.size());
+	if (!res.second) {
+		res.first->second.assign(value.data(), value.size());
 	}
+
+	ClearDeadline(key);
 }
 
 // 读操作
-bool SmdEnv::SGet(const Slice& key, Slice* value) {
+inline bool SmdEnv::SGet(const Slice& key, Slice* value) {
+	if (!GetEntry().all_expires.empty() && ExpireIfNeeded(key, util::Time::NowMs())) {
+		return false;
+	}
+
 	auto& all_strings = GetAllStrings();
-	shm_string str_value(key.data(), key.size());
-	auto it = all_strings.find(str_value);
+	auto it = all_strings.find(key);
 	if (it == all_strings.end()) {
 		return false;
 	} else {
@@ -75,15 +132,182 @@ bool SmdEnv::SGet(const Slice& key, Slice* value) {
 }
 
 // 删除操作
-bool SmdEnv::SDel(const Slice& key) {
+inline bool SmdEnv::SDel(const Slice& key) {
 	auto& all_strings = GetAllStrings();
-	shm_string str_value(key.data(), key.size());
-	auto it = all_strings.find(str_value);
+	auto it = all_strings.find(key);
 	if (it == all_strings.end()) {
 		return false;
 	}
 
 	it = all_strings.erase(it);
+	ClearDeadline(key);
+	return true;
+}
+
+inline void SmdEnv::SSetEx(const Slice& key, const Slice& value, int64_t ttl_ms) {
+	SSet(key, value);
+	Expire(key, ttl_ms);
+}
+
+inline bool SmdEnv::Expire(const Slice& key, int64_t ttl_ms) {
+	const int64_t now = util::Time::NowMs();
+	if (ExpireIfNeeded(key, now) || GetAllStrings().count(key) == 0) {
+		return false;
+	}
+
+	if (ttl_ms <= 0) {
+		SDel(key);
+	} else {
+		SetDeadline(key, now, now + ttl_ms);
+	}
+	return true;
+}
+
+inline int64_t SmdEnv::TTL(const Slice& key) {
+	const int64_t now = util::Time::NowMs();
+	if (ExpireIfNeeded(key, now) || GetAllStrings().count(key) == 0) {
+		return -2;
+	}
+
+	auto& all_expires = GetEntry().all_expires;
+	auto it = all_expires.find(key);
+	return it == all_expires.end() ? -1 : it->second.deadline - now;
+}
+
+inline size_t SmdEnv::Tick() {
+	return Tick(util::Time::NowMs());
+}
+
+// 覆盖、删除或者重新设置过期时间时已经改过时间轮里的节点，到期的节点都是有效的
+inline size_t SmdEnv::Tick(int64_t now_ms) {
+	auto& entry = GetEntry();
+	return entry.expire_wheel.advance(now_ms, [&](int64_t, shm_string& key) {
+		entry.all_expires.erase(key);
+		entry.all_strings.erase(key);
+	});
+}
+
+inline void SmdEnv::SetDeadline(const Slice& key, int64_t now_ms, int64_t deadline) {
+	auto& entry = GetEntry();
+	auto it = entry.all_expires.find(key);
+	if (it == entry.all_expires.end()) {
+		auto node = entry.expire_wheel.add(now_ms, deadline, key.data(), key.size());
+		entry.all_expires.try_emplace(key, deadline, node);
+	} else if (it->second.deadline != deadline) {
+		it->second.deadline = deadline;
+		entry.expire_wheel.update(it->second.node, deadline);
+	}
+}
+
+inline void SmdEnv::ClearDeadline(const Slice& key) {
+	auto& entry = GetEntry();
+	if (entry.all_expires.empty()) {
+		return;
+	}
+
+	auto it = entry.all_expires.find(key);
+	if (it != entry.all_expires.end()) {
+		entry.expire_wheel.remove(it->second.node);
+		entry.all_expires.erase(it);
+	}
+}
+
+inline bool SmdEnv::ExpireIfNeeded(const Slice& key, int64_t now_ms) {
+	auto& entry = GetEntry();
+	auto it = entry.all_expires.find(key);
+	if (it == entry.all_expires.end() || it->second.deadline > now_ms) {
+		return false;
+	}
+
+	entry.expire_wheel.remove(it->second.node);
+	entry.all_expires.erase(it);
+	entry.all_strings.erase(key);
 	return true;
 }
+
+inline void SmdEnv::MSet(const Slice* keys, const Slice* values, size_t count) {
+	auto& all_strings = GetAllStrings();
+	typedef shm_map<shm_string, shm_string>::iterator iterator;
+
+	// 已经存在的key先一起找出来，found[i]是keys[i]所在的位置
+	auto order = SortedOrder(keys, count);
+	std::vector<iterator> found(count);
+	all_strings.find_sorted(keys, order.data(), count, [&found](size_t i, iterator it) {
+		found[i] = it;
+	});
+
+	// 按排好的顺序覆盖或者插入，不存在的key从上一个的位置挂上去；排序是稳定的，重复的key以后面的为准
+	auto hint = all_strings.end();
+	for (auto i : order) {
+		if (found[i] == all_strings.end()) {
+			hint = all_strings.try_emplace(hint, keys[i]);
+			hint->second.assign(values[i].data(), values[i].size());
+		} else {
+			found[i]->second.assign(values[i].data(), values[i].size());
+		}
+		ClearDeadline(keys[i]);
+	}
+}
+
+inline size_t SmdEnv::MGet(const Slice* keys, size_t count, Slice* values, bool* found) {
+	// 先删掉过期的key，查找的过程中不再改动树
+	if (!GetEntry().all_expires.empty()) {
+		const int64_t now = util::Time::NowMs();
+		for (size_t i = 0; i < count; i++) {
+			ExpireIfNeeded(keys[i], now);
+		}
+	}
+
+	auto& all_strings = GetAllStrings();
+	size_t hits = 0;
+	auto order = SortedOrder(keys, count);
+	all_strings.find_sorted(keys, order.data(), count, [&](size_t i, auto it) {
+		if (found != nullptr) {
+			found[i] = it != all_strings.end();
+		}
+		if (it == all_strings.end()) {
+			values[i] = Slice();
+			return;
+		}
+
+		values[i] = Slice(it->second.data(), it->second.size());
+		++hits;
+	});
+	return hits;
+}
+
+inline size_t SmdEnv::MDel(const Slice* keys, size_t count) {
+	auto& all_strings = GetAllStrings();
+	typedef shm_map<shm_string, shm_string>::iterator iterator;
+
+	auto order = SortedOrder(keys, count);
+	std::vector<iterator> found(count);
+	all_strings.find_sorted(keys, order.data(), count, [&found](size_t i, iterator it) {
+		found[i] = it;
+	});
+
+	// 按key递增的顺序删除：删除有两个孩子的节点时换掉的是它的前驱，比它小的key都已经删完了，
+	// found里剩下的位置仍然有效；重复的key排在一起，指向刚删掉的节点，跳过
+	auto erased = all_strings.end();
+	size_t deleted = 0;
+	for (auto i : order) {
+		if (found[i] == all_strings.end() || found[i] == erased)
+			continue;
+
+		erased = found[i];
+		all_strings.erase(found[i]);
+		++deleted;
+		ClearDeadline(keys[i]);
+	}
+	return deleted;
+}
+
+inline std::vector<size_t> SmdEnv::SortedOrder(const Slice* keys, size_t count) {
+	std::vector<size_t> order(count);
+	for (size_t i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [keys](size_t a, size_t b) { return keys[a].compare(keys[b]) < 0; });
+	return order;
+}
 } // namespace smd